@@ -0,0 +1,285 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Ismael Filipe Mesquita Ribeiro - nakinx
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "logarchiver.h"
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <zlib.h>
+
+std::shared_ptr<LogArchiver> LogArchiver::getInstance() {
+    static std::shared_ptr<LogArchiver> la(new LogArchiver());
+    return la;
+}
+
+LogArchiver::LogArchiver()
+    : _isRunning(true),
+      _isBusy(false) {
+    _thread = std::thread(&LogArchiver::run, this);
+}
+
+LogArchiver::~LogArchiver() {
+    {
+        std::lock_guard<std::mutex> lk(_mtx);
+        _isRunning = false;
+    }
+
+    _cv.notify_one();
+
+    if (_thread.joinable())
+        _thread.join();
+}
+
+void LogArchiver::push(const std::string & segment,
+                       const std::string & path,
+                       const size_t & maxFiles,
+                       const bool & isCompress) {
+    {
+        std::lock_guard<std::mutex> lk(_mtx);
+        _jobs.push_back({ segment, path, maxFiles, isCompress });
+    }
+
+    _cv.notify_one();
+}
+
+void LogArchiver::wait() {
+    std::unique_lock<std::mutex> lk(_mtx);
+
+    _cvDone.wait(lk, [this] { return (_jobs.empty() && !_isBusy); });
+}
+
+bool LogArchiver::isSegment(const std::string & name,
+                            const std::string & logName) {
+    std::string stamp;
+    unsigned long seq;
+
+    return parseSegment(name, logName, stamp, seq);
+}
+
+bool LogArchiver::parseSegment(const std::string & name,
+                               const std::string & logName,
+                               std::string & stamp,
+                               unsigned long & seq) {
+    // Rotated files are named "<log>.YYYYmmdd-HHMMSS[.N][.gz]".
+    static const std::string pattern = "dddddddd-dddddd";
+
+    if ((name.size() < logName.size() + 1 + pattern.size()) ||
+        (name.compare(0, logName.size(), logName) != 0) ||
+        (name[logName.size()] != '.'))
+        return false;
+
+    size_t pos = logName.size() + 1;
+
+    for (char c : pattern) {
+        if ((c == 'd') ? !isdigit(static_cast<unsigned char>(name[pos])) : (name[pos] != c))
+            return false;
+
+        pos++;
+    }
+
+    stamp = name.substr(logName.size() + 1, pattern.size());
+    seq = 0;
+
+    if ((name.size() > pos + 1) && (name[pos] == '.') && isdigit(static_cast<unsigned char>(name[pos + 1]))) {
+        pos++;
+
+        while ((pos < name.size()) && isdigit(static_cast<unsigned char>(name[pos]))) {
+            seq = (seq * 10) + (name[pos] - '0');
+            pos++;
+        }
+    }
+
+    return ((pos == name.size()) || (name.compare(pos, std::string::npos, ".gz") == 0));
+}
+
+void LogArchiver::run() {
+    std::unique_lock<std::mutex> lk(_mtx);
+
+    while (true) {
+        _cv.wait(lk, [this] { return (!_jobs.empty() || !_isRunning); });
+
+        // The files pending are still archived when stopping.
+        if (_jobs.empty())
+            break;
+
+        Job job = _jobs.front();
+        _jobs.pop_front();
+        _isBusy = true;
+
+        lk.unlock();
+
+        if (job.isCompress && !compress(job.segment))
+            std::cerr << "LogArchiver: Error while compressing the file (" << job.segment << ").\n";
+
+        if (job.maxFiles > 0)
+            removeOld(job.path, job.maxFiles);
+
+        lk.lock();
+
+        _isBusy = false;
+
+        if (_jobs.empty())
+            _cvDone.notify_all();
+    }
+}
+
+bool LogArchiver::compress(const std::string & segment) {
+    std::string tmpPath = segment + ".gz.tmp";
+    std::string gzPath = segment + ".gz";
+
+    int fd = ::open(segment.c_str(), O_RDONLY | O_CLOEXEC);
+
+    // Files rotated faster than compressed may already be removed as the
+    // oldest ones.
+    if (fd < 0)
+        return (errno == ENOENT);
+
+    struct stat st;
+
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+
+    gzFile gz = gzopen(tmpPath.c_str(), "wb6");
+
+    if (gz == nullptr) {
+        ::close(fd);
+        return false;
+    }
+
+    char buffer[64 * 1024];
+    bool isOk = true;
+    ssize_t rc;
+
+    while ((rc = ::read(fd, buffer, sizeof(buffer))) > 0) {
+        if (gzwrite(gz, buffer, rc) != rc) {
+            isOk = false;
+            break;
+        }
+    }
+
+    if (rc < 0)
+        isOk = false;
+
+    ::close(fd);
+
+    if ((gzclose(gz) != Z_OK) || !isOk) {
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+
+    // Keep the age of the file, used to find the oldest ones.
+    struct timespec times[2] = { st.st_atim, st.st_mtim };
+
+    utimensat(AT_FDCWD, tmpPath.c_str(), times, 0);
+
+    // The original is only removed once the compressed file is complete.
+    if (std::rename(tmpPath.c_str(), gzPath.c_str()) != 0) {
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+
+    std::remove(segment.c_str());
+
+    return true;
+}
+
+void LogArchiver::removeOld(const std::string & path,
+                            const size_t & maxFiles) {
+    size_t slash = path.rfind('/');
+    std::string dirPath = (slash == std::string::npos) ? "." : path.substr(0, slash + 1);
+    std::string logName = (slash == std::string::npos) ? path : path.substr(slash + 1);
+
+    DIR * dir = opendir(dirPath.c_str());
+
+    if (dir == nullptr)
+        return;
+
+    /**
+     * Rotated file found, ordered by its age.
+     */
+    struct Segment {
+        struct timespec mtime; ///< Last modification.
+        std::string stamp; ///< Time stamp of the rotation.
+        unsigned long seq; ///< Sequence in the same second.
+        std::string path; ///< Absolute path.
+    };
+
+    std::vector<Segment> segments;
+    struct dirent * entry;
+
+    while ((entry = readdir(dir)) != nullptr) {
+        Segment segment;
+        std::string name = entry->d_name;
+
+        if (!parseSegment(name, logName, segment.stamp, segment.seq))
+            continue;
+
+        struct stat st;
+
+        segment.path = (slash == std::string::npos) ? name : dirPath + name;
+
+        if (stat(segment.path.c_str(), &st) != 0)
+            continue;
+
+        segment.mtime = st.st_mtim;
+        segments.push_back(segment);
+    }
+
+    closedir(dir);
+
+    if (segments.size() <= maxFiles)
+        return;
+
+    // Newest first, the name breaks the ties of files rotated within the
+    // resolution of the modification time.
+    std::sort(segments.begin(), segments.end(),
+              [](const Segment & a,
+                 const Segment & b) {
+                  if (a.mtime.tv_sec != b.mtime.tv_sec)
+                      return (a.mtime.tv_sec > b.mtime.tv_sec);
+
+                  if (a.mtime.tv_nsec != b.mtime.tv_nsec)
+                      return (a.mtime.tv_nsec > b.mtime.tv_nsec);
+
+                  if (a.stamp != b.stamp)
+                      return (a.stamp > b.stamp);
+
+                  return (a.seq > b.seq);
+              });
+
+    for (size_t i = maxFiles; i < segments.size(); i++)
+        std::remove(segments[i].path.c_str());
+}
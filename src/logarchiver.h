@@ -0,0 +1,152 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Ismael Filipe Mesquita Ribeiro - nakinx
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LOG_ARCHIVER_
+#define LOG_ARCHIVER_
+
+#include <string>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <memory>
+#include <condition_variable>
+
+/**
+ * Class responsable to handle the files left by the log rotation out of the
+ * logging path. A background thread compresses each rotated file and
+ * removes the oldest ones beyond the quantity retained.
+ *
+ * There is one archiver for the application, kept alive while a log file
+ * with rotation exists, so the files rotated while the application exits
+ * are still handled.
+ */
+class LogArchiver {
+
+public:
+    /**
+     * Return the archiver of the application, starting it if needed.
+     *
+     * @return Archiver instance.
+     */
+    static std::shared_ptr<LogArchiver> getInstance();
+
+    /**
+     * Destructor, handles the files pending and stops the thread.
+     */
+    ~LogArchiver();
+
+    /**
+     * Schedule a file rotated to be archived.
+     *
+     * @param segment Absolute path of the file rotated.
+     * @param path Absolute path of the log file it was rotated from.
+     * @param maxFiles Quantity of files rotated retained, 0 to keep all.
+     * @param isCompress Compress the file with gzip.
+     */
+    void push(const std::string & segment,
+              const std::string & path,
+              const size_t & maxFiles,
+              const bool & isCompress);
+
+    /**
+     * Wait until all the files scheduled are archived.
+     */
+    void wait();
+
+    /**
+     * Check if a file name is a rotated file of the log file.
+     *
+     * @param name File name, without directory.
+     * @param logName Log file name, without directory.
+     *
+     * @return True if it's a rotated file and false otherwise.
+     */
+    static bool isSegment(const std::string & name,
+                          const std::string & logName);
+
+private:
+    LogArchiver();
+    LogArchiver(LogArchiver const &) = delete;
+    void operator=(LogArchiver const &) = delete;
+
+    /**
+     * File rotated waiting to be archived.
+     */
+    struct Job {
+        std::string segment; ///< Absolute path of the file rotated.
+        std::string path; ///< Absolute path of the log file.
+        size_t maxFiles; ///< Quantity of files rotated retained.
+        bool isCompress; ///< Compress the file.
+    };
+
+    /**
+     * Split the name of a rotated file of the log file.
+     *
+     * @param name File name, without directory.
+     * @param logName Log file name, without directory.
+     * @param stamp Time stamp of the rotation.
+     * @param seq Sequence of the files rotated in the same second.
+     *
+     * @return True if it's a rotated file and false otherwise.
+     */
+    static bool parseSegment(const std::string & name,
+                             const std::string & logName,
+                             std::string & stamp,
+                             unsigned long & seq);
+
+    /**
+     * Loop of the archiver thread.
+     */
+    void run();
+
+    /**
+     * Compress the file into "<segment>.gz", keeping the modification time,
+     * and remove it.
+     *
+     * @param segment Absolute path of the file.
+     *
+     * @return True if compressed or no longer exists and false otherwise.
+     */
+    bool compress(const std::string & segment);
+
+    /**
+     * Remove the oldest files rotated from the log file beyond the quantity
+     * retained.
+     *
+     * @param path Absolute path of the log file.
+     * @param maxFiles Quantity of files retained.
+     */
+    void removeOld(const std::string & path,
+                   const size_t & maxFiles);
+
+    std::deque<Job> _jobs; ///< Files waiting to be archived.
+    std::mutex _mtx; ///< Protection of the jobs.
+    std::condition_variable _cv; ///< Signals a job pushed or the stop.
+    std::condition_variable _cvDone; ///< Signals the jobs finished.
+    bool _isRunning; ///< The thread must keep running.
+    bool _isBusy; ///< The thread is archiving a file.
+    std::thread _thread; ///< Archiver thread.
+};
+
+#endif // LOG_ARCHIVER_
@@ -0,0 +1,468 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Ismael Filipe Mesquita Ribeiro - nakinx
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LOG_ARGS_
+#define LOG_ARGS_
+
+#include <string>
+#include <string_view>
+#include <sstream>
+#include <type_traits>
+#include <charconv>
+#include <cstring>
+#include <cstdint>
+
+#include "logstream.h"
+
+/**
+ * Customization point to format the arguments of the LOG_<SEVERITY>F
+ * macros. Specialize it for a user type to replace its operator<<, used by
+ * default:
+ *
+ *     template<>
+ *     struct LogArgFormatter<Point> {
+ *         static void format(std::string & out, const Point & p) {
+ *             LogArgFormatter<int>::format(out, p.x);
+ *             out += ',';
+ *             LogArgFormatter<int>::format(out, p.y);
+ *         }
+ *     };
+ *
+ * Types trivially copyable are copied into the record and formatted by the
+ * writer thread, the others are formatted when logged.
+ */
+template<typename T, typename Enable = void>
+struct LogArgFormatter {
+    static void format(std::string & out,
+                       const T & value) {
+        std::ostringstream ss;
+        ss << value;
+        out += ss.str();
+    }
+};
+
+/**
+ * Integers, formatted without locale.
+ */
+template<typename T>
+struct LogArgFormatter<T, typename std::enable_if<std::is_integral<T>::value>::type> {
+    static void format(std::string & out,
+                       const T & value) {
+        char buffer[24];
+        char * end = LogStream::formatDecimal(buffer, value);
+        out.append(buffer, end - buffer);
+    }
+};
+
+/**
+ * Floating point, formatted as std::ostream does by default.
+ */
+template<typename T>
+struct LogArgFormatter<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+    static void format(std::string & out,
+                       const T & value) {
+        char buffer[32];
+        char * end = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::general, 6).ptr;
+        out.append(buffer, end - buffer);
+    }
+};
+
+/**
+ * Booleans, as 1 or 0 like std::ostream and LogStream.
+ */
+template<>
+struct LogArgFormatter<bool> {
+    static void format(std::string & out,
+                       const bool & value) {
+        out += (value ? '1' : '0');
+    }
+};
+
+/**
+ * Characters, including signed char and unsigned char (int8_t and
+ * uint8_t), as characters like std::ostream and LogStream.
+ */
+template<>
+struct LogArgFormatter<char> {
+    static void format(std::string & out,
+                       const char & value) {
+        out += value;
+    }
+};
+
+template<>
+struct LogArgFormatter<signed char> {
+    static void format(std::string & out,
+                       const signed char & value) {
+        out += static_cast<char>(value);
+    }
+};
+
+template<>
+struct LogArgFormatter<unsigned char> {
+    static void format(std::string & out,
+                       const unsigned char & value) {
+        out += static_cast<char>(value);
+    }
+};
+
+/**
+ * String literal given to the LOG_<SEVERITY>F macros with LOG_LITERAL,
+ * captured by pointer instead of copied.
+ */
+struct LogLiteral {
+    const char * str; ///< String literal, lives as long as the application.
+};
+
+/**
+ * Wrap a string literal to be captured by pointer. Only a literal compiles,
+ * a char array or a pointer is rejected:
+ *
+ *     LOG_INFOF("logger", "Opened {}", LOG_LITERAL("the configuration file"));
+ */
+#define LOG_LITERAL(str) LogLiteral { "" str }
+
+/**
+ * Arguments of a log record captured to be formatted later, usually by the
+ * writer thread in asynchronous mode.
+ *
+ * Each argument is kept in a fixed buffer after the function that formats
+ * it, so capturing costs a few stores and no allocation:
+ *   - Arithmetic and other trivially copyable types, by value.
+ *   - String literals wrapped by LOG_LITERAL, by pointer.
+ *   - Other strings (std::string, std::string_view, char *, char arrays up
+ *     to their first NUL or their size), by copy.
+ *   - Other types are formatted when captured and kept as strings.
+ *
+ * The format replaces each {} by the next argument, use {{ and }} to write
+ * the braces. It's kept by pointer, so it must be a string literal.
+ */
+class LogArgs {
+
+public:
+    static const size_t Capacity = 256; ///< Size of the buffer of arguments.
+
+    /**
+     * Function that appends an argument captured into the output.
+     */
+    typedef void (*Formatter)(std::string & out,
+                              const char * data,
+                              const uint32_t & len);
+
+    /**
+     * Constructor, without any argument.
+     */
+    LogArgs()
+        : _format(nullptr),
+          _size(0) {
+    }
+
+    /**
+     * Copy constructor, copies only the part of the buffer used.
+     *
+     * @param other Arguments to be copied.
+     */
+    LogArgs(const LogArgs & other)
+        : _format(other._format),
+          _size(other._size) {
+        memcpy(_data, other._data, _size);
+    }
+
+    /**
+     * Assignment, copies only the part of the buffer used.
+     *
+     * @param other Arguments to be copied.
+     *
+     * @return This instance.
+     */
+    LogArgs & operator=(const LogArgs & other) {
+        _format = other._format;
+        _size = other._size;
+        memcpy(_data, other._data, _size);
+        return *this;
+    }
+
+    /**
+     * Capture the format and the arguments.
+     *
+     * @param format Format with a {} for each argument, string literal.
+     * @param args Arguments.
+     *
+     * @return True if captured and false if they don't fit in the buffer.
+     */
+    template<typename... Args>
+    bool capture(const char * format,
+                 Args &&... args) {
+        _format = format;
+        _size = 0;
+
+        if ((push(args) && ...))
+            return true;
+
+        clear();
+        return false;
+    }
+
+    /**
+     * Append the format with the arguments captured into the output.
+     *
+     * @param out Output where the text will be appended.
+     */
+    void format(std::string & out) const {
+        const char * data = _data;
+        const char * end = _data + _size;
+
+        render(out, _format, [&](std::string & o) {
+            if (data >= end)
+                return false;
+
+            Formatter formatter;
+            uint32_t len;
+
+            memcpy(&formatter, data, sizeof(formatter));
+            memcpy(&len, data + sizeof(formatter), sizeof(len));
+
+            formatter(o, data + HeaderSize, len);
+
+            data += HeaderSize + align(len);
+            return true;
+        });
+    }
+
+    /**
+     * Append the format with the arguments into the output without capturing
+     * them, used when they don't fit in the buffer.
+     *
+     * @param out Output where the text will be appended.
+     * @param format Format with a {} for each argument.
+     * @param args Arguments.
+     */
+    template<typename... Args>
+    static void formatNow(std::string & out,
+                          const char * format,
+                          const Args &... args) {
+        std::string texts[sizeof...(Args) + 1];
+        size_t next = 0;
+
+        ((formatArg(texts[next++], args)), ...);
+
+        size_t qtyTexts = next;
+
+        next = 0;
+
+        render(out, format, [&](std::string & o) {
+            if (next >= qtyTexts)
+                return false;
+
+            o += texts[next++];
+            return true;
+        });
+    }
+
+    /**
+     * Check if there is no format captured.
+     *
+     * @return True if empty and false otherwise.
+     */
+    bool isEmpty() const {
+        return (_format == nullptr);
+    }
+
+    /**
+     * Remove the format and the arguments.
+     */
+    void clear() {
+        _format = nullptr;
+        _size = 0;
+    }
+
+private:
+    static const size_t HeaderSize = sizeof(Formatter) + sizeof(uint64_t); ///< Formatter and length (padded) of each argument.
+
+    /**
+     * Round the length of an argument to keep the next one aligned.
+     *
+     * @param len Length of the argument.
+     *
+     * @return Length aligned.
+     */
+    static size_t align(const size_t & len) {
+        return ((len + 7) & ~static_cast<size_t>(7));
+    }
+
+    /**
+     * Append the format into the output, replacing each {} with the text
+     * written by the function given, until it returns false.
+     *
+     * @param out Output where the text will be appended.
+     * @param format Format with a {} for each argument.
+     * @param next Function that appends the next argument.
+     */
+    template<typename F>
+    static void render(std::string & out,
+                       const char * format,
+                       F next) {
+        if (format == nullptr)
+            return;
+
+        const char * begin = format;
+        const char * p = format;
+
+        for (; *p != '\0'; p++) {
+            if (((p[0] == '{') && (p[1] == '{')) || ((p[0] == '}') && (p[1] == '}'))) {
+                out.append(begin, (p + 1) - begin);
+                begin = p + 2;
+                p++;
+            } else if ((p[0] == '{') && (p[1] == '}')) {
+                out.append(begin, p - begin);
+
+                // Placeholders without argument are kept.
+                if (!next(out))
+                    out += "{}";
+
+                begin = p + 2;
+                p++;
+            }
+        }
+
+        out.append(begin, p - begin);
+    }
+
+    /**
+     * Append an argument into the output.
+     *
+     * @param out Output where the text will be appended.
+     * @param value Argument.
+     */
+    template<typename T>
+    static void formatArg(std::string & out,
+                          const T & value) {
+        if constexpr (std::is_same<T, LogLiteral>::value)
+            out += value.str;
+        else if constexpr (std::is_array<T>::value && std::is_same<typename std::remove_cv<typename std::remove_extent<T>::type>::type, char>::value)
+            out.append(value, strnlen(value, std::extent<T>::value));
+        else if constexpr (std::is_same<T, const char *>::value || std::is_same<T, char *>::value)
+            out += (value != nullptr) ? value : "(null)";
+        else if constexpr (std::is_convertible<const T &, std::string_view>::value)
+            out += std::string_view(value);
+        else
+            LogArgFormatter<T>::format(out, value);
+    }
+
+    /**
+     * Formatter of a string literal kept by pointer.
+     */
+    static void formatLiteral(std::string & out,
+                              const char * data,
+                              const uint32_t & len) {
+        const char * literal;
+        memcpy(&literal, data, sizeof(literal));
+        out += literal;
+    }
+
+    /**
+     * Formatter of a string copied.
+     */
+    static void formatString(std::string & out,
+                             const char * data,
+                             const uint32_t & len) {
+        out.append(data, len);
+    }
+
+    /**
+     * Formatter of a value copied.
+     */
+    template<typename T>
+    static void formatValue(std::string & out,
+                            const char * data,
+                            const uint32_t & len) {
+        typename std::remove_cv<T>::type value;
+        memcpy(static_cast<void *>(&value), data, sizeof(T));
+        LogArgFormatter<typename std::remove_cv<T>::type>::format(out, value);
+    }
+
+    /**
+     * Add an argument with its formatter into the buffer.
+     *
+     * @param formatter Function that formats the argument.
+     * @param data Argument.
+     * @param len Length of the argument.
+     *
+     * @return True if added and false if it doesn't fit.
+     */
+    bool add(Formatter formatter,
+             const void * data,
+             const size_t & len) {
+        if ((HeaderSize + align(len)) > (Capacity - _size))
+            return false;
+
+        uint32_t len32 = static_cast<uint32_t>(len);
+
+        memcpy(_data + _size, &formatter, sizeof(formatter));
+        memcpy(_data + _size + sizeof(formatter), &len32, sizeof(len32));
+        memcpy(_data + _size + HeaderSize, data, len);
+
+        _size += HeaderSize + align(len);
+        return true;
+    }
+
+    /**
+     * Capture an argument according to its type. A char array, even const,
+     * may be a buffer of the caller, so it's copied; it may also be full
+     * without a NUL, so only up to its size.
+     *
+     * @param value Argument.
+     *
+     * @return True if captured and false if it doesn't fit.
+     */
+    template<typename Arg>
+    bool push(Arg && value) {
+        typedef typename std::remove_reference<Arg>::type Raw;
+        typedef typename std::remove_cv<Raw>::type T;
+
+        if constexpr (std::is_same<T, LogLiteral>::value) {
+            return add(&formatLiteral, &value.str, sizeof(value.str));
+        } else if constexpr (std::is_array<Raw>::value && std::is_same<typename std::remove_cv<typename std::remove_extent<Raw>::type>::type, char>::value) {
+            return add(&formatString, value, strnlen(value, std::extent<Raw>::value));
+        } else if constexpr (std::is_same<T, const char *>::value || std::is_same<T, char *>::value) {
+            const char * str = (value != nullptr) ? value : "(null)";
+            return add(&formatString, str, strlen(str));
+        } else if constexpr (std::is_convertible<const T &, std::string_view>::value) {
+            std::string_view str(value);
+            return add(&formatString, str.data(), str.length());
+        } else if constexpr (std::is_trivially_copyable<T>::value) {
+            return add(&formatValue<T>, &value, sizeof(T));
+        } else {
+            std::string str;
+            LogArgFormatter<T>::format(str, value);
+            return add(&formatString, str.data(), str.length());
+        }
+    }
+
+    const char * _format; ///< Format of the record, string literal.
+    size_t _size; ///< Part of the buffer used.
+    alignas(8) char _data[Capacity]; ///< Arguments after their formatters.
+};
+
+#endif // LOG_ARGS_
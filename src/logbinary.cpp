@@ -0,0 +1,211 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Ismael Filipe Mesquita Ribeiro - nakinx
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "logbinary.h"
+
+#include "logger.h"
+#include "logexception.h"
+#include "logformat.h"
+
+#include <vector>
+#include <cstring>
+
+#include <unistd.h>
+#include <sys/syscall.h>
+
+/**
+ * Types of entries in the binary log file.
+ */
+enum class LogEntryType : uint8_t {
+    Format = 'F', ///< Info format of the records after it.
+    Site = 'S', ///< Call site of the dictionary.
+    Record = 'R' ///< Log record.
+};
+
+/**
+ * Append the raw bytes of a value.
+ *
+ * @param out Output where the value will be appended.
+ * @param value Value to be appended.
+ */
+template<typename T>
+static void appendRaw(std::string & out,
+                      const T & value) {
+    out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+/**
+ * Read the raw bytes of a value.
+ *
+ * @param data Begin of the value.
+ *
+ * @return Value read.
+ */
+template<typename T>
+static T readRaw(const char * data) {
+    T value;
+    memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+/**
+ * Append the type and the size of the payload of an entry.
+ *
+ * @param out Output where the header will be appended.
+ * @param type Type of the entry.
+ * @param size Size of the payload.
+ */
+static void appendEntry(std::string & out,
+                        const LogEntryType & type,
+                        const size_t & size) {
+    appendRaw(out, static_cast<uint8_t>(type));
+    appendRaw(out, static_cast<uint32_t>(size));
+}
+
+void LogBinary::appendFormat(std::string & out,
+                             const std::string & infoFormat) {
+    appendEntry(out, LogEntryType::Format, 5 + infoFormat.length());
+    out.append("LOGB", 4);
+    appendRaw(out, static_cast<uint8_t>(Version));
+    out += infoFormat;
+}
+
+void LogBinary::appendSite(std::string & out,
+                           const uint32_t & id,
+                           const LogSite & site) {
+    uint16_t fileLen = static_cast<uint16_t>(std::min<size_t>(site.file.length(), UINT16_MAX));
+
+    appendEntry(out, LogEntryType::Site, 10 + fileLen + site.function.length());
+    appendRaw(out, id);
+    appendRaw(out, static_cast<int32_t>(site.line));
+    appendRaw(out, fileLen);
+    out.append(site.file, 0, fileLen);
+    out += site.function;
+}
+
+void LogBinary::appendRecord(std::string & out,
+                             const uint64_t & thread,
+                             const std::chrono::system_clock::time_point & time,
+                             const uint32_t & siteId,
+                             const SeverityLevel & sl,
+                             const size_t & msgLen) {
+    // The severity is never zero, so the entry never ends with zeros that
+    // would be taken as the end of a memory-mapped file.
+    appendEntry(out, LogEntryType::Record, (RecordHeaderSize - EntryHeaderSize) + msgLen);
+    appendRaw(out, thread);
+    appendRaw(out, static_cast<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count()));
+    appendRaw(out, siteId);
+    appendRaw(out, static_cast<uint8_t>(sl));
+}
+
+uint64_t LogBinary::getThreadId() {
+    static thread_local uint64_t tid = syscall(SYS_gettid);
+    return tid;
+}
+
+void LogBinary::decode(const std::string & data,
+                       std::string & out) {
+    const char * entry = data.data();
+    const char * end = entry + data.length();
+    LogFormat infoFormat;
+    bool hasFormat = false;
+    std::vector<LogSite> sites;
+    std::vector<bool> isSiteKnown;
+
+    while ((end - entry) >= static_cast<ptrdiff_t>(EntryHeaderSize)) {
+        LogEntryType type = static_cast<LogEntryType>(readRaw<uint8_t>(entry));
+        size_t size = readRaw<uint32_t>(entry + 1);
+        const char * payload = entry + EntryHeaderSize;
+
+        if (static_cast<uint8_t>(type) == 0)
+            break; // Zeros of a memory-mapped window not used.
+
+        if (static_cast<size_t>(end - payload) < size)
+            break; // Last entry truncated by a crash.
+
+        switch (type) {
+            case LogEntryType::Format :
+                if ((size < 5) || (memcmp(payload, "LOGB", 4) != 0) || (readRaw<uint8_t>(payload + 4) != Version))
+                    throw LoggerException(4, "Invalid binary log.");
+
+                // The sites written after the format replace the previous
+                // ones, they may come from another run of the application.
+                infoFormat.compile(std::string(payload + 5, size - 5));
+                hasFormat = true;
+                sites.clear();
+                isSiteKnown.clear();
+                break;
+            case LogEntryType::Site : {
+                if (size < 10)
+                    throw LoggerException(4, "Invalid binary log.");
+
+                uint32_t id = readRaw<uint32_t>(payload);
+                uint16_t fileLen = readRaw<uint16_t>(payload + 8);
+
+                // The ids are sequential, never more than the entries.
+                if ((static_cast<size_t>(10 + fileLen) > size) || (id > (data.length() / EntryHeaderSize)))
+                    throw LoggerException(4, "Invalid binary log.");
+
+                if (sites.size() <= id) {
+                    sites.resize(id + 1);
+                    isSiteKnown.resize(id + 1, false);
+                }
+
+                isSiteKnown[id] = true;
+
+                sites[id].line = readRaw<int32_t>(payload + 4);
+                sites[id].file.assign(payload + 10, fileLen);
+                sites[id].function.assign(payload + 10 + fileLen, size - 10 - fileLen);
+                break;
+            }
+            case LogEntryType::Record : {
+                if (!hasFormat || (size < (RecordHeaderSize - EntryHeaderSize)))
+                    throw LoggerException(4, "Invalid binary log.");
+
+                std::chrono::nanoseconds ns(readRaw<int64_t>(payload + 8));
+                uint32_t siteId = readRaw<uint32_t>(payload + 16);
+                SeverityLevel sl = static_cast<SeverityLevel>(readRaw<uint8_t>(payload + 20));
+
+                if ((siteId >= sites.size()) || !isSiteKnown[siteId])
+                    throw LoggerException(4, "Invalid binary log.");
+
+                const LogSite & site = sites[siteId];
+
+                if (!infoFormat.isEmpty()) {
+                    infoFormat.render(out,
+                                      std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(ns)),
+                                      site.file, site.function, site.line, Logger::getServerityName(sl));
+                }
+
+                out.append(payload + (RecordHeaderSize - EntryHeaderSize), size - (RecordHeaderSize - EntryHeaderSize));
+                out += '\n';
+                break;
+            }
+            default :
+                throw LoggerException(4, "Invalid binary log.");
+        }
+
+        entry = payload + size;
+    }
+}
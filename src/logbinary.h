@@ -0,0 +1,165 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Ismael Filipe Mesquita Ribeiro - nakinx
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LOG_BINARY_
+#define LOG_BINARY_
+
+#include "logsetting.h"
+
+#include <string>
+#include <string_view>
+#include <chrono>
+#include <map>
+#include <cstdint>
+
+/**
+ * Call site of the log records, written once in the dictionary of the
+ * binary log file and referenced by id in each record.
+ */
+struct LogSite {
+    int line; ///< Line where log was invoked.
+    std::string file; ///< File where log was invoked.
+    std::string function; ///< Function where log was invoked.
+};
+
+/**
+ * Call site used to look up the dictionary without copying the strings.
+ */
+struct LogSiteRef {
+    int line; ///< Line where log was invoked.
+    std::string_view file; ///< File where log was invoked.
+    std::string_view function; ///< Function where log was invoked.
+};
+
+/**
+ * Order of the call sites in the dictionary, accepts both types.
+ */
+struct LogSiteLess {
+    using is_transparent = void;
+
+    template<typename A, typename B>
+    bool operator()(const A & a,
+                    const B & b) const {
+        if (a.line != b.line)
+            return (a.line < b.line);
+
+        int rc = std::string_view(a.file).compare(b.file);
+
+        if (rc != 0)
+            return (rc < 0);
+
+        return (std::string_view(a.function) < std::string_view(b.function));
+    }
+};
+
+/**
+ * Dictionary of call sites with their ids.
+ */
+typedef std::map<LogSite, uint32_t, LogSiteLess> LogSiteMap;
+
+/**
+ * Encoding of the binary log file and its decoding back to the text
+ * produced by the info format.
+ *
+ * The file is a sequence of entries, each one with the type (1 byte) and
+ * the size of the payload (4 bytes), in the byte order of the host:
+ *
+ *     Format 'F': "LOGB", version (1 byte) and the info format.
+ *     Site 'S': id (4 bytes), line (4 bytes), size of the file name
+ *               (2 bytes), file name and function.
+ *     Record 'R': thread id (8 bytes), time in nanoseconds since the epoch
+ *                 (8 bytes), site id (4 bytes), severity (1 byte) and the
+ *                 message.
+ *
+ * The format is written at the beginning of each file (e.g. after a
+ * rotation), when the logger starts appending to it and when the format
+ * changes, followed by all the sites known. The sites first seen after it
+ * are written before their first record, so a file is decoded alone and in
+ * a single pass.
+ */
+class LogBinary {
+
+public:
+    static const uint8_t Version = 1; ///< Version of the encoding.
+    static const size_t EntryHeaderSize = 5; ///< Type and size of the payload.
+    static const size_t RecordHeaderSize = EntryHeaderSize + 21; ///< Record without the message.
+
+    /**
+     * Append a format entry.
+     *
+     * @param out Output where the entry will be appended.
+     * @param infoFormat Info format of the records.
+     */
+    static void appendFormat(std::string & out,
+                             const std::string & infoFormat);
+
+    /**
+     * Append a site entry.
+     *
+     * @param out Output where the entry will be appended.
+     * @param id Id of the site.
+     * @param site Call site.
+     */
+    static void appendSite(std::string & out,
+                           const uint32_t & id,
+                           const LogSite & site);
+
+    /**
+     * Append a record entry without the message, that must follow it.
+     *
+     * @param out Output where the entry will be appended.
+     * @param thread Id of the thread logging.
+     * @param time When the record was created.
+     * @param siteId Id of the call site.
+     * @param sl Severity of the record.
+     * @param msgLen Length of the message.
+     */
+    static void appendRecord(std::string & out,
+                             const uint64_t & thread,
+                             const std::chrono::system_clock::time_point & time,
+                             const uint32_t & siteId,
+                             const SeverityLevel & sl,
+                             const size_t & msgLen);
+
+    /**
+     * Return the id of the calling thread, as shown by the system.
+     *
+     * @return Thread id.
+     */
+    static uint64_t getThreadId();
+
+    /**
+     * Decode a binary log file into the text produced by the info format.
+     *
+     * @param data Content of the binary log file.
+     * @param out Output where the text will be appended.
+     *
+     * @throws LoggerException
+     *         Invalid binary log.
+     */
+    static void decode(const std::string & data,
+                       std::string & out);
+};
+
+#endif // LOG_BINARY_
@@ -26,12 +26,37 @@
 
 #include "logger.h"
 #include "logexception.h"
+#include "logconfig.h"
+
+#include <sys/stat.h>
+
+/**
+ * Identity and state of the configuration file, to know when it changed.
+ *
+ * @param path Path of the file.
+ *
+ * @return Inode, size and modification time, empty if it doesn't exist.
+ */
+static std::string getFileState(const std::string & path) {
+    struct stat st;
+
+    if (stat(path.c_str(), &st) != 0)
+        return "";
+
+    return std::to_string(st.st_ino) + ":" + std::to_string(st.st_size) + ":" +
+           std::to_string(st.st_mtim.tv_sec) + "." + std::to_string(st.st_mtim.tv_nsec);
+}
 
 LogBuilder & LogBuilder::getInstance() {
     static LogBuilder lb;
     return lb;
 }
 
+LogBuilder::~LogBuilder() {
+    unwatchConfig();
+    stopMetrics();
+}
+
 void LogBuilder::buildLogger(const std::string & name,
                              const std::string & path) {
     buildLogger(LogSetting(name, path));
@@ -41,23 +66,254 @@ void LogBuilder::buildLogger(LogSetting ls) {
     if (!(ls.getName().length() > 0) || !(ls.getName().length() < 255))
         throw LoggerException(1, "Invalid logger name.");
 
-    auto ret = _loggers.insert(std::make_pair(ls.getName(), new Logger(ls)));
+    std::lock_guard<std::mutex> lk(_mtxLoggers);
 
     // Logger name already exist on the map?
-    if (ret.second == false)
+    if (_loggers->find(ls.getName()) != _loggers->end())
         throw LoggerException(2, "Logger name already exist.");
+
+    std::shared_ptr<LoggerMap> loggers = std::make_shared<LoggerMap>(*_loggers);
+    loggers->emplace(ls.getName(), std::make_shared<Logger>(ls));
+
+    publish(loggers);
 }
 
 void LogBuilder::destroyLogger(const std::string & name) {
-    if (_loggers.find(name) == _loggers.end())
-        throw LoggerException(1, "Logger (" + name + ") doesn't exist.");
+    std::shared_ptr<Logger> logger;
 
-    _loggers.erase(name);
+    {
+        std::lock_guard<std::mutex> lk(_mtxLoggers);
+
+        auto it = _loggers->find(name);
+
+        if (it == _loggers->end())
+            throw LoggerException(1, "Logger (" + name + ") doesn't exist.");
+
+        logger = it->second;
+
+        std::shared_ptr<LoggerMap> loggers = std::make_shared<LoggerMap>(*_loggers);
+        loggers->erase(name);
+
+        publish(loggers);
+    }
+
+    // The references must look up the logger again only after it was
+    // removed from the map.
+    _generation++;
+
+    // Other threads may still hold the logger, so the records not written
+    // yet must be written and the file released now.
+    logger->close();
+}
+
+void LogBuilder::publish(const std::shared_ptr<const LoggerMap> & loggers) {
+    _loggers = loggers;
+    _version++;
 }
 
-std::shared_ptr<Logger> LogBuilder::getLogger(const std::string & name) {
-    if (_loggers.find(name) == _loggers.end())
-        throw LoggerException(1, "Logger (" + name + ") doesn't exist.");
+std::shared_ptr<const LogBuilder::LoggerMap> LogBuilder::getLoggers() {
+    // Each thread keeps the last map it has seen, it's only replaced (under
+    // the lock) after a logger is built or destroyed. The map is kept alive
+    // while any thread holds it, so it's never changed or freed under a
+    // reader. The copy returned keeps it alive even if a nested call
+    // replaces the one of the thread.
+    thread_local std::shared_ptr<const LoggerMap> loggers;
+    thread_local unsigned long version = 0;
+
+    if (!loggers || (version != _version.load(std::memory_order_acquire))) {
+        std::lock_guard<std::mutex> lk(_mtxLoggers);
+
+        loggers = _loggers;
+        version = _version.load(std::memory_order_relaxed);
+    }
+
+    return loggers;
+}
+
+std::shared_ptr<Logger> LogBuilder::getLogger(std::string_view name) {
+    std::shared_ptr<const LoggerMap> loggers = getLoggers();
+    auto it = loggers->find(name);
+
+    if (it == loggers->end())
+        throw LoggerException(1, "Logger (" + std::string(name) + ") doesn't exist.");
+
+    return it->second;
+}
+
+void LogBuilder::flush(const std::string & name) {
+    getLogger(name)->flush();
+}
+
+void LogBuilder::flush() {
+    std::shared_ptr<const LoggerMap> loggers = getLoggers();
+
+    for (auto & logger : *loggers)
+        logger.second->flush();
+}
+
+void LogBuilder::attachSink(const std::string & name,
+                            const std::shared_ptr<LogSink> & sink) {
+    getLogger(name)->attachSink(sink);
+}
+
+void LogBuilder::detachSink(const std::string & name,
+                            const std::shared_ptr<LogSink> & sink) {
+    getLogger(name)->detachSink(sink);
+}
+
+void LogBuilder::reopen(const std::string & name) {
+    getLogger(name)->reopen();
+}
+
+void LogBuilder::reopen() {
+    std::shared_ptr<const LoggerMap> loggers = getLoggers();
+
+    for (auto & logger : *loggers)
+        logger.second->reopen();
+}
+
+void LoggerRef::bind(std::string_view name) {
+    // Read the generation first, a logger destroyed during the look up
+    // invalidates the reference.
+    unsigned long generation = LogBuilder::getInstance().getGeneration();
+
+    _logger = LogBuilder::getInstance().getLogger(name);
+    _name = name;
+    _generation = generation;
+}
+
+void LogBuilder::reloadConfig(const std::string & path) {
+    std::vector<LogConfigEntry> entries = LogConfig::load(path);
+    std::shared_ptr<const LoggerMap> loggers = getLoggers();
+
+    for (auto & entry : entries) {
+        for (auto & logger : *loggers) {
+            if ((entry.name != "*") && (entry.name != logger.first))
+                continue;
+
+            if (entry.hasEnable)
+                logger.second->setEnable(entry.isEnable);
+
+            if (entry.hasSeverity)
+                logger.second->setActiveSeverity(entry.activeSeverity);
+        }
+    }
+}
+
+void LogBuilder::watchConfig(const std::string & path,
+                             const std::chrono::milliseconds & interval) {
+    unwatchConfig();
+    reloadConfig(path);
+
+    std::lock_guard<std::mutex> lk(_mtxWatcher);
+
+    _isWatching = true;
+    _watcher = std::thread(&LogBuilder::watcherLoop, this, path, interval);
+}
+
+void LogBuilder::unwatchConfig() {
+    {
+        std::lock_guard<std::mutex> lk(_mtxWatcher);
+
+        if (!_watcher.joinable())
+            return;
+
+        _isWatching = false;
+        _cvWatcher.notify_one();
+    }
+
+    _watcher.join();
+}
+
+void LogBuilder::watcherLoop(const std::string path,
+                             const std::chrono::milliseconds interval) {
+    std::string state = getFileState(path);
+    std::unique_lock<std::mutex> lk(_mtxWatcher);
+
+    while (_isWatching) {
+        _cvWatcher.wait_for(lk, interval);
+
+        if (!_isWatching)
+            break;
+
+        std::string current = getFileState(path);
+
+        // The file may be missing while it's replaced.
+        if (current.empty() || (current == state))
+            continue;
+
+        state = current;
+
+        lk.unlock();
+
+        try {
+            reloadConfig(path);
+        } catch (LoggerException & e) {
+            // There is nobody to catch the exception in the watcher thread.
+            std::cerr << "Logger configuration (" << path << "): " << e.what() << "\n";
+        }
+
+        lk.lock();
+    }
+}
+
+std::vector<LogMetrics> LogBuilder::getMetrics() {
+    std::shared_ptr<const LoggerMap> loggers = getLoggers();
+    std::vector<LogMetrics> metrics;
+
+    for (auto & logger : *loggers)
+        metrics.push_back(logger.second->getMetrics());
+
+    return metrics;
+}
+
+void LogBuilder::emitMetrics(const std::string & name,
+                             const std::chrono::milliseconds & interval) {
+    stopMetrics();
+    getLogger(name);
+
+    std::lock_guard<std::mutex> lk(_mtxEmitter);
+
+    _isEmitting = true;
+    _emitter = std::thread(&LogBuilder::emitterLoop, this, name, interval);
+}
+
+void LogBuilder::stopMetrics() {
+    {
+        std::lock_guard<std::mutex> lk(_mtxEmitter);
+
+        if (!_emitter.joinable())
+            return;
+
+        _isEmitting = false;
+        _cvEmitter.notify_one();
+    }
+
+    _emitter.join();
+}
+
+void LogBuilder::emitterLoop(const std::string name,
+                             const std::chrono::milliseconds interval) {
+    std::unique_lock<std::mutex> lk(_mtxEmitter);
+
+    while (_isEmitting) {
+        _cvEmitter.wait_for(lk, interval);
+
+        if (!_isEmitting)
+            break;
+
+        lk.unlock();
+
+        try {
+            std::shared_ptr<Logger> logger = getLogger(name);
+
+            for (auto & metrics : getMetrics())
+                logger->write(SeverityLevel::Info, __FILE__, __PRETTY_FUNCTION__, __LINE__, metrics.toString());
+        } catch (LoggerException & e) {
+            // There is nobody to catch the exception in the emitter thread.
+            std::cerr << "Logger metrics (" << name << "): " << e.what() << "\n";
+        }
 
-    return (_loggers[name]);
+        lk.lock();
+    }
 }
@@ -26,16 +26,30 @@
 #define LOG_BUILDER_
 
 #include "logsetting.h"
+#include "logmetrics.h"
 
 #include <iostream>
 #include <memory>
 #include <map>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <vector>
 
 class Logger;
+class LogSink;
 
 /**
  * Singleton class responsable to create, store and manager the loggers
  * instances.
+ *
+ * The loggers are kept in a map that is never changed after published,
+ * building or destroying a logger publishes a copy of it. Looking up a
+ * logger doesn't lock nor allocate while no logger is built or destroyed.
  */
 class LogBuilder {
 
@@ -73,7 +87,8 @@ public:
                      const std::string & path);
 
     /**
-     * Destroy logger instance.
+     * Destroy logger instance, the records not written yet are written
+     * before it.
      *
      * @param name Logger name.
      *
@@ -92,13 +107,157 @@ public:
      * @throws LoggerException
      *         Logger name doesn't exist.
      */
-    std::shared_ptr<Logger> getLogger(const std::string & name);
+    std::shared_ptr<Logger> getLogger(std::string_view name);
+
+    /**
+     * Commit the records already written by the logger to the storage
+     * device.
+     *
+     * @param name Logger name.
+     *
+     * @throws LoggerException
+     *         Logger name doesn't exist.
+     */
+    void flush(const std::string & name);
+
+    /**
+     * Commit the records already written by all loggers to the storage
+     * device.
+     */
+    void flush();
+
+    /**
+     * Reopen the log file of the logger, useful after the file was rotated
+     * by an external tool.
+     *
+     * @param name Logger name.
+     *
+     * @throws LoggerException
+     *         Logger name doesn't exist.
+     *         Error while opening the file.
+     */
+    void reopen(const std::string & name);
+
+    /**
+     * Reopen the log files of all loggers.
+     *
+     * @throws LoggerException
+     *         Error while opening the file.
+     */
+    void reopen();
+
+    /**
+     * Attach a sink to the logger, it receives the records written from now
+     * on whose severity is in its mask. A sink can be attached to several
+     * loggers.
+     *
+     * @param name Logger name.
+     * @param sink Sink to be attached.
+     *
+     * @throws LoggerException
+     *         Logger name doesn't exist.
+     */
+    void attachSink(const std::string & name,
+                    const std::shared_ptr<LogSink> & sink);
+
+    /**
+     * Detach a sink from the logger.
+     *
+     * @param name Logger name.
+     * @param sink Sink to be detached.
+     *
+     * @throws LoggerException
+     *         Logger name doesn't exist.
+     */
+    void detachSink(const std::string & name,
+                    const std::shared_ptr<LogSink> & sink);
+
+    /**
+     * Apply the levels of the configuration file (see LogConfig) to the
+     * loggers built, the loggers unknown are ignored. Nothing is applied if
+     * the file is invalid. The loggers aren't locked, the threads logging
+     * see the new levels on their next records.
+     *
+     * @param path Path of the configuration file.
+     *
+     * @throws LoggerException
+     *         Error while opening the file.
+     *         Invalid configuration.
+     */
+    void reloadConfig(const std::string & path);
+
+    /**
+     * Apply the configuration file now and start a thread applying it again
+     * whenever it changes, replacing the file watched before. Errors while
+     * reloading are reported in the standard error.
+     *
+     * @param path Path of the configuration file.
+     * @param interval Interval between checks if the file changed.
+     *
+     * @throws LoggerException
+     *         Error while opening the file.
+     *         Invalid configuration.
+     */
+    void watchConfig(const std::string & path,
+                     const std::chrono::milliseconds & interval);
+
+    /**
+     * Stop watching the configuration file.
+     */
+    void unwatchConfig();
+
+    /**
+     * Return the metrics of all loggers built, without locking them.
+     *
+     * @return Metrics of each logger.
+     */
+    std::vector<LogMetrics> getMetrics();
+
+    /**
+     * Start a thread writing the metrics of all loggers as info records
+     * into the logger given, periodically, replacing the one started
+     * before. The records of a logger destroyed meanwhile are skipped.
+     *
+     * @param name Logger where the metrics are written.
+     * @param interval Interval between the records.
+     *
+     * @throws LoggerException
+     *         Logger name doesn't exist.
+     */
+    void emitMetrics(const std::string & name,
+                     const std::chrono::milliseconds & interval);
+
+    /**
+     * Stop writing the metrics periodically.
+     */
+    void stopMetrics();
+
+    /**
+     * Return a counter incremented each time a logger is destroyed, used by
+     * the logger references to know when they must look up the logger again.
+     *
+     * @return Generation of the loggers.
+     */
+    unsigned long getGeneration() const {
+        return _generation.load(std::memory_order_acquire);
+    }
 
 private:
     /**
      * Implementation as private to build a singleton class.
      */
-    LogBuilder() {}
+    LogBuilder()
+        : _loggers(std::make_shared<LoggerMap>()),
+          _version(1),
+          _generation(0),
+          _isWatching(false),
+          _isEmitting(false) {}
+
+    /**
+     * Stop watching the configuration file and writing the metrics at the
+     * exit of the application.
+     */
+    ~LogBuilder();
 
     /**
      * Implementation as private to build a singleton class.
@@ -110,8 +269,145 @@ private:
      */
     void operator=(LogBuilder const &) {}
 
-    std::map<std::string, std::shared_ptr<Logger>> _loggers; ///< Map with all loggers instances.
+    typedef std::map<std::string, std::shared_ptr<Logger>, std::less<>> LoggerMap;
+
+    /**
+     * Replace the map of loggers, must be called with the loggers lock.
+     *
+     * @param loggers New map of loggers.
+     */
+    void publish(const std::shared_ptr<const LoggerMap> & loggers);
+
+    /**
+     * Return the current map of loggers seen by the thread, held by the
+     * caller while it iterates.
+     *
+     * @return Map with all loggers instances.
+     */
+    std::shared_ptr<const LoggerMap> getLoggers();
+
+    /**
+     * Watcher thread main loop, reloads the configuration file when its
+     * modification time, size or inode changes.
+     *
+     * @param path Path of the configuration file.
+     * @param interval Interval between checks.
+     */
+    void watcherLoop(const std::string path,
+                     const std::chrono::milliseconds interval);
+
+    /**
+     * Emitter thread main loop, writes the metrics of all loggers.
+     *
+     * @param name Logger where the metrics are written.
+     * @param interval Interval between the records.
+     */
+    void emitterLoop(const std::string name,
+                     const std::chrono::milliseconds interval);
+
+    std::shared_ptr<const LoggerMap> _loggers; ///< Map with all loggers instances.
+    std::mutex _mtxLoggers; ///< Protection for building/destroying loggers.
+    std::atomic<unsigned long> _version; ///< Incremented when the map of loggers is replaced.
+    std::atomic<unsigned long> _generation; ///< Incremented when a logger is destroyed.
+    std::thread _watcher; ///< Thread reloading the configuration file.
+    bool _isWatching; ///< Watcher thread must keep running.
+    std::mutex _mtxWatcher; ///< Protection for the watcher thread condition.
+    std::condition_variable _cvWatcher; ///< Wake up the watcher thread to stop.
+    std::thread _emitter; ///< Thread writing the metrics.
+    bool _isEmitting; ///< Emitter thread must keep running.
+    std::mutex _mtxEmitter; ///< Protection for the emitter thread condition.
+    std::condition_variable _cvEmitter; ///< Wake up the emitter thread to stop.
+
+};
+
+/**
+ * Reference to a logger that looks up the builder only once, the next
+ * accesses are a check of the builder generation and a pointer dereference.
+ *
+ * When any logger is destroyed the reference looks up the logger again, so
+ * it follows a logger built again with the same name or throws if it
+ * doesn't exist anymore. Until that the reference keeps the logger
+ * destroyed alive.
+ *
+ * A reference must not be shared between threads, the LOG_<SEVERITY>
+ * macros keep one reference per thread in each place where they are used.
+ */
+class LoggerRef {
+
+public:
+    /**
+     * Constructor of a reference not bound to any logger.
+     */
+    LoggerRef() : _generation(0) {}
+
+    /**
+     * Constructor of a reference bound to the logger.
+     *
+     * @param name Logger name.
+     *
+     * @throws LoggerException
+     *         Logger name doesn't exist.
+     */
+    explicit LoggerRef(std::string_view name) : _generation(0) {
+        bind(name);
+    }
+
+    /**
+     * Return the logger with the given name, looking up the builder only
+     * when the name changes or a logger was destroyed.
+     *
+     * @param name Logger name.
+     *
+     * @return Logger instance.
+     *
+     * @throws LoggerException
+     *         Logger name doesn't exist.
+     */
+    Logger * get(std::string_view name) {
+        if (!isValid() || (_name != name))
+            bind(name);
+
+        return _logger.get();
+    }
+
+    /**
+     * Return the logger bound to the reference.
+     *
+     * @return Logger instance.
+     *
+     * @throws LoggerException
+     *         Logger name doesn't exist.
+     */
+    Logger * operator->() {
+        if (!isValid())
+            bind(_name);
+
+        return _logger.get();
+    }
+
+private:
+    /**
+     * Check if the logger referenced can still be used.
+     *
+     * @return True if no logger was destroyed since the look up.
+     */
+    bool isValid() const {
+        return (_logger && (_generation == LogBuilder::getInstance().getGeneration()));
+    }
+
+    /**
+     * Look up the logger in the builder.
+     *
+     * @param name Logger name.
+     *
+     * @throws LoggerException
+     *         Logger name doesn't exist.
+     */
+    void bind(std::string_view name);
 
+    std::string _name; ///< Name of the logger referenced.
+    std::shared_ptr<Logger> _logger; ///< Logger referenced.
+    unsigned long _generation; ///< Builder generation when the logger was looked up.
 };
 
 #endif // LOG_BUILDER_
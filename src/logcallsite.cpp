@@ -0,0 +1,177 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Ismael Filipe Mesquita Ribeiro - nakinx
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "logcallsite.h"
+
+#include <mutex>
+#include <type_traits>
+
+// The call sites must outlive the loggers writing their records at exit.
+static_assert(std::is_trivially_destructible<LogCallSite>::value, "LogCallSite must not be destroyed.");
+
+/**
+ * Call sites registered, linked through the call sites themselves.
+ */
+struct LogCallSiteRegistry {
+    std::mutex mtx; ///< Protection for the list.
+    LogCallSite * first = nullptr; ///< Last call site registered.
+};
+
+/**
+ * Return the registry, never destroyed as the call sites registered.
+ *
+ * @return Registry of call sites.
+ */
+static LogCallSiteRegistry & getRegistry() {
+    static LogCallSiteRegistry * registry = new LogCallSiteRegistry();
+    return *registry;
+}
+
+LogCallSite::LogCallSite(const char * file,
+                         const char * function,
+                         const int & line,
+                         const SeverityLevel & sl)
+    : _file(file),
+      _function(function),
+      _line(line),
+      _sl(sl),
+      _isEnable(true),
+      _qtyHits(0),
+      _headerList(nullptr) {
+    for (auto & header : _headers)
+        header.store(nullptr, std::memory_order_relaxed);
+
+    LogCallSiteRegistry & registry = getRegistry();
+    std::lock_guard<std::mutex> lk(registry.mtx);
+
+    _next = registry.first;
+    registry.first = this;
+}
+
+const LogSiteHeader * LogCallSite::getHeader(const LogFormat & format,
+                                             std::string_view severity) const {
+    unsigned long formatId = format.getId();
+
+    for (auto & slot : _headers) {
+        const LogSiteHeader * header = slot.load(std::memory_order_acquire);
+
+        if ((header != nullptr) && (header->formatId == formatId))
+            return header;
+    }
+
+    // A format used before, its slot was taken by newer ones.
+    HeaderNode * first = _headerList.load(std::memory_order_acquire);
+    LogSiteHeader * header = findHeader(first, nullptr, formatId);
+
+    if (header == nullptr) {
+        HeaderNode * node = new HeaderNode();
+        format.compileSite(node->header, _file, _function, _line, severity);
+        node->next = first;
+
+        // Another thread may add the same format first, only the nodes added
+        // since the last look are searched again.
+        while (!_headerList.compare_exchange_weak(node->next, node, std::memory_order_acq_rel)) {
+            header = findHeader(node->next, first, formatId);
+
+            if (header != nullptr)
+                break;
+
+            first = node->next;
+        }
+
+        if (header == nullptr)
+            header = &node->header;
+        else
+            delete node;
+    }
+
+    cacheHeader(header);
+
+    return header;
+}
+
+LogSiteHeader * LogCallSite::findHeader(HeaderNode * node,
+                                        const HeaderNode * end,
+                                        const unsigned long & formatId) {
+    for (; node != end; node = node->next) {
+        if (node->header.formatId == formatId)
+            return &node->header;
+    }
+
+    return nullptr;
+}
+
+void LogCallSite::cacheHeader(LogSiteHeader * header) const {
+    // The format ids grow with each format compiled, the lowest is the
+    // oldest. Two threads may pick the same slot, any header stored is
+    // valid.
+    std::atomic<LogSiteHeader *> * oldest = &_headers[0];
+    unsigned long oldestId = ~0UL;
+
+    for (auto & slot : _headers) {
+        LogSiteHeader * cached = slot.load(std::memory_order_acquire);
+
+        if (cached == nullptr) {
+            oldest = &slot;
+            break;
+        }
+
+        if (cached->formatId < oldestId) {
+            oldest = &slot;
+            oldestId = cached->formatId;
+        }
+    }
+
+    oldest->store(header, std::memory_order_release);
+}
+
+void LogCallSite::forEach(const std::function<void(LogCallSite &)> & callback) {
+    LogCallSiteRegistry & registry = getRegistry();
+    std::lock_guard<std::mutex> lk(registry.mtx);
+
+    for (LogCallSite * site = registry.first; site != nullptr; site = site->_next)
+        callback(*site);
+}
+
+size_t LogCallSite::setEnable(std::string_view file,
+                              const int & line,
+                              const bool & isEnable) {
+    size_t qtyChanged = 0;
+
+    forEach([&](LogCallSite & site) {
+        std::string_view siteFile(site.getFile());
+        size_t begin = siteFile.length() - file.length();
+
+        // Whole path components only, "main.cpp" doesn't match "domain.cpp".
+        if ((siteFile.length() >= file.length()) &&
+            (siteFile.compare(begin, file.length(), file) == 0) &&
+            ((begin == 0) || (siteFile[begin - 1] == '/')) &&
+            ((line == 0) || (site.getLine() == line))) {
+            site.setEnable(isEnable);
+            qtyChanged++;
+        }
+    });
+
+    return qtyChanged;
+}
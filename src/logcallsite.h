@@ -0,0 +1,189 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Ismael Filipe Mesquita Ribeiro - nakinx
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LOG_CALL_SITE_
+#define LOG_CALL_SITE_
+
+#include "logsetting.h"
+#include "logformat.h"
+
+#include <string_view>
+#include <atomic>
+#include <functional>
+
+/**
+ * Descriptor of a place where a record is logged, created once by the
+ * LOG_<SEVERITY> macros as a function-local static. The records carry only
+ * its pointer, the file, function and line are never copied and the header
+ * of the info format is rendered once for the call site, only the date/time
+ * is rendered for each record.
+ *
+ * The call sites are registered when first executed and may be enabled or
+ * disabled one by one at any time.
+ *
+ * A call site is never destroyed, nor its headers freed: records queued by
+ * asynchronous and buffered loggers point to it until they are written,
+ * which happens after the function-local statics are destroyed when the
+ * application exits. The headers are kept in a list by call site, one for
+ * each format it was rendered with, and the last ones used are cached in a
+ * few slots.
+ */
+class LogCallSite {
+
+public:
+    /**
+     * Constructor, registers the call site.
+     *
+     * @param file File where log was invoked, string literal.
+     * @param function Function where log was invoked, string literal.
+     * @param line Line where log was invoked.
+     * @param sl Severity of the records.
+     */
+    LogCallSite(const char * file,
+                const char * function,
+                const int & line,
+                const SeverityLevel & sl);
+
+    const char * getFile() const {
+        return _file;
+    }
+
+    const char * getFunction() const {
+        return _function;
+    }
+
+    int getLine() const {
+        return _line;
+    }
+
+    SeverityLevel getSeverity() const {
+        return _sl;
+    }
+
+    bool isEnable() const {
+        return _isEnable.load(std::memory_order_relaxed);
+    }
+
+    void setEnable(const bool & isEnable) {
+        _isEnable.store(isEnable, std::memory_order_relaxed);
+    }
+
+    /**
+     * Count a record logged by the call site.
+     */
+    void hit() const {
+        _qtyHits.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * Return how many records were logged by the call site, in all loggers.
+     *
+     * @return Quantity of records.
+     */
+    unsigned long long getHits() const {
+        return _qtyHits.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Get the header of the call site rendered with the format, rendering it
+     * in the first call. When the slots are full, the header of the oldest
+     * format is replaced in its slot, it's still found in the list if that
+     * format is used again.
+     *
+     * @param format Info format compiled.
+     * @param severity Name of the severity of the call site.
+     *
+     * @return Header of the call site.
+     */
+    const LogSiteHeader * getHeader(const LogFormat & format,
+                                    std::string_view severity) const;
+
+    /**
+     * Call the function for each call site registered.
+     *
+     * @param callback Function called with each call site.
+     */
+    static void forEach(const std::function<void(LogCallSite &)> & callback);
+
+    /**
+     * Enable or disable the call sites of a file.
+     *
+     * @param file End of the path of the file, whole components (e.g.
+     *        "main.cpp" or "src/main.cpp", but not "ain.cpp").
+     * @param line Line of the call site or 0 for all lines.
+     * @param isEnable True to enable and false to disable.
+     *
+     * @return Quantity of call sites changed.
+     */
+    static size_t setEnable(std::string_view file,
+                            const int & line,
+                            const bool & isEnable);
+
+private:
+    LogCallSite(LogCallSite const &) = delete;
+    void operator=(LogCallSite const &) = delete;
+
+    static const size_t HeaderSlots = 4; ///< Headers cached by call site.
+
+    /**
+     * Header in the list of the call site.
+     */
+    struct HeaderNode {
+        LogSiteHeader header; ///< Header rendered.
+        HeaderNode * next; ///< Header rendered before, with another format.
+    };
+
+    /**
+     * Find the header of the format in the list, from the given node.
+     *
+     * @param node First node searched.
+     * @param end Node where the search stops, null for the whole list.
+     * @param formatId Id of the format compiled.
+     *
+     * @return Header of the format or null if it isn't in the list.
+     */
+    static LogSiteHeader * findHeader(HeaderNode * node,
+                                      const HeaderNode * end,
+                                      const unsigned long & formatId);
+
+    /**
+     * Put the header in an empty slot, or in place of the header of the
+     * oldest format.
+     *
+     * @param header Header cached.
+     */
+    void cacheHeader(LogSiteHeader * header) const;
+
+    const char * _file; ///< File where log was invoked.
+    const char * _function; ///< Function where log was invoked.
+    int _line; ///< Line where log was invoked.
+    SeverityLevel _sl; ///< Severity of the records.
+    std::atomic<bool> _isEnable; ///< Call site is enabled.
+    mutable std::atomic<unsigned long long> _qtyHits; ///< Records logged by the call site.
+    mutable std::atomic<LogSiteHeader *> _headers[HeaderSlots]; ///< Headers used last, replaced by the newer formats.
+    mutable std::atomic<HeaderNode *> _headerList; ///< Every header rendered, never freed.
+    LogCallSite * _next; ///< Next call site registered.
+};
+
+#endif // LOG_CALL_SITE_
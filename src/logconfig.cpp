@@ -0,0 +1,144 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Ismael Filipe Mesquita Ribeiro - nakinx
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "logconfig.h"
+
+#include "logsetting.h"
+#include "logexception.h"
+
+#include <fstream>
+#include <sstream>
+
+/**
+ * Remove the spaces around the text.
+ *
+ * @param text Text.
+ *
+ * @return Text without the spaces around it.
+ */
+static std::string trim(const std::string & text) {
+    size_t begin = text.find_first_not_of(" \t\r");
+
+    if (begin == std::string::npos)
+        return "";
+
+    return text.substr(begin, text.find_last_not_of(" \t\r") - begin + 1);
+}
+
+std::vector<LogConfigEntry> LogConfig::load(const std::string & path) {
+    std::ifstream inFile(path);
+
+    if (!inFile.good())
+        throw LoggerException(2, "Error while opening the file.");
+
+    std::stringstream config;
+    config << inFile.rdbuf();
+
+    return parse(config.str(), path);
+}
+
+std::vector<LogConfigEntry> LogConfig::parse(const std::string & config,
+                                             const std::string & path) {
+    std::vector<LogConfigEntry> entries;
+    std::istringstream lines(config);
+    std::string line;
+    int lineNumber = 0;
+
+    while (std::getline(lines, line)) {
+        lineNumber++;
+        line = trim(line.substr(0, line.find('#')));
+
+        if (line.empty())
+            continue;
+
+        // <name>.<key> = <value>, the name may contain dots.
+        size_t equal = line.find('=');
+        std::string key = trim(line.substr(0, equal));
+        size_t dot = key.rfind('.');
+
+        LogConfigEntry entry;
+        bool isValid = (equal != std::string::npos) && (dot != std::string::npos) && (dot > 0);
+
+        if (isValid) {
+            std::string value = trim(line.substr(equal + 1));
+
+            entry.name = trim(key.substr(0, dot));
+            key = trim(key.substr(dot + 1));
+
+            if (key == "severity") {
+                entry.hasSeverity = true;
+                isValid = parseSeverity(value, entry.activeSeverity);
+            } else if (key == "enable") {
+                entry.hasEnable = true;
+                entry.isEnable = (value == "true");
+                isValid = (value == "true") || (value == "false");
+            } else {
+                isValid = false;
+            }
+        }
+
+        if (!isValid)
+            throw LoggerException(5, "Invalid configuration (" + path + ":" + std::to_string(lineNumber) + ").");
+
+        entries.push_back(entry);
+    }
+
+    return entries;
+}
+
+bool LogConfig::parseSeverity(const std::string & value,
+                              int & activeSeverity) {
+    std::istringstream names(value);
+    std::string name;
+
+    activeSeverity = 0;
+
+    if (trim(value).empty())
+        return false;
+
+    while (std::getline(names, name, ',')) {
+        name = trim(name);
+
+        if (name == "debug")
+            activeSeverity |= static_cast<int>(SeverityLevel::Debug);
+        else if (name == "info")
+            activeSeverity |= static_cast<int>(SeverityLevel::Info);
+        else if (name == "warning")
+            activeSeverity |= static_cast<int>(SeverityLevel::Warning);
+        else if (name == "error")
+            activeSeverity |= static_cast<int>(SeverityLevel::Error);
+        else if (name == "fatal")
+            activeSeverity |= static_cast<int>(SeverityLevel::Fatal);
+        else if (name == "all")
+            activeSeverity |= static_cast<int>(SeverityLevel::Debug) |
+                              static_cast<int>(SeverityLevel::Info) |
+                              static_cast<int>(SeverityLevel::Warning) |
+                              static_cast<int>(SeverityLevel::Error) |
+                              static_cast<int>(SeverityLevel::Fatal);
+        else if (name != "none")
+            return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,99 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Ismael Filipe Mesquita Ribeiro - nakinx
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LOG_CONFIG_
+#define LOG_CONFIG_
+
+#include <string>
+#include <vector>
+
+/**
+ * Levels of a logger (or of all loggers when the name is "*") read from a
+ * configuration file.
+ */
+struct LogConfigEntry {
+    std::string name; ///< Logger name or "*" for all loggers.
+    bool hasEnable = false; ///< Entry changes the enable flag.
+    bool isEnable = true; ///< Enable flag.
+    bool hasSeverity = false; ///< Entry changes the active severitys.
+    int activeSeverity = 0; ///< Active severitys.
+};
+
+/**
+ * Parser of the configuration file with the levels of the loggers, one
+ * setting by line:
+ *
+ *     # Comment
+ *     *.severity = warning, error, fatal
+ *     network.severity = all
+ *     network.enable = false
+ *
+ * The severitys are debug, info, warning, error, fatal, all or none and the
+ * enable flag is true or false. The settings are applied in the order of
+ * the file.
+ */
+class LogConfig {
+
+public:
+    /**
+     * Read the configuration file.
+     *
+     * @param path Path of the configuration file.
+     *
+     * @return Settings of the file, in its order.
+     *
+     * @throws LoggerException
+     *         Error while opening the file.
+     *         Invalid configuration.
+     */
+    static std::vector<LogConfigEntry> load(const std::string & path);
+
+    /**
+     * Read the configuration from a string.
+     *
+     * @param config Content of a configuration file.
+     * @param path Path of the configuration file, used in the errors.
+     *
+     * @return Settings of the configuration, in its order.
+     *
+     * @throws LoggerException
+     *         Invalid configuration.
+     */
+    static std::vector<LogConfigEntry> parse(const std::string & config,
+                                             const std::string & path);
+
+private:
+    /**
+     * Parse a list of severitys separated by commas.
+     *
+     * @param value List of severitys.
+     * @param activeSeverity Output with the bitwise value of the severitys.
+     *
+     * @return True if the list is valid and false otherwise.
+     */
+    static bool parseSeverity(const std::string & value,
+                              int & activeSeverity);
+};
+
+#endif // LOG_CONFIG_
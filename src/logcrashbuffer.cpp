@@ -0,0 +1,221 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Ismael Filipe Mesquita Ribeiro - nakinx
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "logcrashbuffer.h"
+
+#include <algorithm>
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+static const int fatalSignals[] = { SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT };
+static const size_t qtyFatalSignals = sizeof(fatalSignals) / sizeof(fatalSignals[0]);
+static struct sigaction previousActions[qtyFatalSignals];
+static std::once_flag handlersInstalled;
+
+// Fixed registry, the signal handler can't lock nor allocate.
+static const size_t maxCrashBuffers = 64;
+static std::atomic<LogCrashBuffer *> crashBuffers[maxCrashBuffers];
+static std::atomic<bool> isDumping(false);
+
+/**
+ * Write the whole data, only with async-signal-safe calls.
+ *
+ * @param fd Descriptor.
+ * @param data Data to be written.
+ * @param len Length of the data.
+ *
+ * @return True if everything was written and false otherwise.
+ */
+static bool writeAll(const int & fd,
+                     const char * data,
+                     size_t len) {
+    while (len > 0) {
+        ssize_t rc = ::write(fd, data, len);
+
+        if (rc < 0) {
+            if (errno == EINTR)
+                continue;
+
+            return false;
+        }
+
+        data += rc;
+        len -= static_cast<size_t>(rc);
+    }
+
+    return true;
+}
+
+LogCrashBuffer::LogCrashBuffer(const std::string & path,
+                               const size_t & size,
+                               const std::string & banner)
+    : _path(path),
+      _banner(banner),
+      _data(new char[std::max(size, static_cast<size_t>(1))]),
+      _size(std::max(size, static_cast<size_t>(1))),
+      _written(0) {
+    std::call_once(handlersInstalled, [] {
+        struct sigaction action;
+
+        std::memset(&action, 0, sizeof(action));
+        action.sa_handler = &LogCrashBuffer::handleSignal;
+        action.sa_flags = SA_ONSTACK;
+        sigemptyset(&action.sa_mask);
+
+        for (size_t i = 0; i < qtyFatalSignals; i++)
+            sigaction(fatalSignals[i], &action, &previousActions[i]);
+    });
+
+    // Without a free slot the ring is only dumped by fatal records.
+    for (auto & slot : crashBuffers) {
+        LogCrashBuffer * expected = nullptr;
+
+        if (slot.compare_exchange_strong(expected, this))
+            break;
+    }
+}
+
+LogCrashBuffer::~LogCrashBuffer() {
+    for (auto & slot : crashBuffers) {
+        LogCrashBuffer * expected = this;
+
+        if (slot.compare_exchange_strong(expected, nullptr))
+            break;
+    }
+}
+
+void LogCrashBuffer::write(const char * data,
+                           const size_t & len) {
+    std::lock_guard<std::mutex> lk(_mtx);
+
+    size_t length = len;
+
+    // Only the end of a record larger than the ring is kept.
+    if (length > _size) {
+        data += length - _size;
+        length = _size;
+    }
+
+    size_t written = _written.load(std::memory_order_relaxed);
+    size_t pos = written % _size;
+    size_t first = std::min(length, _size - pos);
+
+    std::memcpy(&_data[pos], data, first);
+    std::memcpy(&_data[0], data + first, length - first);
+
+    _written.store(written + length, std::memory_order_release);
+}
+
+size_t LogCrashBuffer::findBegin(const size_t & written) const {
+    if (written <= _size)
+        return 0;
+
+    for (size_t pos = written - _size; pos < written; pos++) {
+        if (_data[pos % _size] == '\n')
+            return pos + 1;
+    }
+
+    return written;
+}
+
+bool LogCrashBuffer::take(std::string & out) {
+    std::lock_guard<std::mutex> lk(_mtx);
+
+    size_t written = _written.load(std::memory_order_relaxed);
+    size_t begin = findBegin(written);
+
+    _written.store(0, std::memory_order_relaxed);
+
+    if (begin == written)
+        return false;
+
+    out += _banner;
+
+    while (begin < written) {
+        size_t pos = begin % _size;
+        size_t len = std::min(written - begin, _size - pos);
+
+        out.append(&_data[pos], len);
+        begin += len;
+    }
+
+    return true;
+}
+
+void LogCrashBuffer::dump() const {
+    size_t written = _written.load(std::memory_order_acquire);
+    size_t begin = findBegin(written);
+
+    if (begin == written)
+        return;
+
+    int fd = ::open(_path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+
+    if (fd < 0)
+        return;
+
+    writeAll(fd, _banner.data(), _banner.length());
+
+    while (begin < written) {
+        size_t pos = begin % _size;
+        size_t len = std::min(written - begin, _size - pos);
+
+        if (!writeAll(fd, &_data[pos], len))
+            break;
+
+        begin += len;
+    }
+
+    ::close(fd);
+}
+
+void LogCrashBuffer::handleSignal(int signal) {
+    int savedErrno = errno;
+
+    // Only the first thread crashing dumps the rings.
+    if (!isDumping.exchange(true)) {
+        for (auto & slot : crashBuffers) {
+            LogCrashBuffer * crashBuffer = slot.load();
+
+            if (crashBuffer != nullptr)
+                crashBuffer->dump();
+        }
+    }
+
+    // The previous handler (usually the default action, terminating the
+    // application) receives the signal when this handler returns.
+    for (size_t i = 0; i < qtyFatalSignals; i++) {
+        if (fatalSignals[i] == signal)
+            sigaction(signal, &previousActions[i], nullptr);
+    }
+
+    errno = savedErrno;
+
+    raise(signal);
+}
@@ -0,0 +1,115 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Ismael Filipe Mesquita Ribeiro - nakinx
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LOG_CRASH_BUFFER_
+#define LOG_CRASH_BUFFER_
+
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+
+/**
+ * Ring in memory with the last records of a logger, including those of
+ * severitys not written to the log file. It's dumped to the log file when a
+ * fatal record is written or when the application receives a fatal signal
+ * (SIGSEGV, SIGBUS, SIGFPE, SIGILL or SIGABRT).
+ *
+ * The memory is allocated once with the size given. The oldest records are
+ * overwritten and the one partially overwritten isn't dumped.
+ */
+class LogCrashBuffer {
+
+public:
+    /**
+     * Constructor, installs the signal handlers on the first call.
+     *
+     * @param path Absolute path of the log file where the ring is dumped.
+     * @param size Size of the ring.
+     * @param banner Line written before the records, may be empty.
+     */
+    LogCrashBuffer(const std::string & path,
+                   const size_t & size,
+                   const std::string & banner);
+
+    /**
+     * Destructor, the ring isn't dumped by the signal handlers anymore.
+     */
+    ~LogCrashBuffer();
+
+    /**
+     * Keep a record, overwriting the oldest ones.
+     *
+     * @param data Record formatted, with its line break.
+     * @param len Length of the record.
+     */
+    void write(const char * data,
+               const size_t & len);
+
+    /**
+     * Move the records kept to the output, preceded by the banner, leaving
+     * the ring empty.
+     *
+     * @param out Output where the records will be appended.
+     *
+     * @return True if there were records and false otherwise.
+     */
+    bool take(std::string & out);
+
+private:
+    LogCrashBuffer(LogCrashBuffer const &) = delete;
+    void operator=(LogCrashBuffer const &) = delete;
+
+    /**
+     * Append the records to the log file, only with async-signal-safe
+     * calls. The ring isn't locked, a thread may be changing it.
+     */
+    void dump() const;
+
+    /**
+     * Find where the records kept begin, skipping the one partially
+     * overwritten.
+     *
+     * @param written Bytes written in the ring.
+     *
+     * @return Position of the first record or written if there is none.
+     */
+    size_t findBegin(const size_t & written) const;
+
+    /**
+     * Dump the rings of all loggers and handle the signal as before.
+     *
+     * @param signal Signal received.
+     */
+    static void handleSignal(int signal);
+
+    std::string _path; ///< Log file where the ring is dumped.
+    std::string _banner; ///< Line written before the records.
+    std::unique_ptr<char[]> _data; ///< Ring of records.
+    size_t _size; ///< Size of the ring.
+    std::atomic<size_t> _written; ///< Bytes written since the ring was emptied.
+    std::mutex _mtx; ///< Protection for multiple threads keeping records.
+};
+
+#endif // LOG_CRASH_BUFFER_
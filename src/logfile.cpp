@@ -0,0 +1,401 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Ismael Filipe Mesquita Ribeiro - nakinx
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "logfile.h"
+
+#include "logexception.h"
+
+#include <algorithm>
+
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <ctime>
+#include <cstdio>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+LogFile::LogFile(const std::string & path,
+                 const FileMode & fileMode,
+                 const std::chrono::milliseconds & checkInterval,
+                 const size_t & windowSize)
+    : _path(path),
+      _fileMode(fileMode),
+      _isPersistent(fileMode != FileMode::Reopen),
+      _checkInterval(checkInterval),
+      _fd(-1),
+      _dev(0),
+      _ino(0),
+      _window(nullptr),
+      _windowOffset(0),
+      _size(0),
+      _rotationSize(0),
+      _rotationInterval(0),
+      _maxFiles(0),
+      _isCompress(false) {
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+
+    // The window must be aligned to pages.
+    _windowSize = ((std::max(windowSize, pageSize) + pageSize - 1) / pageSize) * pageSize;
+}
+
+LogFile::~LogFile() {
+    close();
+}
+
+void LogFile::setRotation(const size_t & rotationSize,
+                          const std::chrono::milliseconds & rotationInterval,
+                          const size_t & maxFiles,
+                          const bool & isCompress) {
+    _rotationSize = rotationSize;
+    _rotationInterval = rotationInterval;
+    _maxFiles = maxFiles;
+    _isCompress = isCompress;
+
+    if ((_rotationSize > 0) || (_rotationInterval.count() > 0))
+        _archiver = LogArchiver::getInstance();
+}
+
+void LogFile::open() {
+    if (_fileMode == FileMode::Mmap)
+        _fd = ::open(_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    else
+        _fd = ::open(_path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+
+    if (_fd < 0)
+        throw LoggerException(2, "Error while opening the file.");
+
+    struct stat st;
+
+    if (fstat(_fd, &st) == 0) {
+        _dev = st.st_dev;
+        _ino = st.st_ino;
+        _size = st.st_size;
+    } else {
+        st.st_size = 0;
+        _size = 0;
+    }
+
+    _lastCheck = std::chrono::steady_clock::now();
+
+    // The age of a file is counted from its creation, or from the first
+    // time it was opened by the application.
+    if ((st.st_size == 0) || (_segmentStart == std::chrono::steady_clock::time_point()))
+        _segmentStart = _lastCheck;
+
+    if (_fileMode == FileMode::Mmap) {
+        recover(st.st_size);
+
+        try {
+            map((_size / _windowSize) * _windowSize);
+        } catch (LoggerException & e) {
+            ::close(_fd);
+            _fd = -1;
+            throw;
+        }
+    }
+}
+
+void LogFile::close() {
+    if (_fd < 0)
+        return;
+
+    if (_fileMode == FileMode::Mmap) {
+        unmap();
+
+        // Remove the zeros of the window not used.
+        if (ftruncate(_fd, _size) != 0) {
+            // Nothing else to do, they're removed when the file is opened.
+        }
+    }
+
+    ::close(_fd);
+    _fd = -1;
+}
+
+void LogFile::recover(const off_t & fileSize) {
+    char buffer[4096];
+    off_t end = fileSize;
+
+    _size = 0;
+
+    while (end > 0) {
+        off_t begin = std::max<off_t>(0, end - sizeof(buffer));
+        ssize_t rc = pread(_fd, buffer, end - begin, begin);
+
+        if (rc <= 0)
+            break;
+
+        for (ssize_t i = rc - 1; i >= 0; i--) {
+            if (buffer[i] != '\0') {
+                _size = begin + i + 1;
+                end = 0;
+                break;
+            }
+        }
+
+        if (end != 0)
+            end = begin;
+    }
+
+    if ((_size < fileSize) && (ftruncate(_fd, _size) != 0))
+        throw LoggerException(2, "Error while opening the file.");
+}
+
+void LogFile::map(const off_t & offset) {
+    int rc = posix_fallocate(_fd, offset, _windowSize);
+
+    if (rc != 0)
+        throw LoggerException(3, "Error while writing in the file.");
+
+    void * window = mmap(nullptr, _windowSize, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, offset);
+
+    if (window == MAP_FAILED)
+        throw LoggerException(3, "Error while writing in the file.");
+
+    _window = static_cast<char *>(window);
+    _windowOffset = offset;
+}
+
+void LogFile::unmap() {
+    if (_window == nullptr)
+        return;
+
+    munmap(_window, _windowSize);
+    _window = nullptr;
+}
+
+void LogFile::copy(const struct iovec * iov,
+                   int qtyIov) {
+    for (int i = 0; i < qtyIov; i++) {
+        const char * data = static_cast<const char *>(iov[i].iov_base);
+        size_t len = iov[i].iov_len;
+
+        while (len > 0) {
+            off_t windowEnd = _windowOffset + _windowSize;
+
+            if (_size >= windowEnd) {
+                // Window is full, map the next one.
+                unmap();
+                map(windowEnd);
+            }
+
+            size_t qtyCopy = std::min<size_t>(len, windowEnd - _size);
+
+            memcpy(_window + (_size - _windowOffset), data, qtyCopy);
+
+            _size += qtyCopy;
+            data += qtyCopy;
+            len -= qtyCopy;
+        }
+    }
+}
+
+bool LogFile::isRotationDue(const struct iovec * iov,
+                            int qtyIov) {
+    if (_size == 0)
+        return false; // Never rotate an empty file.
+
+    if (_rotationSize > 0) {
+        size_t len = 0;
+
+        for (int i = 0; i < qtyIov; i++)
+            len += iov[i].iov_len;
+
+        if ((static_cast<size_t>(_size) + len) > _rotationSize)
+            return true;
+    }
+
+    return ((_rotationInterval.count() > 0) &&
+            ((std::chrono::steady_clock::now() - _segmentStart) >= _rotationInterval));
+}
+
+void LogFile::rotate() {
+    close();
+
+    char stamp[32];
+    time_t now = time(nullptr);
+    struct tm tmNow;
+
+    localtime_r(&now, &tmNow);
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &tmNow);
+
+    // Files rotated in the same second get a sequence.
+    std::string segment = _path + "." + stamp;
+    struct stat st;
+
+    for (int seq = 1; (stat(segment.c_str(), &st) == 0) || (stat((segment + ".gz").c_str(), &st) == 0); seq++)
+        segment = _path + "." + stamp + "." + std::to_string(seq);
+
+    if (std::rename(_path.c_str(), segment.c_str()) != 0) {
+        // Keep writing in the same file, it's tried again on the next write.
+        open();
+        return;
+    }
+
+    _segmentStart = std::chrono::steady_clock::time_point();
+
+    open();
+
+    _archiver->push(segment, _path, _maxFiles, _isCompress);
+}
+
+void LogFile::reopen() {
+    close();
+    open();
+}
+
+void LogFile::flush() {
+    if (_fd < 0)
+        return;
+
+    if (_window != nullptr)
+        msync(_window, _windowSize, MS_SYNC);
+
+    fdatasync(_fd);
+}
+
+bool LogFile::wasMoved() {
+    auto now = std::chrono::steady_clock::now();
+
+    if ((now - _lastCheck) < _checkInterval)
+        return false;
+
+    _lastCheck = now;
+
+    struct stat st;
+
+    if (stat(_path.c_str(), &st) != 0)
+        return true; // File was removed.
+
+    return ((st.st_dev != _dev) || (st.st_ino != _ino));
+}
+
+void LogFile::write(const char * data,
+                    const size_t & len) {
+    struct iovec iov = { const_cast<char *>(data), len };
+
+    write(&iov, 1);
+}
+
+bool LogFile::prepare(const struct iovec * iov,
+                      int qtyIov) {
+    if (_fd < 0)
+        open();
+    else if (_isPersistent && wasMoved())
+        reopen();
+
+    if (_archiver && isRotationDue(iov, qtyIov))
+        rotate();
+
+    return (_size == 0);
+}
+
+void LogFile::write(struct iovec * iov,
+                    int qtyIov) {
+    prepare(iov, qtyIov);
+
+    if (_fileMode == FileMode::Mmap) {
+        copy(iov, qtyIov);
+        return;
+    }
+
+    // Skip empty fragments, the loop below stops on them.
+    while ((qtyIov > 0) && (iov->iov_len == 0)) {
+        iov++;
+        qtyIov--;
+    }
+
+    while (qtyIov > 0) {
+        ssize_t rc = ::writev(_fd, iov, std::min(qtyIov, IOV_MAX));
+
+        if (rc < 0) {
+            if (errno == EINTR)
+                continue;
+
+            if (!_isPersistent)
+                close();
+
+            throw LoggerException(3, "Error while writing in the file.");
+        }
+
+        _qtyWrites.add();
+        _size += rc;
+
+        // Advance over the fragments written, a partial write continues in
+        // the middle of a fragment.
+        size_t written = rc;
+
+        while ((qtyIov > 0) && (written >= iov->iov_len)) {
+            written -= iov->iov_len;
+            iov++;
+            qtyIov--;
+        }
+
+        if (qtyIov > 0) {
+            iov->iov_base = static_cast<char *>(iov->iov_base) + written;
+            iov->iov_len -= written;
+        }
+    }
+
+    if (!_isPersistent)
+        close();
+}
+
+bool LogFile::writeShared(const struct iovec * iov,
+                          int qtyIov) {
+    // The check if the file was moved is left to write().
+    if ((_fd < 0) || ((std::chrono::steady_clock::now() - _lastCheck) >= _checkInterval))
+        return false;
+
+    ssize_t rc = ::writev(_fd, iov, qtyIov);
+
+    if (rc < 0) {
+        if (errno == EINTR)
+            return false;
+
+        throw LoggerException(3, "Error while writing in the file.");
+    }
+
+    _qtyWrites.add();
+
+    // Only short of space. The rest can't follow, the other threads may
+    // have written after the part written.
+    size_t qtyBytes = 0;
+
+    for (int i = 0; i < qtyIov; i++)
+        qtyBytes += iov[i].iov_len;
+
+    if (static_cast<size_t>(rc) < qtyBytes)
+        throw LoggerException(3, "Record written partially in the file.");
+
+    return true;
+}
+
+unsigned long long LogFile::getQtyWrites() const {
+    return _qtyWrites.get();
+}
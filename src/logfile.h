@@ -0,0 +1,282 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Ismael Filipe Mesquita Ribeiro - nakinx
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LOG_FILE_
+#define LOG_FILE_
+
+#include "logsetting.h"
+#include "logarchiver.h"
+#include "logmetrics.h"
+
+#include <string>
+#include <chrono>
+#include <memory>
+#include <atomic>
+
+#include <sys/types.h>
+#include <sys/uio.h>
+
+/**
+ * Class responsable to keep the log file descriptor and write the records
+ * into it.
+ *
+ * In persistent mode the file is opened once and kept open, it's only
+ * reopened when requested or when the file was moved/removed (e.g. by an
+ * external log rotation). Otherwise the file is opened and closed for each
+ * record.
+ *
+ * In memory-mapped mode the file is kept open as in persistent mode, but
+ * it's extended a window at a time and the records are copied into the
+ * window mapped in memory, without any system call. The kernel writes the
+ * pages back to the file, so the records survive a crash of the application
+ * (not of the system, unless flushed). While the file is open, or after a
+ * crash, it ends with the zeros of the window not used yet, they're removed
+ * when the file is closed or opened again.
+ *
+ * With rotation the file is renamed to "<file>.YYYYmmdd-HHMMSS" when it
+ * reaches a size or an age, before the write that would exceed it, and a
+ * new file is created in its place. The file rotated is handed to the
+ * archiver, which compresses it and removes the oldest ones out of the
+ * logging path.
+ */
+class LogFile {
+
+public:
+    /**
+     * Constructor, the file is only opened on the first write.
+     *
+     * @param path Absolute path of the log file.
+     * @param fileMode How the file is handled.
+     * @param checkInterval Interval between checks if the file was moved.
+     * @param windowSize Size of the window mapped in memory-mapped mode.
+     */
+    LogFile(const std::string & path,
+            const FileMode & fileMode,
+            const std::chrono::milliseconds & checkInterval,
+            const size_t & windowSize);
+
+    /**
+     * Destructor, closes the file.
+     */
+    ~LogFile();
+
+    /**
+     * Enable the rotation of the file.
+     *
+     * @param rotationSize Size that triggers the rotation, 0 to disable.
+     * @param rotationInterval Age that triggers the rotation, 0 to disable.
+     * @param maxFiles Quantity of files rotated retained, 0 to keep all.
+     * @param isCompress Compress the files rotated.
+     */
+    void setRotation(const size_t & rotationSize,
+                     const std::chrono::milliseconds & rotationInterval,
+                     const size_t & maxFiles,
+                     const bool & isCompress);
+
+    /**
+     * Open the file, or rotate it, as the next write of the fragments
+     * would do.
+     *
+     * @param iov Fragments to be written.
+     * @param qtyIov Quantity of fragments.
+     *
+     * @return True if the file is empty and false otherwise.
+     *
+     * @throws LoggerException
+     *         Error while opening the file.
+     */
+    bool prepare(const struct iovec * iov,
+                 int qtyIov);
+
+    /**
+     * Write the data into the file.
+     *
+     * @param data Data to be written.
+     * @param len Length of data.
+     *
+     * @throws LoggerException
+     *         Error while opening the file.
+     *         Error while writing in the file.
+     */
+    void write(const char * data,
+               const size_t & len);
+
+    /**
+     * Write the fragments into the file with as few system calls as
+     * possible, usually one.
+     *
+     * @param iov Fragments to be written, they're changed to track partial
+     *            writes.
+     * @param qtyIov Quantity of fragments.
+     *
+     * @throws LoggerException
+     *         Error while opening the file.
+     *         Error while writing in the file.
+     */
+    void write(struct iovec * iov,
+               int qtyIov);
+
+    /**
+     * Write the fragments of a record into the file opened, with a single
+     * system call, while other threads may do the same. The file is opened
+     * in append mode, so the kernel gives each write its own place at the
+     * end of the file. Only for a persistent file without rotation; the
+     * file must not be written, reopened or closed by the other methods at
+     * the same time.
+     *
+     * @param iov Fragments to be written.
+     * @param qtyIov Quantity of fragments.
+     *
+     * @return True if written and false if nothing was written because the
+     *         file must be opened or checked first (see write()).
+     *
+     * @throws LoggerException
+     *         Error while writing in the file, or only a part of the record
+     *         was written (e.g. the disk is full).
+     */
+    bool writeShared(const struct iovec * iov,
+                     int qtyIov);
+
+    /**
+     * Return the quantity of system calls used to write in the file.
+     *
+     * @return Quantity of writes.
+     */
+    unsigned long long getQtyWrites() const;
+
+    /**
+     * Commit the records already written to the storage device.
+     */
+    void flush();
+
+    /**
+     * Close the current file and open it again.
+     *
+     * @throws LoggerException
+     *         Error while opening the file.
+     */
+    void reopen();
+
+    /**
+     * Close the file.
+     */
+    void close();
+
+private:
+    LogFile(LogFile const &) = delete;
+    void operator=(LogFile const &) = delete;
+
+    /**
+     * Open the file in append mode.
+     *
+     * @throws LoggerException
+     *         Error while opening the file.
+     */
+    void open();
+
+    /**
+     * Check if the file opened was moved or removed from the path.
+     *
+     * @return True if the file was moved and false otherwise.
+     */
+    bool wasMoved();
+
+    /**
+     * Check if the file must be rotated before writing the fragments.
+     *
+     * @param iov Fragments to be written.
+     * @param qtyIov Quantity of fragments.
+     *
+     * @return True if the file must be rotated and false otherwise.
+     */
+    bool isRotationDue(const struct iovec * iov,
+                       int qtyIov);
+
+    /**
+     * Rename the file, open a new one in its place and hand the file
+     * rotated to the archiver. If the file can't be renamed, the records
+     * keep being written to it.
+     *
+     * @throws LoggerException
+     *         Error while opening the file.
+     */
+    void rotate();
+
+    /**
+     * Find the end of the records in a file left with the zeros of a window
+     * not used (e.g. after a crash) and remove them.
+     *
+     * @param fileSize Size of the file.
+     */
+    void recover(const off_t & fileSize);
+
+    /**
+     * Extend the file and map the window starting at the given offset.
+     *
+     * @param offset Begin of the window, multiple of the page size.
+     *
+     * @throws LoggerException
+     *         Error while writing in the file.
+     */
+    void map(const off_t & offset);
+
+    /**
+     * Unmap the current window.
+     */
+    void unmap();
+
+    /**
+     * Copy the fragments into the windows mapped.
+     *
+     * @param iov Fragments to be written.
+     * @param qtyIov Quantity of fragments.
+     *
+     * @throws LoggerException
+     *         Error while writing in the file.
+     */
+    void copy(const struct iovec * iov,
+              int qtyIov);
+
+    std::string _path; ///< Absolute path of the log file.
+    FileMode _fileMode; ///< How the file is handled.
+    bool _isPersistent; ///< Keep the file open between records.
+    std::chrono::milliseconds _checkInterval; ///< Interval between checks if the file was moved.
+    std::chrono::steady_clock::time_point _lastCheck; ///< Last time the file was checked.
+    int _fd; ///< File descriptor, -1 when closed.
+    dev_t _dev; ///< Device of the opened file.
+    ino_t _ino; ///< Inode of the opened file.
+    LogThreadCounter _qtyWrites; ///< System calls used to write in the file.
+    size_t _windowSize; ///< Size of the window mapped.
+    char * _window; ///< Window mapped, nullptr when not mapped.
+    off_t _windowOffset; ///< Offset of the window in the file.
+    off_t _size; ///< Size of the records written in the file, except by writeShared().
+    size_t _rotationSize; ///< Size that triggers the rotation, 0 to disable.
+    std::chrono::milliseconds _rotationInterval; ///< Age that triggers the rotation, 0 to disable.
+    size_t _maxFiles; ///< Quantity of files rotated retained, 0 to keep all.
+    bool _isCompress; ///< Compress the files rotated.
+    std::chrono::steady_clock::time_point _segmentStart; ///< Time the current file was started.
+    std::shared_ptr<LogArchiver> _archiver; ///< Archiver of the files rotated, only with rotation.
+};
+
+#endif // LOG_FILE_
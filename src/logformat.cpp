@@ -0,0 +1,287 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Ismael Filipe Mesquita Ribeiro - nakinx
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "logformat.h"
+#include "logstream.h"
+
+#include <atomic>
+
+thread_local LogFormat::DateCache LogFormat::_dateCache[LogFormat::DateCacheSize];
+thread_local size_t LogFormat::_dateCacheNext = 0;
+
+static std::atomic<unsigned long> formatIds(0);
+
+LogFormat::LogFormat(const std::string & format,
+                     LogInfoRenderer renderer) {
+    compile(format, renderer);
+}
+
+void LogFormat::append(const TokenType & type,
+                       const std::string & text) {
+    if ((type == TokenType::Literal || type == TokenType::Date) &&
+        (_tokens.size() > 0) && (_tokens.back().type == type)) {
+        _tokens.back().text += text;
+        return;
+    }
+
+    _tokens.push_back(Token { type, text });
+}
+
+void LogFormat::compile(const std::string & format,
+                        LogInfoRenderer renderer) {
+    bool isDate = false;
+
+    _format = format;
+    _tokens.clear();
+    _renderer = renderer;
+    _hasDate = false;
+    _id = ++formatIds; // Invalidate the date/time cached.
+
+    for (size_t i = 0; i < format.length(); i++) {
+        if (isDate) {
+            if (format[i] == '}') {
+                // End of date/time.
+                isDate = false;
+            } else if ((format[i] == '%') && ((i + 1) < format.length())) {
+                i++;
+
+                if (format[i] == 'q')
+                    append(TokenType::Milliseconds, "");
+                else
+                    append(TokenType::Date, std::string("%") + format[i]);
+            } else if (format[i] == '%') {
+                append(TokenType::Literal, "%");
+            } else {
+                // Literals inside date are formatted with the date to reduce
+                // the number of tokens.
+                append(TokenType::Date, std::string(1, format[i]));
+            }
+
+            continue;
+        }
+
+        if ((format[i] != '%') || ((i + 1) >= format.length())) {
+            append(TokenType::Literal, std::string(1, format[i]));
+            continue;
+        }
+
+        i++;
+
+        switch (format[i]) {
+            case 'D' :
+                if (((i + 1) < format.length()) && (format[i + 1] == '{')) {
+                    // Begin of date/time.
+                    isDate = true;
+                    _hasDate = true;
+                    i++;
+                } else {
+                    append(TokenType::Literal, "%D");
+                }
+                break;
+            case 'F' : append(TokenType::File, ""); break;
+            case 'M' : append(TokenType::Function, ""); break;
+            case 'L' : append(TokenType::Line, ""); break;
+            case 'S' : append(TokenType::Severity, ""); break;
+            case '%' : append(TokenType::Literal, "%"); break;
+            default : append(TokenType::Literal, std::string("%") + format[i]); break;
+        }
+    }
+}
+
+const LogFormat::DateCache & LogFormat::getDates(const std::chrono::system_clock::time_point & time) const {
+    std::time_t tt = std::chrono::system_clock::to_time_t(time);
+    DateCache * cache = nullptr;
+
+    for (size_t i = 0; i < DateCacheSize; i++) {
+        if (_dateCache[i].formatId == _id) {
+            if (_dateCache[i].second == tt)
+                return _dateCache[i];
+
+            cache = &_dateCache[i];
+            break;
+        }
+    }
+
+    if (cache == nullptr) {
+        cache = &_dateCache[_dateCacheNext];
+        _dateCacheNext = (_dateCacheNext + 1) % DateCacheSize;
+    }
+
+    char sv[128];
+    std::tm tm;
+
+    localtime_r(&tt, &tm);
+
+    cache->formatId = _id;
+    cache->second = tt;
+    cache->text.clear();
+    cache->ends.clear();
+
+    for (const Token & token : _tokens) {
+        if (token.type == TokenType::Date) {
+            cache->text.append(sv, std::strftime(sv, sizeof(sv), token.text.c_str(), &tm));
+            cache->ends.push_back(cache->text.length());
+        }
+    }
+
+    return *cache;
+}
+
+void LogFormat::render(std::string & out,
+                       const std::chrono::system_clock::time_point & time,
+                       std::string_view file,
+                       std::string_view function,
+                       const int & line,
+                       std::string_view severity) const {
+    if (_renderer != nullptr) {
+        _renderer(out, time, file, function, line, severity);
+        return;
+    }
+
+    const DateCache * dates = nullptr;
+    size_t dateBegin = 0;
+    size_t dateIndex = 0;
+
+    if (_hasDate)
+        dates = &getDates(time);
+
+    for (const Token & token : _tokens) {
+        switch (token.type) {
+            case TokenType::Literal :
+                out += token.text;
+                break;
+            case TokenType::Date :
+                out.append(dates->text, dateBegin, dates->ends[dateIndex] - dateBegin);
+                dateBegin = dates->ends[dateIndex++];
+                break;
+            case TokenType::Milliseconds :
+                appendMilliseconds(out, time);
+                break;
+            case TokenType::File :
+                out += file;
+                break;
+            case TokenType::Function :
+                out += function;
+                break;
+            case TokenType::Line : {
+                char number[24];
+                out.append(number, LogStream::formatDecimal(number, line) - number);
+                break;
+            }
+            case TokenType::Severity :
+                out += severity;
+                break;
+        }
+    }
+}
+
+void LogFormat::appendMilliseconds(std::string & out,
+                                   const std::chrono::system_clock::time_point & time) {
+    char ms[24];
+    int value = std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count() % 1000;
+
+    out.append(ms, LogStream::formatDecimal(ms, value) - ms);
+}
+
+void LogFormat::compileSite(LogSiteHeader & header,
+                            std::string_view file,
+                            std::string_view function,
+                            const int & line,
+                            std::string_view severity) const {
+    header.formatId = _id;
+    header.text.clear();
+    header.ends.clear();
+
+    for (const Token & token : _tokens) {
+        switch (token.type) {
+            case TokenType::Literal :
+                header.text += token.text;
+                break;
+            case TokenType::Date :
+            case TokenType::Milliseconds :
+                header.ends.push_back(header.text.length());
+                break;
+            case TokenType::File :
+                header.text += file;
+                break;
+            case TokenType::Function :
+                header.text += function;
+                break;
+            case TokenType::Line : {
+                char number[24];
+                header.text.append(number, LogStream::formatDecimal(number, line) - number);
+                break;
+            }
+            case TokenType::Severity :
+                header.text += severity;
+                break;
+        }
+    }
+}
+
+void LogFormat::render(std::string & out,
+                       const LogSiteHeader & header,
+                       const std::chrono::system_clock::time_point & time) const {
+    const DateCache * dates = nullptr;
+    size_t dateBegin = 0;
+    size_t dateIndex = 0;
+    size_t begin = 0;
+    size_t part = 0;
+
+    if (_hasDate)
+        dates = &getDates(time);
+
+    for (const Token & token : _tokens) {
+        if ((token.type != TokenType::Date) && (token.type != TokenType::Milliseconds))
+            continue;
+
+        out.append(header.text, begin, header.ends[part] - begin);
+        begin = header.ends[part++];
+
+        if (token.type == TokenType::Milliseconds) {
+            appendMilliseconds(out, time);
+        } else {
+            out.append(dates->text, dateBegin, dates->ends[dateIndex] - dateBegin);
+            dateBegin = dates->ends[dateIndex++];
+        }
+    }
+
+    out.append(header.text, begin, std::string::npos);
+}
+
+unsigned long LogFormat::getId() const {
+    return _id;
+}
+
+bool LogFormat::isEmpty() const {
+    return _tokens.empty();
+}
+
+bool LogFormat::isStatic() const {
+    return (_renderer != nullptr);
+}
+
+const std::string & LogFormat::getFormat() const {
+    return _format;
+}
@@ -0,0 +1,227 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Ismael Filipe Mesquita Ribeiro - nakinx
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LOG_FORMAT_
+#define LOG_FORMAT_
+
+#include "logstaticformat.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <chrono>
+#include <ctime>
+
+/**
+ * Header of a call site rendered with a compiled format, except the
+ * date/time tokens that change with each record.
+ */
+struct LogSiteHeader {
+    unsigned long formatId; ///< Compiled format which the header belongs.
+    std::string text; ///< Parts of the header between the date/time tokens, one after the other.
+    std::vector<size_t> ends; ///< End of the part before each date/time token in the text.
+};
+
+/**
+ * Info format compiled in a sequence of tokens, so the header of each
+ * record is built without parsing the format again.
+ *
+ * The date/time tokens are rendered once per second and kept in a cache per
+ * thread, records created in the same second only copy them and append the
+ * milliseconds.
+ *
+ * The specifiers are the same accepted by Logger::setInfoFormat(), use %%
+ * to write a '%'. A format compiled with the renderer of a LogStaticFormat
+ * is rendered by it, the tokens compiled at runtime are kept for the call
+ * sites.
+ */
+class LogFormat {
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param format String containing specifiers with log informations.
+     * @param renderer Renderer of the format parsed at compile time, if any.
+     */
+    explicit LogFormat(const std::string & format = "",
+                       LogInfoRenderer renderer = nullptr);
+
+    /**
+     * Compile the format replacing the current one.
+     *
+     * @param format String containing specifiers with log informations.
+     * @param renderer Renderer of the format parsed at compile time, if any.
+     */
+    void compile(const std::string & format,
+                 LogInfoRenderer renderer = nullptr);
+
+    /**
+     * Append the header of the record into the output.
+     *
+     * @param out Output where the header will be appended.
+     * @param time When the record was created.
+     * @param file File where logger was invoked.
+     * @param function Function where logger was invoked.
+     * @param line Line where logger was invoked.
+     * @param severity Name of the severity of the record.
+     */
+    void render(std::string & out,
+                const std::chrono::system_clock::time_point & time,
+                std::string_view file,
+                std::string_view function,
+                const int & line,
+                std::string_view severity) const;
+
+    /**
+     * Render everything but the date/time of the header of a call site,
+     * which never changes for the compiled format.
+     *
+     * @param header Output with the header of the call site.
+     * @param file File where logger was invoked.
+     * @param function Function where logger was invoked.
+     * @param line Line where logger was invoked.
+     * @param severity Name of the severity of the record.
+     */
+    void compileSite(LogSiteHeader & header,
+                     std::string_view file,
+                     std::string_view function,
+                     const int & line,
+                     std::string_view severity) const;
+
+    /**
+     * Append the header of a record of the call site into the output, only
+     * the date/time tokens are rendered. The output is the same of render()
+     * with the data of the call site.
+     *
+     * @param out Output where the header will be appended.
+     * @param header Header of the call site compiled with this format.
+     * @param time When the record was created.
+     */
+    void render(std::string & out,
+                const LogSiteHeader & header,
+                const std::chrono::system_clock::time_point & time) const;
+
+    /**
+     * Return the unique id of the compiled format, changed by compile().
+     *
+     * @return Id of the compiled format.
+     */
+    unsigned long getId() const;
+
+    /**
+     * Check if the format doesn't produce any header.
+     *
+     * @return True if there is no token and false otherwise.
+     */
+    bool isEmpty() const;
+
+    /**
+     * Check if the format is rendered by a LogStaticFormat.
+     *
+     * @return True if the format has a renderer and false otherwise.
+     */
+    bool isStatic() const;
+
+    /**
+     * Return the format compiled.
+     *
+     * @return String containing specifiers with log informations.
+     */
+    const std::string & getFormat() const;
+
+private:
+    /**
+     * Types of token in the compiled format.
+     */
+    enum class TokenType {
+        Literal, ///< Text copied as it's.
+        Date, ///< strftime() format of a date/time.
+        Milliseconds, ///< Milliseconds of the record time.
+        File, ///< File where logger was invoked.
+        Function, ///< Function where logger was invoked.
+        Line, ///< Line where logger was invoked.
+        Severity ///< Severity of the record.
+    };
+
+    /**
+     * Token of the compiled format.
+     */
+    struct Token {
+        TokenType type; ///< Type of the token.
+        std::string text; ///< Text of literals and strftime() format of dates.
+    };
+
+    /**
+     * Cache of the date/time tokens rendered in a given second.
+     */
+    struct DateCache {
+        unsigned long formatId = 0; ///< Compiled format which the cache belongs.
+        std::time_t second = 0; ///< Second rendered.
+        std::string text; ///< Date/time tokens rendered one after the other.
+        std::vector<size_t> ends; ///< End of each date/time token in the text.
+    };
+
+    /**
+     * Get the date/time tokens rendered for the second of the given time,
+     * rendering them only if the second isn't in the cache of the thread.
+     *
+     * @param time When the record was created.
+     *
+     * @return Cache with the date/time tokens rendered.
+     */
+    const DateCache & getDates(const std::chrono::system_clock::time_point & time) const;
+
+    /**
+     * Add a text to the last token if it has the same type or create a new
+     * token otherwise.
+     *
+     * @param type Type of the token.
+     * @param text Text to be added.
+     */
+    void append(const TokenType & type,
+                const std::string & text);
+
+    /**
+     * Append the milliseconds of the time, without leading zeros.
+     *
+     * @param out Output where the milliseconds will be appended.
+     * @param time When the record was created.
+     */
+    static void appendMilliseconds(std::string & out,
+                                   const std::chrono::system_clock::time_point & time);
+
+    static const size_t DateCacheSize = 4; ///< Formats cached per thread.
+
+    static thread_local DateCache _dateCache[DateCacheSize]; ///< Date/time rendered by the thread.
+    static thread_local size_t _dateCacheNext; ///< Next cache entry to be replaced.
+
+    std::string _format; ///< Format compiled.
+    std::vector<Token> _tokens; ///< Compiled format.
+    LogInfoRenderer _renderer; ///< Renderer of the format parsed at compile time.
+    bool _hasDate; ///< Format needs the local time of the record.
+    unsigned long _id; ///< Unique id of the compiled format used by the cache.
+};
+
+#endif // LOG_FORMAT_
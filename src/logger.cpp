@@ -31,38 +31,167 @@
 #include <sstream>
 #include <vector>
 #include <iterator>
-#include <fstream>
 #include <chrono>
 #include <ctime>
 #include <iomanip>
+#include <algorithm>
 
 #include <cstring>
+#include <cstdio>
+
+static std::atomic<unsigned long> loggerIds(0);
+
+/**
+ * Buffers of the thread in each logger, when the thread exits they're left
+ * to be written by the logger.
+ */
+struct ThreadBuffers {
+    std::vector<std::pair<unsigned long, std::shared_ptr<LogThreadBuffer>>> buffers; ///< Buffer of each logger id.
+
+    ~ThreadBuffers() {
+        for (auto & buffer : buffers) {
+            std::lock_guard<std::mutex> lk(buffer.second->mtx);
+            buffer.second->isOrphan = true;
+        }
+    }
+};
 
 Logger::Logger(const LogSetting & logSetting)
-    : _logSetting(logSetting) {
+    : _logSetting(logSetting),
+      _logFile(_logSetting.getPath() + _logSetting.getName(),
+               _logSetting.getFileMode(),
+               _logSetting.getFileCheckInterval(),
+               _logSetting.getMmapWindowSize()),
+      _infoFormat(nullptr),
+      _isShared(false),
+      _hasSinks(false),
+      _isClosed(false),
+      _isEnable(_logSetting.isEnable()),
+      _activeSeverity(0),
+      _isReleased(false),
+      _isBinary(_logSetting.getOutputFormat() == OutputFormat::Binary),
+      _isJson(_logSetting.getOutputFormat() == OutputFormat::Json),
+      _isFormatPending(true),
+      _crashSeverity(0),
+      _isWriterRunning(false),
+      _isWriterSleeping(false),
+      _qtyQueued(0),
+      _qtyDone(0),
+      _qtyDropped(0),
+      _id(++loggerIds),
+      _queueHighWater(0),
+      _lockWaitTime(0) {
     enableAllSeverity();
+
+    _infoFormats.emplace_back(new LogFormat(_logSetting.getInfo(), _logSetting.getInfoRenderer()));
+    _infoFormat.store(_infoFormats.back().get(), std::memory_order_release);
+
+    for (auto & field : _logSetting.getFields())
+        LogJson::appendField(_jsonFields, field.first, field.second);
+
+    _logFile.setRotation(_logSetting.getRotationSize(),
+                         _logSetting.getRotationInterval(),
+                         _logSetting.getMaxFiles(),
+                         _logSetting.isCompress());
+
+    // The records of the ring would need the sites to be decoded.
+    if ((_logSetting.getCrashBufferSize() > 0) && !_isBinary) {
+        std::string banner;
+
+        if (!_isJson)
+            banner = "----- Crash buffer of the logger (" + _logSetting.getName() + ") -----\n";
+
+        _crashBuffer.reset(new LogCrashBuffer(_logSetting.getPath() + _logSetting.getName(),
+                                              _logSetting.getCrashBufferSize(), banner));
+        _crashSeverity = _logSetting.getCrashSeverity();
+    }
+
+    // The kernel appends each write at the end of the file by itself, but
+    // the binary dictionary, the window mapped and the rotation are shared.
+    _isShared = (_logSetting.getWriteMode() == WriteMode::Sync) && !_isBinary &&
+                (_logSetting.getFileMode() == FileMode::Persistent) &&
+                (_logSetting.getRotationSize() == 0) && (_logSetting.getRotationInterval().count() == 0);
+
+    if (_logSetting.getRateLimit() > 0)
+        _rateLimiter.reset(new LogRateLimiter(_logSetting.getRateLimit(), _logSetting.getRateBurst()));
+
+    if (_logSetting.getWriteMode() == WriteMode::Async) {
+        _records.resize(BatchSize);
+        _headerEnds.resize(BatchSize);
+        _iov.resize(3 * BatchSize);
+        _queue.reset(new LogQueue<LogRecord>(_logSetting.getQueueCapacity()));
+        _isWriterRunning = true;
+        _writer = std::thread(&Logger::writerLoop, this);
+    } else if (_logSetting.getWriteMode() == WriteMode::Buffered) {
+        _isWriterRunning = true;
+        _writer = std::thread(&Logger::flusherLoop, this);
+    }
 }
 
 Logger::~Logger() {
+    close();
+}
+
+void Logger::close() {
+    // The records suppressed are reported while the logger still writes.
+    if (_rateLimiter && !_isClosed.load()) {
+        try {
+            writeSuppressed(true);
+        } catch (LoggerException & e) {
+            std::cerr << "Logger (" << _logSetting.getName() << "): " << e.what() << "\n";
+        }
+    }
+
+    _isClosed.store(true);
+
+    stopWriter();
+
+    if (_logSetting.getWriteMode() == WriteMode::Buffered) {
+        try {
+            writeBuffers(true);
+        } catch (LoggerException & e) {
+            std::cerr << "Logger (" << _logSetting.getName() << "): " << e.what() << "\n";
+        }
+    }
+
+    std::lock_guard<std::mutex> lk(_mtxLog);
+    std::unique_lock<LogSharedGate> lkShared = lockShared();
+
+    _logFile.close();
+    _isReleased = true;
+
+    for (auto & sink : _sinks)
+        sink->flush();
+
+    _sinks.clear();
+    _hasSinks.store(false, std::memory_order_relaxed);
 }
 
 bool Logger::checkActiveSeverity(const SeverityLevel & sl) {
-    if (_logSetting.getActiveSeverity() & static_cast<int>(sl))
+    if (_activeSeverity.load(std::memory_order_relaxed) & static_cast<int>(sl))
         return true;
 
     return false;
 }
 
 void Logger::setActiveSeverity(const int & as) {
-    _logSetting.setActiveSeverity(as);
+    _activeSeverity.store(as, std::memory_order_relaxed);
 }
 
 void Logger::addActiveSeverity(const int & as) {
-    _logSetting.setActiveSeverity(_logSetting.getActiveSeverity() | as);
+    _activeSeverity.fetch_or(as, std::memory_order_relaxed);
 }
 
 void Logger::rmActiveSeverity(const int & as) {
-    _logSetting.setActiveSeverity(_logSetting.getActiveSeverity() ^ as);
+    _activeSeverity.fetch_and(~as, std::memory_order_relaxed);
+}
+
+int Logger::getActiveSeverity() const {
+    return _activeSeverity.load(std::memory_order_relaxed);
+}
+
+bool Logger::isEnable() const {
+    return _isEnable.load(std::memory_order_relaxed);
 }
 
 void Logger::enableAllSeverity() {
@@ -81,123 +210,946 @@ void Logger::setDebugSeverityEnable(const bool & isEnable) {
 }
 
 void Logger::setEnable(const bool & isEnable) {
-    _logSetting.setEnable(isEnable);
+    _isEnable.store(isEnable, std::memory_order_relaxed);
 }
 
 void Logger::setInfoFormat(const std::string & infoFormat) {
-    _logSetting.setInfo(infoFormat);
+    setInfoFormat(infoFormat, nullptr);
+}
+
+void Logger::setInfoFormat(const std::string & infoFormat,
+                           LogInfoRenderer infoRenderer) {
+    std::lock_guard<std::mutex> lk(_mtxLog);
+
+    _logSetting.setInfo(infoFormat, infoRenderer);
+    _isFormatPending = true;
+
+    // The buffered, crash and writer threads render with the format without
+    // a lock, so a format replaced is kept, and reused if set again.
+    for (auto & format : _infoFormats) {
+        if ((format->getFormat() == infoFormat) && (format->isStatic() == (infoRenderer != nullptr))) {
+            _infoFormat.store(format.get(), std::memory_order_release);
+            return;
+        }
+    }
+
+    _infoFormats.emplace_back(new LogFormat(infoFormat, infoRenderer));
+    _infoFormat.store(_infoFormats.back().get(), std::memory_order_release);
 }
 
 bool Logger::write(const SeverityLevel sl,
-                   const std::string file,
-                   const std::string function,
+                   std::string_view file,
+                   std::string_view function,
                    const int line,
-                   const std::string msg) {
-    if (!_logSetting.isEnable())
+                   std::string_view msg) {
+    return submit(sl, file, function, line, msg, nullptr);
+}
+
+bool Logger::write(const LogCallSite & site,
+                   std::string_view msg) {
+    return submit(site.getSeverity(), site.getFile(), site.getFunction(), site.getLine(), msg, &site);
+}
+
+bool Logger::submit(const SeverityLevel & sl,
+                    std::string_view file,
+                    std::string_view function,
+                    const int & line,
+                    std::string_view msg,
+                    const LogCallSite * site) {
+    if (!isEnable() || ((site != nullptr) && !site->isEnable()))
         return false; // Do not throw exception to avoid exit application.
 
-    if (!checkActiveSeverity(sl))
+    bool isActive = checkActiveSeverity(sl);
+    bool isCrashRecord = (_crashSeverity & static_cast<int>(sl)) != 0;
+
+    if (!isActive && !isCrashRecord) {
+        _qtyRecordsFiltered.add();
         return false; // Do not throw exception to avoid exit application.
+    }
 
-    std::lock_guard<std::mutex> lk(_mtxLog);
+    if (_isClosed.load())
+        return false; // Logger destroyed while the caller still holds it.
+
+    if (isActive && (site != nullptr) && _rateLimiter && !checkRateLimit(*site))
+        return false;
+
+    if (site != nullptr)
+        site->hit();
+
+    if (isCrashRecord)
+        keepCrashRecord(sl, file, function, line, msg, site);
+
+    if (!isActive) {
+        _qtyRecordsFiltered.add();
+        return true;
+    }
+
+    bool isWritten = writeRecord(sl, file, function, line, msg, site);
+
+    if ((sl == SeverityLevel::Fatal) && _crashBuffer)
+        dumpCrashBuffer();
+
+    return isWritten;
+}
+
+bool Logger::writeRecord(const SeverityLevel & sl,
+                         std::string_view file,
+                         std::string_view function,
+                         const int & line,
+                         std::string_view msg,
+                         const LogCallSite * site) {
+    if (_queue) {
+        LogRecord record;
+
+        record.sl = sl;
+        record.line = line;
+        record.msg = msg;
+        record.time = std::chrono::system_clock::now();
+        record.thread = LogBinary::getThreadId();
+
+        // The strings of the call site live as long as the application.
+        if (site != nullptr) {
+            record.siteFile = site->getFile();
+            record.siteFunction = site->getFunction();
+            record.site = site;
+        } else {
+            record.file = file;
+            record.function = function;
+        }
+
+        return enqueue(record);
+    }
+
+    if (_logSetting.getWriteMode() == WriteMode::Buffered) {
+        LogThreadBuffer & buffer = getThreadBuffer();
 
-    std::fstream fs;
+        {
+            std::lock_guard<std::mutex> lk(buffer.mtx);
 
-    fs.open((_logSetting.getPath() + _logSetting.getName()),
-             std::fstream::in | std::fstream::out | std::fstream::app);
+            if (_isBinary) {
+                LogBinary::appendRecord(buffer.data, LogBinary::getThreadId(), std::chrono::system_clock::now(),
+                                        getSite(file, function, line), sl, msg.length());
+                buffer.data += msg;
+            } else if (_isJson) {
+                LogJson::appendRecord(buffer.data, std::chrono::system_clock::now(), getServerityName(sl), LogBinary::getThreadId(),
+                                      file, function, line, msg, _jsonFields);
+                buffer.data += '\n';
+            } else {
+                buildInfo(buffer.data, file, function, line, sl, std::chrono::system_clock::now(), site);
+                buffer.data += msg;
+                buffer.data += '\n';
+            }
 
-    if (fs.good() != true)
-        throw LoggerException(2, "Error while opening the file.");
+            buffer.qtyRecords++;
+            buffer.ends.emplace_back(buffer.data.length(), sl);
 
-    fs << buildInfo(_logSetting.getInfo(), file, function, line, sl) << msg << std::endl;
+            if ((buffer.data.length() >= _logSetting.getFlushSize()) ||
+                (_logSetting.getFlushSeverity() & static_cast<int>(sl)))
+                writeBuffer(buffer);
+        }
+
+        // The application will presumably abort, write everything.
+        if (sl == SeverityLevel::Fatal)
+            flush();
+
+        return true;
+    }
+
+    if (_isShared && !_hasSinks.load(std::memory_order_relaxed) &&
+        writeShared(sl, file, function, line, msg, site))
+        return true;
+
+    std::unique_lock<std::mutex> lk = lockLog();
+
+    if (_isClosed.load())
+        return false;
+
+    // The message is written from the caller string, without being copied
+    // after the header.
+    _batch.clear();
+    buildHeader(_batch, sl, file, function, line, std::chrono::system_clock::now(), LogBinary::getThreadId(), msg, site);
+
+    struct iovec iov[3] = {
+        { &_batch[0], _batch.length() },
+        { const_cast<char *>(msg.data()), _isJson ? 0 : msg.length() },
+        { const_cast<char *>("\n"), _isBinary ? 0u : 1u }
+    };
 
-    if (fs.good() != true)
-        throw LoggerException(3, "Error while writing in the file.");
+    if (!_sinks.empty()) {
+        LogSinkRecord record { sl, iov, 3 };
+        writeSinks(&record, 1);
+    }
 
-    fs.close();
+    writeFile(iov, 3);
+    _qtyRecordsWritten.add();
 
     return true;
 }
 
-std::string Logger::buildInfo(const std::string & format,
-                              const std::string & file,
-                              const std::string & function,
-                              const int & line,
-                              const SeverityLevel & sl) {
-    bool found_date = false;
-    bool found_date_key = false;
-    bool found_specifier = false;
-    char sv[64];
-    std::stringstream ssr;
-    std::tm tm;
-
-    auto cur_time = std::chrono::system_clock::now();
-    std::time_t cur_time_tt = std::chrono::system_clock::to_time_t(cur_time);
-    localtime_r(&cur_time_tt, &tm);
-
-    for (unsigned int i = 0; i < format.length(); i++) {
-        if (format[i] == '{') {
-            // Begin of date/time.
-            found_date_key = true;
-            continue;
-        } else if (format[i] == '}') {
-            // End of date/time.
-            found_date = false;
-            found_date_key = false;
-            continue;
-        } else if (format[i] == '%') {
-            found_specifier = true;
-            continue;
-        } else if (format[i] == 'D') {
-            // Date/time specifier.
-            found_date = true;
-            found_specifier = false;
-            continue;
-        } else if ((found_date == true) &&
-                   (found_date_key == true) &&
-                   (found_specifier == true) &&
-                   (format[i] == 'q')) {
-            // Milliseconds specifier.
-            ssr << (cur_time.time_since_epoch().count() / 1000000) % 1000;
-            found_specifier = false;
-            continue;
-        } else if ((found_date == true) &&
-                   (found_date_key == true) &&
-                   (found_specifier == true)) {
-            memset(sv, 0, sizeof(sv));
-            std::string tmp("%");
-            tmp += format[i];
-            std::strftime(sv, (sizeof(sv) - sizeof(char)), tmp.c_str(), &tm);
-            ssr << sv;
-            found_specifier = false;
-            continue;
-        } else if (format[i] == 'F') {
-            // File specifier.
-            std::cout << "Found file specifier!\n";
-            ssr << file;
-            found_specifier = false;
-            continue;
-        } else if (format[i] == 'M') {
-            // Function specifier.
-            ssr << function;
-            found_specifier = false;
-            continue;
-        } else if (format[i] == 'L') {
-            // Line specifier.
-            ssr << line;
-            found_specifier = false;
+bool Logger::write(const SeverityLevel sl,
+                   const char * file,
+                   const char * function,
+                   const int line,
+                   const LogArgs & args) {
+    return submit(sl, file, function, line, args, nullptr);
+}
+
+bool Logger::write(const LogCallSite & site,
+                   const LogArgs & args) {
+    return submit(site.getSeverity(), site.getFile(), site.getFunction(), site.getLine(), args, &site);
+}
+
+bool Logger::submit(const SeverityLevel & sl,
+                    const char * file,
+                    const char * function,
+                    const int & line,
+                    const LogArgs & args,
+                    const LogCallSite * site) {
+    // The record kept in the crash buffer is formatted by the caller.
+    if (!_queue || (_crashSeverity & static_cast<int>(sl))) {
+        // Reused by the thread, no allocation once it's large enough.
+        thread_local std::string msg;
+
+        msg.clear();
+        args.format(msg);
+
+        return submit(sl, file, function, line, msg, site);
+    }
+
+    if (!isEnable() || ((site != nullptr) && !site->isEnable()) || _isClosed.load())
+        return false;
+
+    if (!checkActiveSeverity(sl)) {
+        _qtyRecordsFiltered.add();
+        return false;
+    }
+
+    if ((site != nullptr) && _rateLimiter && !checkRateLimit(*site))
+        return false;
+
+    if (site != nullptr)
+        site->hit();
+
+    // Only the pointers and the arguments are copied, the strings are built
+    // by the writer thread.
+    LogRecord record;
+
+    record.sl = sl;
+    record.line = line;
+    record.time = std::chrono::system_clock::now();
+    record.thread = LogBinary::getThreadId();
+    record.siteFile = file;
+    record.siteFunction = function;
+    record.site = site;
+    record.args = args;
+
+    return enqueue(record);
+}
+
+bool Logger::enqueue(LogRecord & record) {
+    // stopWriter() takes the gate to stop the writer, so a record pushed is
+    // always drained by it.
+    bool isLocked = _gateQueue.enter();
+    bool isQueued = _isWriterRunning.load() && push(record);
+
+    _gateQueue.leave(isLocked);
+
+    return isQueued;
+}
+
+bool Logger::push(LogRecord & record) {
+    while (!_queue->tryPush(record)) {
+        switch (_logSetting.getOverflowPolicy()) {
+            case OverflowPolicy::Block :
+                wakeWriter();
+                std::this_thread::yield();
+                break;
+            case OverflowPolicy::DropNewest :
+                _qtyDropped++;
+                _qtyRecordsDropped.add();
+                wakeWriter();
+                return false;
+            case OverflowPolicy::DropOldest : {
+                LogRecord oldest;
+                if (_queue->tryPop(oldest)) {
+                    _qtyDropped++;
+                    _qtyRecordsDropped.add();
+                    _qtyDone++;
+                }
+                break;
+            }
+        }
+    }
+
+    _qtyQueued++;
+    wakeWriter();
+
+    return true;
+}
+
+void Logger::wakeWriter() {
+    if (_isWriterSleeping.load()) {
+        std::lock_guard<std::mutex> lk(_mtxWriter);
+        _cvWriter.notify_one();
+    }
+}
+
+void Logger::writerLoop() {
+    for (;;) {
+        // Read before the batch: once stopped, the records pushed before
+        // stopWriter() are all popped before leaving, even if this thread
+        // was preempted after finding the queue empty.
+        bool isRunning = _isWriterRunning.load();
+
+        if (writeBatch() > 0)
             continue;
+
+        std::unique_lock<std::mutex> lk(_mtxWriter);
+
+        _cvDone.notify_all();
+
+        if (!isRunning)
+            break;
+
+        _isWriterSleeping.store(true);
+
+        // A record may be queued before the writer was marked as sleeping.
+        if (_queue->isEmpty())
+            _cvWriter.wait_for(lk, std::chrono::milliseconds(100));
+
+        _isWriterSleeping.store(false);
+    }
+}
+
+size_t Logger::writeBatch() {
+    size_t qtyRecords = 0;
+    size_t qtyPopped = 0;
+
+    // Sampled by the writer thread only, the producers don't pay for it.
+    size_t queueDepth = _qtyQueued.load() - _qtyDone.load();
+
+    if (queueDepth > _queueHighWater.load(std::memory_order_relaxed))
+        _queueHighWater.store(queueDepth, std::memory_order_relaxed);
+
+    std::unique_lock<std::mutex> lk = lockLog();
+
+    unsigned long long qtyDropped = _qtyDropped.exchange(0);
+
+    if (qtyDropped > 0) {
+        _records[qtyRecords++] = LogRecord { SeverityLevel::Warning, __FILE__, __PRETTY_FUNCTION__, __LINE__,
+                                             std::to_string(qtyDropped) + " records dropped, asynchronous queue is full.",
+                                             std::chrono::system_clock::now(), LogBinary::getThreadId() };
+    }
+
+    while ((qtyRecords < BatchSize) && _queue->tryPop(_records[qtyRecords])) {
+        qtyRecords++;
+        qtyPopped++;
+    }
+
+    if (qtyRecords == 0)
+        return 0;
+
+    // The headers are formatted one after the other, the messages are
+    // written from the records without being copied.
+    _batch.clear();
+
+    for (size_t i = 0; i < qtyRecords; i++) {
+        LogRecord & record = _records[i];
+
+        if (!record.args.isEmpty()) {
+            record.msg.clear();
+            record.args.format(record.msg);
+            record.args.clear();
+        }
+
+        buildHeader(_batch, record.sl,
+                    (record.siteFile != nullptr) ? std::string_view(record.siteFile) : std::string_view(record.file),
+                    (record.siteFunction != nullptr) ? std::string_view(record.siteFunction) : std::string_view(record.function),
+                    record.line, record.time, record.thread, record.msg, record.site);
+        _headerEnds[i] = _batch.length();
+    }
+
+    size_t begin = 0;
+
+    for (size_t i = 0; i < qtyRecords; i++) {
+        _iov[3 * i].iov_base = &_batch[begin];
+        _iov[3 * i].iov_len = _headerEnds[i] - begin;
+        _iov[(3 * i) + 1].iov_base = &_records[i].msg[0];
+        _iov[(3 * i) + 1].iov_len = _isJson ? 0 : _records[i].msg.length();
+        _iov[(3 * i) + 2].iov_base = const_cast<char *>("\n");
+        _iov[(3 * i) + 2].iov_len = _isBinary ? 0 : 1;
+        begin = _headerEnds[i];
+    }
+
+    if (!_sinks.empty()) {
+        _sinkRecords.clear();
+
+        for (size_t i = 0; i < qtyRecords; i++)
+            _sinkRecords.push_back({ _records[i].sl, &_iov[3 * i], 3 });
+
+        writeSinks(_sinkRecords.data(), qtyRecords);
+    }
+
+    try {
+        writeFile(_iov.data(), 3 * qtyRecords);
+        _qtyRecordsWritten.add(qtyRecords);
+    } catch (LoggerException & e) {
+        // There is nobody to catch the exception in the writer thread.
+        std::cerr << "Logger (" << _logSetting.getName() << "): " << e.what() << "\n";
+    }
+
+    _qtyDone += qtyPopped;
+
+    return qtyPopped;
+}
+
+void Logger::flusherLoop() {
+    std::unique_lock<std::mutex> lk(_mtxWriter);
+
+    while (_isWriterRunning.load()) {
+        _cvWriter.wait_for(lk, _logSetting.getFlushInterval());
+
+        lk.unlock();
+
+        try {
+            if (_rateLimiter)
+                writeSuppressed(false);
+
+            writeBuffers(false);
+        } catch (LoggerException & e) {
+            // There is nobody to catch the exception in the writer thread.
+            std::cerr << "Logger (" << _logSetting.getName() << "): " << e.what() << "\n";
+        }
+
+        lk.lock();
+    }
+}
+
+LogThreadBuffer & Logger::getThreadBuffer() {
+    thread_local ThreadBuffers threadBuffers;
+
+    for (auto & buffer : threadBuffers.buffers) {
+        if (buffer.first == _id)
+            return *buffer.second;
+    }
+
+    // Release the buffers of loggers already destroyed.
+    for (auto it = threadBuffers.buffers.begin(); it != threadBuffers.buffers.end();) {
+        if (it->second->isClosed.load())
+            it = threadBuffers.buffers.erase(it);
+        else
+            it++;
+    }
+
+    std::shared_ptr<LogThreadBuffer> buffer = std::make_shared<LogThreadBuffer>();
+    buffer->data.reserve(_logSetting.getFlushSize());
+
+    {
+        std::lock_guard<std::mutex> lk(_mtxBuffers);
+        _buffers.push_back(buffer);
+    }
+
+    threadBuffers.buffers.emplace_back(_id, buffer);
+
+    return *buffer;
+}
+
+void Logger::writeBuffer(LogThreadBuffer & buffer) {
+    if (buffer.data.empty())
+        return;
+
+    std::unique_lock<std::mutex> lk = lockLog();
+
+    // Buffer filled while the logger was being closed.
+    if (_isReleased) {
+        buffer.data.clear();
+        buffer.qtyRecords = 0;
+        buffer.ends.clear();
+        return;
+    }
+
+    if (!_sinks.empty()) {
+        size_t begin = 0;
+
+        _sinkIov.clear();
+        _sinkRecords.clear();
+
+        for (auto & end : buffer.ends) {
+            _sinkIov.push_back({ &buffer.data[begin], end.first - begin });
+            begin = end.first;
+        }
+
+        for (size_t i = 0; i < buffer.ends.size(); i++)
+            _sinkRecords.push_back({ buffer.ends[i].second, &_sinkIov[i], 1 });
+
+        writeSinks(_sinkRecords.data(), _sinkRecords.size());
+    }
+
+    struct iovec iov = { &buffer.data[0], buffer.data.length() };
+
+    try {
+        writeFile(&iov, 1);
+        _qtyRecordsWritten.add(buffer.qtyRecords);
+    } catch (LoggerException & e) {
+        // The records are discarded, otherwise the buffer would grow
+        // without limit.
+        buffer.data.clear();
+        buffer.qtyRecords = 0;
+        buffer.ends.clear();
+        throw;
+    }
+
+    buffer.data.clear();
+    buffer.qtyRecords = 0;
+    buffer.ends.clear();
+}
+
+LogBatchStats Logger::getBatchStats() {
+    std::lock_guard<std::mutex> lk(_mtxLog);
+
+    return LogBatchStats { _qtyRecordsWritten.get(), _logFile.getQtyWrites() };
+}
+
+LogMetrics Logger::getMetrics() {
+    LogMetrics metrics;
+
+    metrics.name = _logSetting.getName();
+    metrics.qtyRecordsWritten = _qtyRecordsWritten.get();
+    metrics.qtyRecordsFiltered = _qtyRecordsFiltered.get();
+    metrics.qtyRecordsDropped = _qtyRecordsDropped.get();
+    metrics.qtyRecordsSuppressed = _qtyRecordsSuppressed.get();
+    metrics.qtyBytesWritten = _qtyBytesWritten.get();
+    metrics.queueHighWater = _queueHighWater.load(std::memory_order_relaxed);
+    metrics.lockWaitTime = _lockWaitTime.load(std::memory_order_relaxed);
+    _writeLatency.snapshot(metrics.writeLatency);
+    _flushLatency.snapshot(metrics.flushLatency);
+
+    return metrics;
+}
+
+std::unique_lock<LogSharedGate> Logger::lockShared() {
+    std::unique_lock<LogSharedGate> lk(_gateShared, std::defer_lock);
+
+    // With sinks attached no thread writes in parallel, the sinks being
+    // changed with the log lock held.
+    if (_isShared && !_hasSinks.load(std::memory_order_relaxed))
+        lk.lock();
+
+    return lk;
+}
+
+bool Logger::writeShared(const SeverityLevel & sl,
+                         std::string_view file,
+                         std::string_view function,
+                         const int & line,
+                         std::string_view msg,
+                         const LogCallSite * site) {
+    // Reused by the thread, no allocation once it's large enough.
+    thread_local std::string header;
+
+    bool isLocked = _gateShared.enter();
+    bool isWritten = false;
+
+    try {
+        // The sinks attached while entering, the record takes the log lock.
+        if (!_isClosed.load() && !_hasSinks.load(std::memory_order_relaxed)) {
+            header.clear();
+            buildHeader(header, sl, file, function, line, std::chrono::system_clock::now(), LogBinary::getThreadId(), msg, site);
+
+            struct iovec iov[3] = {
+                { &header[0], header.length() },
+                { const_cast<char *>(msg.data()), _isJson ? 0 : msg.length() },
+                { const_cast<char *>("\n"), 1 }
+            };
+
+            auto begin = std::chrono::steady_clock::now();
+
+            isWritten = _logFile.writeShared(iov, 3);
+
+            if (isWritten) {
+                _writeLatency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - begin).count());
+                _qtyBytesWritten.add(iov[0].iov_len + iov[1].iov_len + iov[2].iov_len);
+                _qtyRecordsWritten.add();
+            }
+        }
+    } catch (...) {
+        _gateShared.leave(isLocked);
+        throw;
+    }
+
+    _gateShared.leave(isLocked);
+
+    return isWritten;
+}
+
+std::unique_lock<std::mutex> Logger::lockLog() {
+    std::unique_lock<std::mutex> lk(_mtxLog, std::try_to_lock);
+
+    // Only the lock contended is timed.
+    if (!lk.owns_lock()) {
+        auto begin = std::chrono::steady_clock::now();
+
+        lk.lock();
+
+        _lockWaitTime.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - begin).count(), std::memory_order_relaxed);
+    }
+
+    return lk;
+}
+
+void Logger::writeBuffers(const bool & isClosing) {
+    std::lock_guard<std::mutex> lk(_mtxBuffers);
+
+    for (auto it = _buffers.begin(); it != _buffers.end();) {
+        std::shared_ptr<LogThreadBuffer> buffer = *it;
+        std::lock_guard<std::mutex> lkBuffer(buffer->mtx);
+
+        writeBuffer(*buffer);
+
+        if (isClosing)
+            buffer->isClosed.store(true);
+
+        if (buffer->isOrphan || isClosing)
+            it = _buffers.erase(it);
+        else
+            it++;
+    }
+}
+
+void Logger::stopWriter() {
+    if (!_writer.joinable())
+        return;
+
+    // The records being pushed are in the queue before the writer sees the
+    // flag, the next ones are dropped.
+    {
+        std::lock_guard<LogSharedGate> lk(_gateQueue);
+        _isWriterRunning.store(false);
+    }
+
+    {
+        std::lock_guard<std::mutex> lk(_mtxWriter);
+        _cvWriter.notify_one();
+    }
+
+    _writer.join();
+}
+
+void Logger::flush() {
+    if (_rateLimiter)
+        writeSuppressed(true);
+
+    if (_queue) {
+        // Stopped, the writer drained every record queued before leaving.
+        if (!_isWriterRunning.load())
+            return;
+
+        unsigned long long qtyQueued = _qtyQueued.load();
+
+        std::unique_lock<std::mutex> lk(_mtxWriter);
+
+        _cvWriter.notify_one();
+        _cvDone.wait(lk, [&] { return _qtyDone.load() >= qtyQueued; });
+    } else if (_logSetting.getWriteMode() == WriteMode::Buffered) {
+        writeBuffers(false);
+    }
+
+    std::lock_guard<std::mutex> lk(_mtxLog);
+
+    auto begin = std::chrono::steady_clock::now();
+
+    _logFile.flush();
+
+    _flushLatency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - begin).count());
+
+    for (auto & sink : _sinks)
+        sink->flush();
+}
+
+void Logger::reopen() {
+    std::lock_guard<std::mutex> lk(_mtxLog);
+    std::unique_lock<LogSharedGate> lkShared = lockShared();
+
+    if (_isClosed.load())
+        return;
+
+    _logFile.reopen();
+
+    for (auto & sink : _sinks)
+        sink->reopen();
+}
+
+void Logger::keepCrashRecord(const SeverityLevel & sl,
+                             std::string_view file,
+                             std::string_view function,
+                             const int & line,
+                             std::string_view msg,
+                             const LogCallSite * site) {
+    thread_local std::string record;
+
+    record.clear();
+
+    if (_isJson) {
+        LogJson::appendRecord(record, std::chrono::system_clock::now(), getServerityName(sl), LogBinary::getThreadId(),
+                              file, function, line, msg, _jsonFields);
+    } else {
+        buildInfo(record, file, function, line, sl, std::chrono::system_clock::now(), site);
+        record += msg;
+    }
+
+    record += '\n';
+
+    _crashBuffer->write(record.data(), record.length());
+}
+
+void Logger::dumpCrashBuffer() {
+    flush();
+
+    std::string records;
+
+    if (!_crashBuffer->take(records))
+        return;
+
+    std::lock_guard<std::mutex> lk(_mtxLog);
+
+    if (_isReleased)
+        return;
+
+    struct iovec iov = { &records[0], records.length() };
+
+    writeFile(&iov, 1);
+}
+
+bool Logger::checkRateLimit(const LogCallSite & site) {
+    unsigned long long qtySuppressed;
+
+    if (!_rateLimiter->acquire(site, qtySuppressed)) {
+        _qtyRecordsSuppressed.add();
+        return false;
+    }
+
+    if (qtySuppressed > 0)
+        writeSuppressed(site, qtySuppressed);
+
+    return true;
+}
+
+void Logger::writeSuppressed(const bool & isAll) {
+    _rateLimiter->takeSuppressed(isAll, [&](const LogCallSite & site, unsigned long long qtySuppressed) {
+        writeSuppressed(site, qtySuppressed);
+    });
+}
+
+void Logger::writeSuppressed(const LogCallSite & site,
+                             const unsigned long long & qtySuppressed) {
+    char msg[96];
+    int length = snprintf(msg, sizeof(msg), "Message repeated %llu times, suppressed by the rate limit.", qtySuppressed);
+
+    writeRecord(site.getSeverity(), site.getFile(), site.getFunction(), site.getLine(),
+                std::string_view(msg, length), &site);
+}
+
+void Logger::attachSink(const std::shared_ptr<LogSink> & sink) {
+    std::lock_guard<std::mutex> lk(_mtxLog);
+
+    if (_isReleased)
+        return;
+
+    if (std::find(_sinks.begin(), _sinks.end(), sink) == _sinks.end())
+        _sinks.push_back(sink);
+
+    // The threads writing in parallel finish before the records go to the
+    // sinks.
+    std::unique_lock<LogSharedGate> lkShared = lockShared();
+
+    _hasSinks.store(true, std::memory_order_relaxed);
+}
+
+void Logger::detachSink(const std::shared_ptr<LogSink> & sink) {
+    std::lock_guard<std::mutex> lk(_mtxLog);
+
+    auto it = std::find(_sinks.begin(), _sinks.end(), sink);
+
+    if (it == _sinks.end())
+        return;
+
+    _sinks.erase(it);
+    sink->flush();
+
+    _hasSinks.store(!_sinks.empty(), std::memory_order_relaxed);
+}
+
+void Logger::writeSinks(const LogSinkRecord * records,
+                        const size_t & qtyRecords) {
+    for (auto & sink : _sinks) {
+        int severityMask = sink->getSeverityMask();
+
+        _sinkSelected.clear();
+
+        for (size_t i = 0; i < qtyRecords; i++) {
+            if (severityMask & static_cast<int>(records[i].sl))
+                _sinkSelected.push_back(records[i]);
         }
-        else if (format[i] == 'S') {
-            // Severity.
-            ssr << getServerityName(sl);
-            found_specifier = false;
+
+        if (_sinkSelected.empty())
             continue;
+
+        try {
+            sink->write(_sinkSelected.data(), _sinkSelected.size());
+        } catch (LoggerException & e) {
+            std::cerr << "Logger (" << _logSetting.getName() << "): " << e.what() << "\n";
         }
-        ssr << format[i];
+    }
+}
+
+void Logger::buildHeader(std::string & out,
+                         const SeverityLevel & sl,
+                         std::string_view file,
+                         std::string_view function,
+                         const int & line,
+                         const std::chrono::system_clock::time_point & time,
+                         const uint64_t & thread,
+                         std::string_view msg,
+                         const LogCallSite * site) {
+    if (_isJson) {
+        LogJson::appendRecord(out, time, getServerityName(sl), thread, file, function, line, msg, _jsonFields);
+        return;
+    }
+
+    if (!_isBinary) {
+        buildInfo(out, file, function, line, sl, time, site);
+        return;
+    }
+
+    uint32_t siteId = findSite(file, function, line);
+
+    if (siteId == 0)
+        siteId = addSite(out, file, function, line);
+
+    LogBinary::appendRecord(out, thread, time, siteId, sl, msg.length());
+}
+
+uint32_t Logger::findSite(std::string_view file,
+                          std::string_view function,
+                          const int & line) {
+    auto it = _sites.find(LogSiteRef { line, file, function });
+
+    return ((it != _sites.end()) ? it->second : 0);
+}
+
+uint32_t Logger::addSite(std::string & out,
+                         std::string_view file,
+                         std::string_view function,
+                         const int & line) {
+    std::unique_lock<std::shared_mutex> lk(_mtxSites);
+
+    uint32_t siteId = findSite(file, function, line);
+
+    if (siteId != 0)
+        return siteId;
+
+    siteId = _sites.size() + 1;
+
+    auto it = _sites.emplace(LogSite { line, std::string(file), std::string(function) }, siteId).first;
+
+    LogBinary::appendSite(out, siteId, it->first);
+
+    return siteId;
+}
+
+uint32_t Logger::getSite(std::string_view file,
+                         std::string_view function,
+                         const int & line) {
+    {
+        std::shared_lock<std::shared_mutex> lk(_mtxSites);
+
+        uint32_t siteId = findSite(file, function, line);
+
+        if (siteId != 0)
+            return siteId;
+    }
+
+    std::lock_guard<std::mutex> lk(_mtxLog);
+
+    if (_isReleased)
+        return 0;
+
+    std::string entry;
+    uint32_t siteId = addSite(entry, file, function, line);
+
+    if (!entry.empty()) {
+        struct iovec iov = { &entry[0], entry.length() };
+        writeFile(&iov, 1);
+    }
+
+    return siteId;
+}
+
+void Logger::writeFile(struct iovec * iov,
+                       int qtyIov) {
+    std::unique_lock<LogSharedGate> lkShared = lockShared();
+    auto begin = std::chrono::steady_clock::now();
+
+    if (_isBinary && (_logFile.prepare(iov, qtyIov) || _isFormatPending))
+        writePreamble(iov, qtyIov);
+    else
+        _logFile.write(iov, qtyIov);
+
+    _writeLatency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - begin).count());
+
+    size_t qtyBytes = 0;
+
+    for (int i = 0; i < qtyIov; i++)
+        qtyBytes += iov[i].iov_len;
+
+    _qtyBytesWritten.add(qtyBytes);
+}
+
+void Logger::writePreamble(struct iovec * iov,
+                           int qtyIov) {
+    // The file can be decoded from here without the entries before.
+    std::string preamble;
+
+    LogBinary::appendFormat(preamble, _logSetting.getInfo());
+
+    for (auto & site : _sites)
+        LogBinary::appendSite(preamble, site.second, site.first);
+
+    std::vector<struct iovec> iovs;
+
+    iovs.reserve(qtyIov + 1);
+    iovs.push_back({ &preamble[0], preamble.length() });
+    iovs.insert(iovs.end(), iov, iov + qtyIov);
+
+    _logFile.write(iovs.data(), iovs.size());
+
+    _isFormatPending = false;
+}
+
+void Logger::buildInfo(std::string & out,
+                       std::string_view file,
+                       std::string_view function,
+                       const int & line,
+                       const SeverityLevel & sl,
+                       const std::chrono::system_clock::time_point & time,
+                       const LogCallSite * site) {
+    const LogFormat & format = *_infoFormat.load(std::memory_order_acquire);
+
+    if (format.isEmpty())
+        return;
+
+    // File, function, line and severity already rendered for the call site,
+    // unless the format is rendered by a LogStaticFormat.
+    if ((site != nullptr) && !format.isStatic()) {
+        format.render(out, *site->getHeader(format, getServerityName(sl)), time);
+        return;
     }
 
-    return ssr.str();
+    format.render(out, time, file, function, line, getServerityName(sl));
 }
 
 std::string Logger::getServerityName(const SeverityLevel & sl) {
@@ -28,52 +28,178 @@
 #include "logbuilder.h"
 #include "logsetting.h"
 #include "logexception.h"
+#include "logfile.h"
+#include "logqueue.h"
+#include "logformat.h"
+#include "logbinary.h"
+#include "logargs.h"
+#include "logstream.h"
+#include "logjson.h"
+#include "logsink.h"
+#include "logcrashbuffer.h"
+#include "logcallsite.h"
+#include "logratelimiter.h"
+#include "logmetrics.h"
+#include "logsharedgate.h"
 
 #include <string>
 #include <sstream>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <chrono>
+#include <memory>
+#include <vector>
 
 #define LOG(severity, name, msg) LogBuilder::getInstance().getLogger(name)->write(severity, __FILE__, __PRETTY_FUNCTION__, __LINE__, msg)
 
-#define LOG_DEBUG(name, msg) { \
-    std::stringstream ss; \
-    ss << msg; \
-    LOG(SeverityLevel::Debug, name, ss.str()); \
-}
+/**
+ * Minimum severity compiled, the records of lower severity are removed from
+ * the application by the LOG_<SEVERITY> macros. Define LOG_MIN_LEVEL
+ * before including logger.h (e.g. -DLOG_MIN_LEVEL=LOG_LEVEL_INFO).
+ */
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARNING 2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_FATAL 4
 
-#define LOG_FATAL(name, msg) { \
-    std::stringstream ss; \
-    ss << msg; \
-    LOG(SeverityLevel::Fatal, name, ss.str()); \
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+/**
+ * The message is only built when the logger is enabled and the severity is
+ * active. Each thread keeps a reference to the logger in each place where
+ * the macro is used, avoiding to look up the builder on every record. The
+ * place is described once by a static call site, which may be disabled.
+ * The message is built in a LogStream on the stack.
+ */
+#define LOG_RECORD(severity, name, msg) { \
+    static LogCallSite logSite_(__FILE__, __PRETTY_FUNCTION__, __LINE__, severity); \
+    static thread_local LoggerRef loggerRef_; \
+    Logger * logger_ = loggerRef_.get(name); \
+    if (logSite_.isEnable() && logger_->isLoggable(severity)) { \
+        LogStream stream_; \
+        stream_ << msg; \
+        logger_->write(logSite_, stream_.view()); \
+    } \
 }
 
-#define LOG_ERROR(name, msg) { \
-    std::stringstream ss; \
-    ss << msg; \
-    LOG(SeverityLevel::Error, name, ss.str()); \
+/**
+ * Record removed at compile time, the message is still checked by the
+ * compiler but never built.
+ */
+#define LOG_DISABLED(name, msg) { \
+    if (false) { \
+        LogStream stream_; \
+        stream_ << name << msg; \
+    } \
 }
 
-#define LOG_WARNING(name, msg) { \
-    std::stringstream ss; \
-    ss << msg; \
-    LOG(SeverityLevel::Warning, name, ss.str()); \
+/**
+ * Record with a format and its arguments, e.g.
+ * LOG_INFOF("logger", "x={} y={}", x, y). In asynchronous mode the
+ * arguments are copied into the record and the message is formatted by the
+ * writer thread. The format must be a string literal.
+ */
+#define LOG_RECORDF(severity, name, ...) { \
+    static LogCallSite logSite_(__FILE__, __PRETTY_FUNCTION__, __LINE__, severity); \
+    static thread_local LoggerRef loggerRef_; \
+    Logger * logger_ = loggerRef_.get(name); \
+    if (logSite_.isEnable() && logger_->isLoggable(severity)) \
+        logger_->writef(logSite_, __VA_ARGS__); \
 }
 
-#define LOG_INFO(name, msg) { \
-    std::stringstream ss; \
-    ss << msg; \
-    LOG(SeverityLevel::Info, name, ss.str()); \
+/**
+ * Record with a format removed at compile time.
+ */
+#define LOG_DISABLEDF(name, ...) { \
+    if (false) { \
+        std::string name_(name); \
+        LogArgs args_; \
+        args_.capture(__VA_ARGS__); \
+    } \
 }
 
+#if LOG_MIN_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(name, msg) LOG_RECORD(SeverityLevel::Debug, name, msg)
+#define LOG_DEBUGF(name, ...) LOG_RECORDF(SeverityLevel::Debug, name, __VA_ARGS__)
+#else
+#define LOG_DEBUG(name, msg) LOG_DISABLED(name, msg)
+#define LOG_DEBUGF(name, ...) LOG_DISABLEDF(name, __VA_ARGS__)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(name, msg) LOG_RECORD(SeverityLevel::Info, name, msg)
+#define LOG_INFOF(name, ...) LOG_RECORDF(SeverityLevel::Info, name, __VA_ARGS__)
+#else
+#define LOG_INFO(name, msg) LOG_DISABLED(name, msg)
+#define LOG_INFOF(name, ...) LOG_DISABLEDF(name, __VA_ARGS__)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_WARNING
+#define LOG_WARNING(name, msg) LOG_RECORD(SeverityLevel::Warning, name, msg)
+#define LOG_WARNINGF(name, ...) LOG_RECORDF(SeverityLevel::Warning, name, __VA_ARGS__)
+#else
+#define LOG_WARNING(name, msg) LOG_DISABLED(name, msg)
+#define LOG_WARNINGF(name, ...) LOG_DISABLEDF(name, __VA_ARGS__)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(name, msg) LOG_RECORD(SeverityLevel::Error, name, msg)
+#define LOG_ERRORF(name, ...) LOG_RECORDF(SeverityLevel::Error, name, __VA_ARGS__)
+#else
+#define LOG_ERROR(name, msg) LOG_DISABLED(name, msg)
+#define LOG_ERRORF(name, ...) LOG_DISABLEDF(name, __VA_ARGS__)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_FATAL
+#define LOG_FATAL(name, msg) LOG_RECORD(SeverityLevel::Fatal, name, msg)
+#define LOG_FATALF(name, ...) LOG_RECORDF(SeverityLevel::Fatal, name, __VA_ARGS__)
+#else
+#define LOG_FATAL(name, msg) LOG_DISABLED(name, msg)
+#define LOG_FATALF(name, ...) LOG_DISABLEDF(name, __VA_ARGS__)
+#endif
+
 /**
- * All types of severity level available to classify the log record.
+ * Log record waiting in the queue to be written by the writer thread.
  */
-enum class SeverityLevel {
-    Debug = 0x01, ///< Informational events most useful for developers to debug application.
-    Fatal = 0x02, ///< Severe error information that will presumably abort application.
-    Error = 0x04, ///< Information representing errors in application but application will keep running.
-    Warning = 0x08, ///< Useful when application has potentially harmful situtaions.
-    Info = 0x16, ///< Mainly useful to represent current progress of application.
-    Unknown = 0x64 ///< Represents unknown level.
+struct LogRecord {
+    SeverityLevel sl; ///< Severity of the log record.
+    std::string file; ///< File where log was invoked.
+    std::string function; ///< Function where log was invoked.
+    int line; ///< Line where log was invoked.
+    std::string msg; ///< Log message to be recorded.
+    std::chrono::system_clock::time_point time; ///< When the record was created.
+    uint64_t thread; ///< Id of the thread logging.
+    const char * siteFile = nullptr; ///< File where log was invoked, instead of file when set.
+    const char * siteFunction = nullptr; ///< Function where log was invoked, instead of function when set.
+    const LogCallSite * site = nullptr; ///< Call site of the record, if logged by the macros.
+    LogArgs args; ///< Format and arguments of the message deferred.
+};
+
+/**
+ * Buffer where a thread formats its records in buffered mode, it's written
+ * to the log file in large chunks.
+ */
+struct LogThreadBuffer {
+    std::mutex mtx; ///< Protection against the writer thread flushing the buffer.
+    std::string data; ///< Records formatted not written yet.
+    size_t qtyRecords = 0; ///< Quantity of records in the buffer.
+    std::vector<std::pair<size_t, SeverityLevel>> ends; ///< End and severity of each record, to split them for the sinks.
+    bool isOrphan = false; ///< Thread owning the buffer has exited.
+    std::atomic<bool> isClosed { false }; ///< Logger owning the buffer was destroyed.
+};
+
+/**
+ * Statistics of records written by batch.
+ */
+struct LogBatchStats {
+    unsigned long long qtyRecords; ///< Records written to the log file.
+    unsigned long long qtyWrites; ///< System calls used to write them.
 };
 
 /**
@@ -105,7 +231,31 @@ public:
     bool checkActiveSeverity(const SeverityLevel & sl);
 
     /**
-     * Enable/Disable the functionality to log.
+     * Check if the logger is enabled and the given severity is enable to
+     * log or kept in the crash buffer, used by the macros before building
+     * the message.
+     *
+     * @param sl Severiy to be checked.
+     *
+     * @return True if a record with the severity would be written and false
+     *         otherwise.
+     */
+    bool isLoggable(const SeverityLevel & sl) {
+        if (!_isEnable.load(std::memory_order_relaxed))
+            return false;
+
+        if ((_activeSeverity.load(std::memory_order_relaxed) | _crashSeverity) & static_cast<int>(sl))
+            return true;
+
+        _qtyRecordsFiltered.add();
+
+        return false;
+    }
+
+    /**
+     * Enable/Disable the functionality to log. The enable flag and the
+     * active severitys may be changed at any time while other threads log,
+     * the threads logging read them without locks.
      *
      * @param isEnable True to enable and false to disable.
      */
@@ -128,7 +278,7 @@ public:
     void addActiveSeverity(const int & as);
 
     /**
-     * Remove severitys to be log.
+     * Remove severitys to be log, the severitys not active stay so.
      *
      * @param as Bitwise argument to represent active severity.
      *           Example of value: Serverity::Debug & Severity::Info are enable.
@@ -140,6 +290,20 @@ public:
      */
     void enableAllSeverity();
 
+    /**
+     * Return if the logger is enabled.
+     *
+     * @return True if enabled and false otherwise.
+     */
+    bool isEnable() const;
+
+    /**
+     * Return the severitys enabled to log.
+     *
+     * @return Bitwise value of the active severitys.
+     */
+    int getActiveSeverity() const;
+
     /**
      * Enable debug severity to be log.
      *
@@ -182,19 +346,52 @@ public:
      *     %M            Method where method was invoked.
      *     %L            Line where method was invoked.
      *     %S            Log severity.
+     *     %%            The '%' character.
      */
     void setInfoFormat(const std::string & infoFormat);
 
+    /**
+     * Set the info format declared by LOG_STATIC_FORMAT(), parsed at compile
+     * time. The header is the same of setInfoFormat() with the format.
+     *
+     *     LOG_STATIC_FORMAT(HeaderFormat, "%D{%Y-%m-%d %H:%M:%S.%q} [%S] %F:%L ");
+     *
+     *     logger->setInfoFormat<HeaderFormat>();
+     */
+    template<typename Format>
+    void setInfoFormat() {
+        setInfoFormat(std::string(Format::value), &LogStaticFormat<Format>::render);
+    }
+
+    /**
+     * Set the info format and its renderer, if it was parsed at compile time.
+     *
+     * @param infoFormat String containing specifiers with log informations.
+     * @param infoRenderer Renderer of the format parsed at compile time or
+     *                     nullptr.
+     */
+    void setInfoFormat(const std::string & infoFormat,
+                       LogInfoRenderer infoRenderer);
+
     /**
      * Write the log record based on the settings used to build the logger.
      *
+     * In asynchronous mode the record is only queued, it will be written by
+     * the writer thread and errors while writing are reported in the
+     * standard error.
+     *
+     * With the crash buffer the record is also kept in memory, even if its
+     * severity isn't active, and a fatal record dumps the buffer into the
+     * log file.
+     *
      * @param sl Severity of the log record.
      * @param file File where log was invoked.
      * @param function Function where log was invoked.
      * @line Line where log was invoked.
      * @msg Log message to be recorded.
      *
-     * @return True if everything is ok and false otherwise.
+     * @return True if everything is ok and false otherwise (e.g. logger
+     *         disabled or record dropped because the queue is full).
      *
      * @throws LoggerException
      *         Error while opening the file.
@@ -202,10 +399,189 @@ public:
      *
      */
     bool write(const SeverityLevel sl,
-               const std::string file,
-               const std::string function,
+               std::string_view file,
+               std::string_view function,
+               const int line,
+               std::string_view msg);
+
+    /**
+     * Write the log record with the message deferred. In asynchronous mode
+     * the arguments are queued with the record and formatted by the writer
+     * thread, otherwise the message is formatted now.
+     *
+     * @param sl Severity of the log record.
+     * @param file File where log was invoked, string literal.
+     * @param function Function where log was invoked, string literal.
+     * @param line Line where log was invoked.
+     * @param args Format and arguments of the message.
+     *
+     * @return True if everything is ok and false otherwise (e.g. logger
+     *         disabled or record dropped because the queue is full).
+     *
+     * @throws LoggerException
+     *         Error while opening the file.
+     *         Error while writing in the file.
+     */
+    bool write(const SeverityLevel sl,
+               const char * file,
+               const char * function,
                const int line,
-               const std::string msg);
+               const LogArgs & args);
+
+    /**
+     * Write the log record of a call site, used by the LOG_<SEVERITY>
+     * macros. The header is rendered from the one kept by the call site.
+     *
+     * @param site Call site of the record.
+     * @param msg Log message to be recorded.
+     *
+     * @return True if everything is ok and false otherwise (e.g. logger or
+     *         call site disabled).
+     *
+     * @throws LoggerException
+     *         Error while opening the file.
+     *         Error while writing in the file.
+     */
+    bool write(const LogCallSite & site,
+               std::string_view msg);
+
+    /**
+     * Write the log record of a call site with the message deferred.
+     *
+     * @param site Call site of the record.
+     * @param args Format and arguments of the message.
+     *
+     * @return True if everything is ok and false otherwise.
+     *
+     * @throws LoggerException
+     *         Error while opening the file.
+     *         Error while writing in the file.
+     */
+    bool write(const LogCallSite & site,
+               const LogArgs & args);
+
+    /**
+     * Write the log record with a format and its arguments.
+     *
+     * @param sl Severity of the log record.
+     * @param file File where log was invoked, string literal.
+     * @param function Function where log was invoked, string literal.
+     * @param line Line where log was invoked.
+     * @param format Format with a {} for each argument, string literal.
+     * @param args Arguments.
+     *
+     * @return True if everything is ok and false otherwise.
+     *
+     * @throws LoggerException
+     *         Error while opening the file.
+     *         Error while writing in the file.
+     */
+    template<size_t N, typename... Args>
+    bool writef(const SeverityLevel sl,
+                const char * file,
+                const char * function,
+                const int line,
+                const char (&format)[N],
+                Args &&... args) {
+        LogArgs logArgs;
+
+        if (logArgs.capture(format, args...))
+            return write(sl, file, function, line, logArgs);
+
+        // Too large to be captured, the message is formatted now.
+        std::string msg;
+        LogArgs::formatNow(msg, format, args...);
+
+        return write(sl, file, function, line, msg);
+    }
+
+    /**
+     * Write the log record of a call site with a format and its arguments,
+     * used by the LOG_<SEVERITY>F macros.
+     *
+     * @param site Call site of the record.
+     * @param format Format with a {} for each argument, string literal.
+     * @param args Arguments.
+     *
+     * @return True if everything is ok and false otherwise.
+     *
+     * @throws LoggerException
+     *         Error while opening the file.
+     *         Error while writing in the file.
+     */
+    template<size_t N, typename... Args>
+    bool writef(const LogCallSite & site,
+                const char (&format)[N],
+                Args &&... args) {
+        LogArgs logArgs;
+
+        if (logArgs.capture(format, args...))
+            return write(site, logArgs);
+
+        // Too large to be captured, the message is formatted now.
+        std::string msg;
+        LogArgs::formatNow(msg, format, args...);
+
+        return write(site, msg);
+    }
+
+    /**
+     * Commit the records already written to the storage device, in
+     * asynchronous mode it waits until the writer thread writes all records
+     * queued before the call and in buffered mode it writes the buffers of
+     * all threads.
+     */
+    void flush();
+
+    /**
+     * Write the records not written yet and close the log file, the next
+     * records are discarded. It's called when the logger is destroyed.
+     */
+    void close();
+
+    /**
+     * Close the log file and open it again, useful after the file was
+     * rotated by an external tool.
+     *
+     * @throws LoggerException
+     *         Error while opening the file.
+     */
+    void reopen();
+
+    /**
+     * Attach a sink, it receives the records written from now on whose
+     * severity is in its mask, formatted only once for the log file and
+     * all sinks. Errors of a sink are reported in the standard error
+     * without affecting the others.
+     *
+     * @param sink Sink to be attached.
+     */
+    void attachSink(const std::shared_ptr<LogSink> & sink);
+
+    /**
+     * Detach a sink, flushing it.
+     *
+     * @param sink Sink to be detached.
+     */
+    void detachSink(const std::shared_ptr<LogSink> & sink);
+
+    /**
+     * Return how many records were written and how many system calls were
+     * needed, the records written by each call are larger when the writer
+     * thread or the thread buffers group many records.
+     *
+     * @return Records written and system calls used.
+     */
+    LogBatchStats getBatchStats();
+
+    /**
+     * Return the counters kept about the cost of the logger. They're
+     * updated by the threads logging with relaxed atomic operations, the
+     * snapshot doesn't lock the logger.
+     *
+     * @return Metrics of the logger.
+     */
+    LogMetrics getMetrics();
 
     /**
      * Based on severity code it's returns the severity name.
@@ -214,7 +590,7 @@ public:
      *
      * @return Name of severity code.
      */
-    std::string getServerityName(const SeverityLevel & sl);
+    static std::string getServerityName(const SeverityLevel & sl);
 
     /**
      * Based on severity code it's returns the details about the severity.
@@ -223,61 +599,464 @@ public:
      *
      * @return Details of severity code.
      */
-    std::string getServerityDescription(const SeverityLevel & sl);
+    static std::string getServerityDescription(const SeverityLevel & sl);
 
 private:
 
     /**
-     * Build the header based on specifiers where error has ocurred in the log
-     * record, with optional information like date/time, file, function, line
-     * and severity.
+     * Check if the record must be logged, keep it in the crash buffer and
+     * write it. Common to all write() methods.
      *
-     * @param format String containing specifiers with log informations.
+     * @param sl Severity of the log record.
+     * @param file File where log was invoked.
+     * @param function Function where log was invoked.
+     * @param line Line where log was invoked.
+     * @param msg Log message to be recorded.
+     * @param site Call site of the record or null.
      *
-     *     %D{<format>}  The date format is based on strftime().
-     *                   %a – Abbreviated weekday name
-     *                   %A – Full weekday name
-     *                   %b – Abbreviated month name
-     *                   %B – Full month name
-     *                   %c – Standard date and time string
-     *                   %d – Day of month as a decimal(1-31)
-     *                   %H – Hour(0-23)
-     *                   %I – Hour(1-12)
-     *                   %j – Day of year as a decimal(1-366)
-     *                   %m – Month as decimal(1-12)
-     *                   %M – Minute as decimal(0-59)
-     *                   %p – Locale's equivalent of AM or PM
-     *                   %q – Milliseconds as decimal(0-999) – Special for the application.
-     *                   %S – Second as decimal(0-59)
-     *                   %U – Week of year, Sunday being first day(0-53)
-     *                   %w – Weekday as a decimal(0-6, Sunday being 0)
-     *                   %W – Week of year, Monday being first day(0-53)
-     *                   %x – Standard date string
-     *                   %X – Standard time string
-     *                   %y – Year in decimal without century(0-99)
-     *                   %Y – Year including century as decimal
-     *                   %Z – Time zone name
+     * @return True if everything is ok and false otherwise.
      *
-     *     %F            File where method was invoked.
-     *     %M            Method where method was invoked.
-     *     %L            Line where method was invoked.
-     *     %S            Log severity.
+     * @throws LoggerException
+     *         Error while opening the file.
+     *         Error while writing in the file.
+     */
+    bool submit(const SeverityLevel & sl,
+                std::string_view file,
+                std::string_view function,
+                const int & line,
+                std::string_view msg,
+                const LogCallSite * site);
+
+    /**
+     * Check if the record must be logged and queue it with the message
+     * deferred or format it now. Common to all write() methods with
+     * deferred messages.
+     *
+     * @param sl Severity of the log record.
+     * @param file File where log was invoked, string literal.
+     * @param function Function where log was invoked, string literal.
+     * @param line Line where log was invoked.
+     * @param args Format and arguments of the message.
+     * @param site Call site of the record or null.
+     *
+     * @return True if everything is ok and false otherwise.
+     *
+     * @throws LoggerException
+     *         Error while opening the file.
+     *         Error while writing in the file.
+     */
+    bool submit(const SeverityLevel & sl,
+                const char * file,
+                const char * function,
+                const int & line,
+                const LogArgs & args,
+                const LogCallSite * site);
+
+    /**
+     * Write the log record into the log file and the sinks, according to
+     * the write mode.
+     *
+     * @param sl Severity of the log record.
+     * @param file File where log was invoked.
+     * @param function Function where log was invoked.
+     * @param line Line where log was invoked.
+     * @param msg Log message to be recorded.
+     * @param site Call site of the record or null.
+     *
+     * @return True if everything is ok and false otherwise.
+     *
+     * @throws LoggerException
+     *         Error while opening the file.
+     *         Error while writing in the file.
+     */
+    bool writeRecord(const SeverityLevel & sl,
+                     std::string_view file,
+                     std::string_view function,
+                     const int & line,
+                     std::string_view msg,
+                     const LogCallSite * site);
+
+    /**
+     * Format the record as in the log file and keep it in the crash buffer.
+     *
+     * @param sl Severity of the log record.
+     * @param file File where log was invoked.
+     * @param function Function where log was invoked.
+     * @param line Line where log was invoked.
+     * @param msg Log message to be recorded.
+     * @param site Call site of the record or null.
+     */
+    void keepCrashRecord(const SeverityLevel & sl,
+                         std::string_view file,
+                         std::string_view function,
+                         const int & line,
+                         std::string_view msg,
+                         const LogCallSite * site);
+
+    /**
+     * Write the records written before and dump the crash buffer into the
+     * log file.
+     *
+     * @throws LoggerException
+     *         Error while opening the file.
+     *         Error while writing in the file.
+     */
+    void dumpCrashBuffer();
+
+    /**
+     * Take a token of the rate limit of the call site. The first record
+     * allowed after others were suppressed is preceded by a record telling
+     * how many.
+     *
+     * @param site Call site of the record.
+     *
+     * @return True if the record may be written and false if suppressed.
+     *
+     * @throws LoggerException
+     *         Error while opening the file.
+     *         Error while writing in the file.
+     */
+    bool checkRateLimit(const LogCallSite & site);
+
+    /**
+     * Write the records telling how many were suppressed by the rate limit,
+     * not reported yet.
+     *
+     * @param isAll True to report all call sites and false only those whose
+     *              burst ended.
+     *
+     * @throws LoggerException
+     *         Error while opening the file.
+     *         Error while writing in the file.
+     */
+    void writeSuppressed(const bool & isAll);
+
+    /**
+     * Write a record of the call site telling how many were suppressed by
+     * the rate limit.
+     *
+     * @param site Call site of the records suppressed.
+     * @param qtySuppressed Quantity of records suppressed.
+     *
+     * @throws LoggerException
+     *         Error while opening the file.
+     *         Error while writing in the file.
+     */
+    void writeSuppressed(const LogCallSite & site,
+                         const unsigned long long & qtySuppressed);
+
+    /**
+     * Build the header based on the info format compiled, with optional
+     * information like date/time, file, function, line and severity.
+     *
+     * @param out Output where the header will be appended.
      * @param file File where logger was invoked.
      * @param function Function where logger was invoked.
      * @param line Line where logger was invoked.
      * @param severity Severity of the log content.
+     * @param time When the record was created.
+     * @param site Call site of the record or null, its header is used when
+     *             available.
+     */
+    void buildInfo(std::string & out,
+                   std::string_view file,
+                   std::string_view function,
+                   const int & line,
+                   const SeverityLevel & sl,
+                   const std::chrono::system_clock::time_point & time,
+                   const LogCallSite * site = nullptr);
+
+    /**
+     * Build the header of the record, the info format in text mode or the
+     * record entry in binary mode, preceded by the site entry if it's the
+     * first record of the site. In JSON mode it's the whole record, with
+     * the message escaped, so the message must not follow it. Must be
+     * called with the log lock.
+     *
+     * @param out Output where the header will be appended.
+     * @param sl Severity of the log content.
+     * @param file File where logger was invoked.
+     * @param function Function where logger was invoked.
+     * @param line Line where logger was invoked.
+     * @param time When the record was created.
+     * @param thread Id of the thread logging.
+     * @param msg Log message.
+     * @param site Call site of the record or null.
+     */
+    void buildHeader(std::string & out,
+                     const SeverityLevel & sl,
+                     std::string_view file,
+                     std::string_view function,
+                     const int & line,
+                     const std::chrono::system_clock::time_point & time,
+                     const uint64_t & thread,
+                     std::string_view msg,
+                     const LogCallSite * site);
+
+    /**
+     * Find the id of a call site, must be called with the log lock or the
+     * sites lock.
+     *
+     * @param file File where logger was invoked.
+     * @param function Function where logger was invoked.
+     * @param line Line where logger was invoked.
+     *
+     * @return Id of the site or 0 if it's unknown.
+     */
+    uint32_t findSite(std::string_view file,
+                      std::string_view function,
+                      const int & line);
+
+    /**
+     * Add a call site to the dictionary if it's unknown, must be called with
+     * the log lock.
+     *
+     * @param out Output where the site entry will be appended if added.
+     * @param file File where logger was invoked.
+     * @param function Function where logger was invoked.
+     * @param line Line where logger was invoked.
+     *
+     * @return Id of the site.
+     */
+    uint32_t addSite(std::string & out,
+                     std::string_view file,
+                     std::string_view function,
+                     const int & line);
+
+    /**
+     * Get the id of a call site without the log lock, writing the site
+     * entry to the file if it's unknown. Used in buffered mode, the site
+     * is written before any buffer with records of it.
+     *
+     * @param file File where logger was invoked.
+     * @param function Function where logger was invoked.
+     * @param line Line where logger was invoked.
+     *
+     * @return Id of the site.
      *
-     * @return String containing the header of log based on the format
-     *         specifiers.
+     * @throws LoggerException
+     *         Error while opening the file.
+     *         Error while writing in the file.
      */
-    std::string buildInfo(const std::string & format,
-                          const std::string & file,
-                          const std::string & function,
-                          const int & line,
-                          const SeverityLevel & sl);
+    uint32_t getSite(std::string_view file,
+                     std::string_view function,
+                     const int & line);
+
+    /**
+     * Write the fragments into the file. In binary mode they're preceded
+     * by the format and the dictionary of sites when the file is new, when
+     * the logger starts appending to it or when the format changed. Must be
+     * called with the log lock.
+     *
+     * @param iov Fragments to be written.
+     * @param qtyIov Quantity of fragments.
+     *
+     * @throws LoggerException
+     *         Error while opening the file.
+     *         Error while writing in the file.
+     */
+    void writeFile(struct iovec * iov,
+                   int qtyIov);
+
+    /**
+     * Write the fragments into the file in binary mode, preceded by the
+     * format and the dictionary of sites. Must be called with the log lock.
+     *
+     * @param iov Fragments to be written.
+     * @param qtyIov Quantity of fragments.
+     *
+     * @throws LoggerException
+     *         Error while opening the file.
+     *         Error while writing in the file.
+     */
+    void writePreamble(struct iovec * iov,
+                       int qtyIov);
+
+    /**
+     * Take the log lock, counting the time waited when another thread
+     * holds it.
+     *
+     * @return Log lock taken.
+     */
+    std::unique_lock<std::mutex> lockLog();
+
+    /**
+     * Take the file lock exclusively when the records are written in
+     * parallel, to change the file. Must be called with the log lock.
+     *
+     * @return File lock taken, or not owned when not writing in parallel.
+     */
+    std::unique_lock<LogSharedGate> lockShared();
+
+    /**
+     * Format and write a record in parallel with the other threads, only
+     * entering the file gate. The record is formatted in a buffer of the
+     * thread, written with a single system call and counted in the slots
+     * of the thread.
+     *
+     * @param sl Severity of the record.
+     * @param file File where log was invoked.
+     * @param function Function where log was invoked.
+     * @param line Line where log was invoked.
+     * @param msg Message of the record.
+     * @param site Call site of the record or null.
+     *
+     * @return True if written and false if it must be written with the log
+     *         lock.
+     *
+     * @throws LoggerException
+     *         Error while writing in the file, or only a part of the record
+     *         was written.
+     */
+    bool writeShared(const SeverityLevel & sl,
+                     std::string_view file,
+                     std::string_view function,
+                     const int & line,
+                     std::string_view msg,
+                     const LogCallSite * site);
+
+    /**
+     * Write the records into the sinks, each one receiving those accepted
+     * by its severity mask. Must be called with the log lock and before
+     * writeFile(), which changes the fragments.
+     *
+     * @param records Records formatted.
+     * @param qtyRecords Quantity of records.
+     */
+    void writeSinks(const LogSinkRecord * records,
+                    const size_t & qtyRecords);
+
+    /**
+     * Queue the record to be written by the writer thread, unless the
+     * writer was stopped.
+     *
+     * @param record Record to be queued.
+     *
+     * @return True if the record was queued and false if it was dropped.
+     */
+    bool enqueue(LogRecord & record);
+
+    /**
+     * Push the record into the queue, applying the overflow policy when the
+     * queue is full.
+     *
+     * @param record Record to be pushed.
+     *
+     * @return True if the record was pushed and false if it was dropped.
+     */
+    bool push(LogRecord & record);
+
+    /**
+     * Writer thread main loop, drains the queue until the logger is
+     * destroyed.
+     */
+    void writerLoop();
+
+    /**
+     * Pop a batch of records from the queue, format their headers and write
+     * the headers and messages with a single writev() in the file.
+     *
+     * @return Quantity of records popped.
+     */
+    size_t writeBatch();
+
+    /**
+     * Wake up the writer thread if it's sleeping.
+     */
+    void wakeWriter();
+
+    /**
+     * Writer thread main loop in buffered mode, writes periodically the
+     * buffers of all threads until the logger is destroyed.
+     */
+    void flusherLoop();
+
+    /**
+     * Get the buffer of the calling thread, creating it in the first call.
+     *
+     * @return Buffer of the thread.
+     */
+    LogThreadBuffer & getThreadBuffer();
+
+    /**
+     * Write the records of a thread buffer, must be called with the buffer
+     * lock.
+     *
+     * @param buffer Thread buffer.
+     */
+    void writeBuffer(LogThreadBuffer & buffer);
+
+    /**
+     * Write the buffers of all threads, releasing those of threads that
+     * have exited.
+     *
+     * @param isClosing True when the logger is being destroyed.
+     */
+    void writeBuffers(const bool & isClosing);
+
+    /**
+     * Stop the writer thread after writing every record queued.
+     */
+    void stopWriter();
+
+    static const size_t BatchSize = 256; ///< Maximum records written at once by the writer thread.
 
     LogSetting _logSetting; ///< All log behaviour settings.
+    LogFile _logFile; ///< File where the records are written.
+    std::atomic<const LogFormat *> _infoFormat; ///< Info format compiled, replaced while other threads render with it.
+    std::vector<std::unique_ptr<LogFormat>> _infoFormats; ///< Info formats compiled, freed only with the logger.
     std::mutex _mtxLog; ///< Protection for multiple threads trying to write a log.
+    bool _isShared; ///< Records written in parallel (synchronous, text or JSON, persistent file without rotation).
+    LogSharedGate _gateShared; ///< Entered by the threads writing in parallel, exclusive to change the file.
+    std::atomic<bool> _hasSinks; ///< Sinks attached, the records are written with the log lock.
+    std::atomic<bool> _isClosed; ///< Logger was closed, records are discarded.
+    std::atomic<bool> _isEnable; ///< Logger is enabled, changed while other threads log.
+    std::atomic<int> _activeSeverity; ///< Severitys allowed to log, changed while other threads log.
+    bool _isReleased; ///< Log file was closed by close(), protected by the log lock.
+    bool _isBinary; ///< Records are written in binary format.
+    bool _isJson; ///< Records are written as JSON objects.
+    std::string _jsonFields; ///< Fields of the logger encoded in JSON.
+    bool _isFormatPending; ///< Format and sites must be written before the next records.
+    LogSiteMap _sites; ///< Call sites known in binary format.
+    std::shared_mutex _mtxSites; ///< Protection for the call sites read without the log lock.
+    std::unique_ptr<LogCrashBuffer> _crashBuffer; ///< Recent records dumped on crash, null if disabled.
+    int _crashSeverity; ///< Severitys kept in the crash buffer, 0 if disabled.
+    std::unique_ptr<LogRateLimiter> _rateLimiter; ///< Token bucket of each call site, null if disabled.
+
+    std::unique_ptr<LogQueue<LogRecord>> _queue; ///< Records waiting for the writer thread.
+    std::thread _writer; ///< Writer thread used in asynchronous mode.
+    std::atomic<bool> _isWriterRunning; ///< Writer thread must keep running.
+    LogSharedGate _gateQueue; ///< Entered by the threads pushing records, exclusive to stop the writer thread.
+    std::atomic<bool> _isWriterSleeping; ///< Writer thread is waiting for records.
+    std::atomic<unsigned long long> _qtyQueued; ///< Records pushed into the queue.
+    std::atomic<unsigned long long> _qtyDone; ///< Records popped from the queue.
+    std::atomic<unsigned long long> _qtyDropped; ///< Records dropped not yet reported.
+    std::mutex _mtxWriter; ///< Protection for the writer thread conditions.
+    std::condition_variable _cvWriter; ///< Wake up the writer thread.
+    std::condition_variable _cvDone; ///< Notify threads waiting the queue drain.
+    std::string _batch; ///< Buffer reused to format the headers.
+    std::vector<LogRecord> _records; ///< Records popped by the writer thread.
+    std::vector<size_t> _headerEnds; ///< End of each header in the batch buffer.
+    std::vector<struct iovec> _iov; ///< Header, message and line break of each record of the batch.
+
+    std::vector<std::shared_ptr<LogSink>> _sinks; ///< Sinks attached, protected by the log lock.
+    std::vector<LogSinkRecord> _sinkRecords; ///< Records of a write given to the sinks.
+    std::vector<LogSinkRecord> _sinkSelected; ///< Records accepted by a sink.
+    std::vector<struct iovec> _sinkIov; ///< Fragments of the records of a thread buffer.
+
+    unsigned long _id; ///< Unique id used to find the thread buffers.
+    std::vector<std::shared_ptr<LogThreadBuffer>> _buffers; ///< Buffers of all threads in buffered mode.
+    std::mutex _mtxBuffers; ///< Protection for the list of thread buffers.
+
+    LogThreadCounter _qtyRecordsWritten; ///< Records written to the log file.
+    LogThreadCounter _qtyRecordsFiltered; ///< Records not written because of their severity, counted without read-modify-write.
+    LogCounter _qtyRecordsDropped; ///< Records dropped since the logger was built.
+    LogCounter _qtyRecordsSuppressed; ///< Records suppressed by the rate limit.
+    LogThreadCounter _qtyBytesWritten; ///< Bytes written to the log file.
+    std::atomic<size_t> _queueHighWater; ///< Most records seen in the queue by the writer thread.
+    std::atomic<unsigned long long> _lockWaitTime; ///< Time (ns) spent waiting for the log lock.
+    LogHistogram _writeLatency; ///< Latency of the writes to the log file.
+    LogHistogram _flushLatency; ///< Latency of the flushes of the log file.
 };
 
 #endif // LOG_H_
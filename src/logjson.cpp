@@ -0,0 +1,175 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Ismael Filipe Mesquita Ribeiro - nakinx
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "logjson.h"
+#include "logstream.h"
+
+#include <cstring>
+
+/**
+ * Check if any byte of the word needs to be escaped: control characters,
+ * quote or backslash.
+ *
+ * @param word Eight bytes of the string.
+ *
+ * @return True if a byte must be escaped and false otherwise.
+ */
+static inline bool needsEscape(const uint64_t & word) {
+    const uint64_t ones = 0x0101010101010101ULL;
+    const uint64_t highs = 0x8080808080808080ULL;
+    uint64_t quote = word ^ (ones * '"');
+    uint64_t backslash = word ^ (ones * '\\');
+
+    // A byte is zero, or below 0x20, when subtracting sets its high bit and
+    // it wasn't set before.
+    return ((((word - (ones * 0x20)) & ~word) |
+             ((quote - ones) & ~quote) |
+             ((backslash - ones) & ~backslash)) & highs) != 0;
+}
+
+void LogJson::escape(std::string & out,
+                     const char * data,
+                     const size_t & len) {
+    static const char hex[] = "0123456789abcdef";
+    const char * end = data + len;
+    const char * run = data;
+    const char * p = data;
+
+    // The characters not escaped are copied in runs, checked a word at a
+    // time.
+    for (; p < end; p++) {
+        while ((end - p) >= 8) {
+            uint64_t word;
+
+            memcpy(&word, p, sizeof(word));
+
+            if (needsEscape(word))
+                break;
+
+            p += 8;
+        }
+
+        if (p >= end)
+            break;
+
+        unsigned char c = static_cast<unsigned char>(*p);
+
+        if ((c >= 0x20) && (c != '"') && (c != '\\'))
+            continue;
+
+        out.append(run, p - run);
+        run = p + 1;
+
+        switch (c) {
+            case '"' : out.append("\\\"", 2); break;
+            case '\\' : out.append("\\\\", 2); break;
+            case '\n' : out.append("\\n", 2); break;
+            case '\r' : out.append("\\r", 2); break;
+            case '\t' : out.append("\\t", 2); break;
+            case '\b' : out.append("\\b", 2); break;
+            case '\f' : out.append("\\f", 2); break;
+            default : {
+                char u[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0x0f] };
+                out.append(u, sizeof(u));
+                break;
+            }
+        }
+    }
+
+    out.append(run, end - run);
+}
+
+void LogJson::appendField(std::string & out,
+                          const std::string & key,
+                          const std::string & value) {
+    out.append(",\"", 2);
+    escape(out, key.data(), key.length());
+    out.append("\":\"", 3);
+    escape(out, value.data(), value.length());
+    out += '"';
+}
+
+void LogJson::appendTimestamp(std::string & out,
+                              const std::chrono::system_clock::time_point & time) {
+    thread_local std::time_t cachedSecond = -1;
+    thread_local char cachedText[32];
+    thread_local size_t cachedLen = 0;
+
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+    std::time_t second = static_cast<std::time_t>(ms / 1000);
+    int milliseconds = static_cast<int>(ms % 1000);
+
+    // Times before the epoch.
+    if (milliseconds < 0) {
+        second--;
+        milliseconds += 1000;
+    }
+
+    if (second != cachedSecond) {
+        struct tm tmUtc;
+
+        gmtime_r(&second, &tmUtc);
+        cachedLen = strftime(cachedText, sizeof(cachedText), "%Y-%m-%dT%H:%M:%S", &tmUtc);
+        cachedSecond = second;
+    }
+
+    char fraction[6] = { '.',
+                         static_cast<char>('0' + (milliseconds / 100)),
+                         static_cast<char>('0' + ((milliseconds / 10) % 10)),
+                         static_cast<char>('0' + (milliseconds % 10)),
+                         'Z', '"' };
+
+    out.append(cachedText, cachedLen);
+    out.append(fraction, sizeof(fraction));
+}
+
+void LogJson::appendRecord(std::string & out,
+                           const std::chrono::system_clock::time_point & time,
+                           std::string_view severity,
+                           const uint64_t & thread,
+                           std::string_view file,
+                           std::string_view function,
+                           const int & line,
+                           std::string_view msg,
+                           const std::string & fields) {
+    char number[24];
+
+    out.append("{\"timestamp\":\"", 14);
+    appendTimestamp(out, time);
+    out.append(",\"severity\":\"", 13);
+    out += severity;
+    out.append("\",\"thread\":", 11);
+    out.append(number, LogStream::formatDecimal(number, thread) - number);
+    out.append(",\"file\":\"", 9);
+    escape(out, file.data(), file.length());
+    out.append("\",\"function\":\"", 14);
+    escape(out, function.data(), function.length());
+    out.append("\",\"line\":", 9);
+    out.append(number, LogStream::formatDecimal(number, line) - number);
+    out.append(",\"message\":\"", 12);
+    escape(out, msg.data(), msg.length());
+    out += '"';
+    out += fields;
+    out += '}';
+}
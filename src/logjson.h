@@ -0,0 +1,104 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Ismael Filipe Mesquita Ribeiro - nakinx
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LOG_JSON_
+#define LOG_JSON_
+
+#include <string>
+#include <string_view>
+#include <chrono>
+#include <ctime>
+#include <cstdint>
+
+/**
+ * Encoding of the records as JSON objects, one per line:
+ *
+ *     {"timestamp":"2024-01-31T12:34:56.789Z","severity":"info",
+ *      "thread":1234,"file":"main.cpp","function":"int main()","line":10,
+ *      "message":"Text","<field>":"<value>",...}
+ *
+ * The timestamp is in UTC. The strings are escaped straight into the
+ * output, the bytes above 0x7f are copied as they're (UTF-8).
+ */
+class LogJson {
+
+public:
+    /**
+     * Append a string escaped, without the quotes.
+     *
+     * @param out Output where the string will be appended.
+     * @param data String to be escaped.
+     * @param len Length of the string.
+     */
+    static void escape(std::string & out,
+                       const char * data,
+                       const size_t & len);
+
+    /**
+     * Append a field with a string value, preceded by a comma.
+     *
+     * @param out Output where the field will be appended.
+     * @param key Name of the field.
+     * @param value Value of the field.
+     */
+    static void appendField(std::string & out,
+                            const std::string & key,
+                            const std::string & value);
+
+    /**
+     * Append the record as a JSON object, without the line break.
+     *
+     * @param out Output where the record will be appended.
+     * @param time When the record was created.
+     * @param severity Name of the severity of the record.
+     * @param thread Id of the thread logging.
+     * @param file File where log was invoked.
+     * @param function Function where log was invoked.
+     * @param line Line where log was invoked.
+     * @param msg Log message.
+     * @param fields Fields of the logger already encoded by appendField().
+     */
+    static void appendRecord(std::string & out,
+                             const std::chrono::system_clock::time_point & time,
+                             std::string_view severity,
+                             const uint64_t & thread,
+                             std::string_view file,
+                             std::string_view function,
+                             const int & line,
+                             std::string_view msg,
+                             const std::string & fields);
+
+private:
+    /**
+     * Append the timestamp in UTC with milliseconds, the date and time are
+     * kept per thread and only rendered again in the next second.
+     *
+     * @param out Output where the timestamp will be appended.
+     * @param time Time to be appended.
+     */
+    static void appendTimestamp(std::string & out,
+                                const std::chrono::system_clock::time_point & time);
+};
+
+#endif // LOG_JSON_
@@ -0,0 +1,266 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Ismael Filipe Mesquita Ribeiro - nakinx
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "logmetrics.h"
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+/**
+ * Slots of a thread, one for each LogThreadCounter. Taken again by a new
+ * thread when its thread finishes, with the counts left.
+ */
+struct LogThreadSlots {
+    std::atomic<std::atomic<unsigned long long> *> pages[LogThreadCounter::MaxPages] = {}; ///< Pages of slots, null if not used yet.
+    std::atomic<bool> isFree; ///< Thread finished, the slots can be taken.
+    LogThreadSlots * next; ///< Next slots of the registry.
+};
+
+/**
+ * Slots of the threads and the slots taken by the counters. The slots of
+ * the threads are never deleted, so they are summed without lock.
+ */
+struct LogThreadCounterRegistry {
+    std::mutex mtx; ///< Protection for the slots taken.
+    std::vector<bool> isUsed; ///< Slots taken by a counter, grown a page at a time.
+    std::atomic<LogThreadSlots *> threads { nullptr }; ///< Slots of the threads, the last one created first.
+};
+
+/**
+ * Return the registry, never destroyed as threads may still count while
+ * the application exits.
+ *
+ * @return Registry of the slots.
+ */
+static LogThreadCounterRegistry & getThreadRegistry() {
+    static LogThreadCounterRegistry * registry = new LogThreadCounterRegistry();
+    return *registry;
+}
+
+/**
+ * Return the sum of a slot in all threads.
+ *
+ * @param slot Slot.
+ * @param order Order of the reads of the counts.
+ *
+ * @return Sum of the slot.
+ */
+static unsigned long long sumSlot(const size_t & slot,
+                                  const std::memory_order & order) {
+    unsigned long long total = 0;
+
+    // The slots and pages are read in the same total order as the counts
+    // of a LogSharedGate, a thread counting is never missed.
+    for (LogThreadSlots * thread = getThreadRegistry().threads.load(std::memory_order_seq_cst);
+         thread != nullptr; thread = thread->next) {
+        std::atomic<unsigned long long> * counts = thread->pages[slot / LogThreadCounter::PageSlots].load(std::memory_order_seq_cst);
+
+        if (counts != nullptr)
+            total += counts[slot % LogThreadCounter::PageSlots].load(order);
+    }
+
+    return total;
+}
+
+/**
+ * Owner of the slots of a thread, freeing them when the thread finishes.
+ */
+struct LogThreadSlotsOwner {
+    LogThreadSlots * slots = nullptr; ///< Slots of the thread.
+
+    ~LogThreadSlotsOwner();
+};
+
+thread_local std::atomic<unsigned long long> * LogThreadCounter::_threadPages[LogThreadCounter::MaxPages] = {};
+static thread_local LogThreadSlots * threadSlots = nullptr;
+static thread_local LogThreadSlotsOwner threadSlotsOwner;
+static thread_local bool isThreadFinished = false;
+
+LogThreadSlotsOwner::~LogThreadSlotsOwner() {
+    if (slots == nullptr)
+        return;
+
+    for (auto & counts : LogThreadCounter::_threadPages)
+        counts = nullptr;
+
+    threadSlots = nullptr;
+    isThreadFinished = true;
+
+    // The counts of the thread are done before the next thread adds to them.
+    slots->isFree.store(true, std::memory_order_release);
+}
+
+LogThreadCounter::LogThreadCounter()
+    : _slot(PageSlots * MaxPages),
+      _base(0) {
+    LogThreadCounterRegistry & registry = getThreadRegistry();
+    std::lock_guard<std::mutex> lk(registry.mtx);
+
+    size_t slot = std::find(registry.isUsed.begin(), registry.isUsed.end(), false) - registry.isUsed.begin();
+
+    // All slots taken, one more page for the threads.
+    if (slot == registry.isUsed.size()) {
+        if (slot == (PageSlots * MaxPages))
+            return;
+
+        registry.isUsed.resize(slot + PageSlots, false);
+    }
+
+    registry.isUsed[slot] = true;
+    _slot = slot;
+    _base = sumSlot(slot, std::memory_order_relaxed);
+}
+
+LogThreadCounter::~LogThreadCounter() {
+    if (_slot == (PageSlots * MaxPages))
+        return;
+
+    LogThreadCounterRegistry & registry = getThreadRegistry();
+    std::lock_guard<std::mutex> lk(registry.mtx);
+
+    registry.isUsed[_slot] = false;
+}
+
+unsigned long long LogThreadCounter::get(const std::memory_order & order) const {
+    if (_slot == (PageSlots * MaxPages))
+        return _shared.get(order);
+
+    return (sumSlot(_slot, order) - _base);
+}
+
+std::atomic<unsigned long long> * LogThreadCounter::registerPage(const size_t & page) {
+    LogThreadCounterRegistry & registry = getThreadRegistry();
+
+    if (threadSlots == nullptr) {
+        // The slots of a thread finished are taken first.
+        for (LogThreadSlots * thread = registry.threads.load(std::memory_order_seq_cst);
+             (thread != nullptr) && (threadSlots == nullptr); thread = thread->next) {
+            bool isFree = true;
+
+            if (thread->isFree.load(std::memory_order_relaxed) &&
+                thread->isFree.compare_exchange_strong(isFree, false, std::memory_order_acquire))
+                threadSlots = thread;
+        }
+
+        if (threadSlots == nullptr) {
+            threadSlots = new LogThreadSlots();
+            threadSlots->isFree.store(false, std::memory_order_relaxed);
+            threadSlots->next = registry.threads.load(std::memory_order_relaxed);
+
+            while (!registry.threads.compare_exchange_weak(threadSlots->next, threadSlots, std::memory_order_seq_cst))
+                ;
+        }
+
+        // Counting while the thread finishes, after its owner was destroyed,
+        // keeps the slots taken forever.
+        if (!isThreadFinished)
+            threadSlotsOwner.slots = threadSlots;
+    }
+
+    std::atomic<unsigned long long> * counts = threadSlots->pages[page].load(std::memory_order_relaxed);
+
+    if (counts == nullptr) {
+        counts = new std::atomic<unsigned long long>[PageSlots];
+
+        for (size_t i = 0; i < PageSlots; i++)
+            counts[i].store(0, std::memory_order_relaxed);
+
+        threadSlots->pages[page].store(counts, std::memory_order_seq_cst);
+    }
+
+    _threadPages[page] = counts;
+
+    return counts;
+}
+
+long long LogLatency::getPercentile(const double & percentile) const {
+    if (qty == 0)
+        return 0;
+
+    unsigned long long rank = static_cast<unsigned long long>(percentile * qty);
+    unsigned long long qtySeen = 0;
+
+    for (size_t i = 0; i < Buckets; i++) {
+        qtySeen += counts[i];
+
+        if (qtySeen > rank)
+            return (i < (Buckets - 1)) ? std::min((2LL << i) - 1, max) : max;
+    }
+
+    return max;
+}
+
+LogHistogram::LogHistogram() {
+    _max.store(0, std::memory_order_relaxed);
+}
+
+void LogHistogram::record(const long long & ns) {
+    size_t bucket = 0;
+
+    if (ns > 1)
+        bucket = 63 - __builtin_clzll(static_cast<unsigned long long>(ns));
+
+    if (bucket >= LogLatency::Buckets)
+        bucket = LogLatency::Buckets - 1;
+
+    _counts[bucket].add();
+
+    // Only a new maximum writes the value shared by the threads.
+    long long max = _max.load(std::memory_order_relaxed);
+
+    while ((ns > max) && !_max.compare_exchange_weak(max, ns, std::memory_order_relaxed));
+}
+
+void LogHistogram::snapshot(LogLatency & latency) const {
+    latency.qty = 0;
+
+    for (size_t i = 0; i < LogLatency::Buckets; i++) {
+        latency.counts[i] = _counts[i].get();
+        latency.qty += latency.counts[i];
+    }
+
+    latency.max = _max.load(std::memory_order_relaxed);
+}
+
+std::string LogMetrics::toString() const {
+    std::string text = "Metrics of the logger (" + name + "):";
+
+    text += " written=" + std::to_string(qtyRecordsWritten);
+    text += " filtered=" + std::to_string(qtyRecordsFiltered);
+    text += " dropped=" + std::to_string(qtyRecordsDropped);
+    text += " suppressed=" + std::to_string(qtyRecordsSuppressed);
+    text += " bytes=" + std::to_string(qtyBytesWritten);
+    text += " queue_high_water=" + std::to_string(queueHighWater);
+    text += " lock_wait_ns=" + std::to_string(lockWaitTime);
+    text += " writes=" + std::to_string(writeLatency.qty);
+    text += " write_p50_ns=" + std::to_string(writeLatency.getPercentile(0.5));
+    text += " write_p99_ns=" + std::to_string(writeLatency.getPercentile(0.99));
+    text += " write_max_ns=" + std::to_string(writeLatency.max);
+    text += " flushes=" + std::to_string(flushLatency.qty);
+    text += " flush_p99_ns=" + std::to_string(flushLatency.getPercentile(0.99));
+    text += " flush_max_ns=" + std::to_string(flushLatency.max);
+
+    return text;
+}
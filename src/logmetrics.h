@@ -0,0 +1,246 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Ismael Filipe Mesquita Ribeiro - nakinx
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LOG_METRICS_
+#define LOG_METRICS_
+
+#include <string>
+#include <atomic>
+
+/**
+ * Counter incremented by many threads, split in shards each in its own
+ * cache line. A thread always increments the same shard with a relaxed
+ * operation, so the threads don't contend on it; reading sums all shards.
+ */
+class LogCounter {
+
+public:
+    LogCounter() {
+        for (auto & shard : _shards)
+            shard.value.store(0, std::memory_order_relaxed);
+    }
+
+    void add(const unsigned long long & value = 1,
+             const std::memory_order & order = std::memory_order_relaxed) {
+        _shards[getShard()].value.fetch_add(value, order);
+    }
+
+    unsigned long long get(const std::memory_order & order = std::memory_order_relaxed) const {
+        unsigned long long total = 0;
+
+        for (auto & shard : _shards)
+            total += shard.value.load(order);
+
+        return total;
+    }
+
+private:
+    LogCounter(LogCounter const &) = delete;
+    void operator=(LogCounter const &) = delete;
+
+    static const size_t Shards = 16; ///< Shards of each counter.
+
+    /**
+     * Return the shard of the calling thread, given in turns to the threads.
+     *
+     * @return Index of the shard.
+     */
+    static size_t getShard() {
+        static std::atomic<size_t> nextShard(0);
+        thread_local size_t shard = nextShard.fetch_add(1, std::memory_order_relaxed) % Shards;
+
+        return shard;
+    }
+
+    /**
+     * Part of the counter, one by cache line.
+     */
+    struct alignas(64) Shard {
+        std::atomic<unsigned long long> value; ///< Increments of the threads of the shard.
+    };
+
+    Shard _shards[Shards]; ///< Parts of the counter.
+};
+
+/**
+ * Counter incremented by many threads on their hot paths, each thread in
+ * its own slot with a plain load and store instead of a read-modify-write.
+ * Reading sums the slots of all threads, including the threads already
+ * finished, so it's slower than LogCounter::get().
+ *
+ * The slots of a thread are allocated in pages, a page on the first add()
+ * of the thread to one of its counters (8 bytes by slot), so the slots grow
+ * with the counters created. The counters beyond the last page count in a
+ * LogCounter. The slots of a thread finished go to the next thread created
+ * with their counts, so get() reads them without lock.
+ */
+class LogThreadCounter {
+
+public:
+    static const size_t PageSlots = 1024; ///< Slots of a page.
+    static const size_t MaxPages = 256; ///< Pages of each thread.
+
+    /**
+     * Constructor, takes a free slot.
+     */
+    LogThreadCounter();
+
+    /**
+     * Destructor, releases the slot.
+     */
+    ~LogThreadCounter();
+
+    /**
+     * Add to the count of the calling thread.
+     *
+     * @param value Value added.
+     * @param order Order of the write, relaxed unless the count synchronizes
+     *        the threads (see LogSharedGate).
+     */
+    void add(const unsigned long long & value = 1,
+             const std::memory_order & order = std::memory_order_relaxed) {
+        if (_slot < (PageSlots * MaxPages)) {
+            std::atomic<unsigned long long> * counts = _threadPages[_slot / PageSlots];
+
+            if (counts == nullptr)
+                counts = registerPage(_slot / PageSlots);
+
+            // Only this thread changes its slot.
+            std::atomic<unsigned long long> & count = counts[_slot % PageSlots];
+
+            count.store(count.load(std::memory_order_relaxed) + value, order);
+        } else {
+            _shared.add(value, order);
+        }
+    }
+
+    /**
+     * Return the sum of the counts of all threads.
+     *
+     * @param order Order of the reads of the counts.
+     *
+     * @return Count.
+     */
+    unsigned long long get(const std::memory_order & order = std::memory_order_relaxed) const;
+
+private:
+    LogThreadCounter(LogThreadCounter const &) = delete;
+    void operator=(LogThreadCounter const &) = delete;
+
+    friend struct LogThreadSlotsOwner;
+
+    /**
+     * Create a page of slots of the calling thread.
+     *
+     * @param page Index of the page.
+     *
+     * @return Slots of the page.
+     */
+    static std::atomic<unsigned long long> * registerPage(const size_t & page);
+
+    static thread_local std::atomic<unsigned long long> * _threadPages[MaxPages]; ///< Pages of the thread, null before the first add() to a counter of the page.
+
+    size_t _slot; ///< Slot of the counter in each thread, PageSlots * MaxPages if none was free.
+    unsigned long long _base; ///< Sum of the slot when taken, left by a previous counter.
+    LogCounter _shared; ///< Counter used when no slot was free.
+};
+
+/**
+ * Distribution of latencies in buckets of powers of two, the bucket i has
+ * the latencies from 2^i to 2^(i+1) - 1 ns (the last one everything above).
+ */
+struct LogLatency {
+    static const size_t Buckets = 40; ///< Buckets up to 2^40 ns (about 18 minutes).
+
+    unsigned long long qty; ///< Latencies measured.
+    unsigned long long counts[Buckets]; ///< Latencies of each bucket.
+    long long max; ///< Maximum latency (ns).
+
+    /**
+     * Return the latency under which the given part of them is, rounded up
+     * to the end of its bucket.
+     *
+     * @param percentile Part of the latencies, from 0 to 1 (e.g. 0.99).
+     *
+     * @return Latency (ns) or 0 if none was measured.
+     */
+    long long getPercentile(const double & percentile) const;
+};
+
+/**
+ * Histogram of latencies updated by the threads, each bucket counted in the
+ * slots of the threads.
+ */
+class LogHistogram {
+
+public:
+    LogHistogram();
+
+    /**
+     * Count a latency.
+     *
+     * @param ns Latency in nanoseconds.
+     */
+    void record(const long long & ns);
+
+    /**
+     * Copy the latencies counted, the buckets are read one by one while
+     * other threads may count.
+     *
+     * @param latency Output with the latencies.
+     */
+    void snapshot(LogLatency & latency) const;
+
+private:
+    LogHistogram(LogHistogram const &) = delete;
+    void operator=(LogHistogram const &) = delete;
+
+    LogThreadCounter _counts[LogLatency::Buckets]; ///< Latencies of each bucket.
+    std::atomic<long long> _max; ///< Maximum latency (ns).
+};
+
+/**
+ * Snapshot of the counters kept by a logger about its own cost.
+ */
+struct LogMetrics {
+    std::string name; ///< Logger name.
+    unsigned long long qtyRecordsWritten; ///< Records written to the log file.
+    unsigned long long qtyRecordsFiltered; ///< Records not written because of their severity.
+    unsigned long long qtyRecordsDropped; ///< Records dropped because the asynchronous queue was full.
+    unsigned long long qtyRecordsSuppressed; ///< Records suppressed by the rate limit.
+    unsigned long long qtyBytesWritten; ///< Bytes written to the log file.
+    size_t queueHighWater; ///< Most records seen in the asynchronous queue, 0 in other modes.
+    unsigned long long lockWaitTime; ///< Time (ns) spent waiting for the log lock.
+    LogLatency writeLatency; ///< Latency of the writes to the log file.
+    LogLatency flushLatency; ///< Latency of the flushes of the log file.
+
+    /**
+     * Return the metrics in a single line of key=value pairs.
+     *
+     * @return Text of the metrics.
+     */
+    std::string toString() const;
+};
+
+#endif // LOG_METRICS_
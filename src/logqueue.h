@@ -0,0 +1,177 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Ismael Filipe Mesquita Ribeiro - nakinx
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LOG_QUEUE_
+#define LOG_QUEUE_
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Bounded lock-free queue based on a ring buffer where each cell carries a
+ * sequence number (D. Vyukov's algorithm).
+ *
+ * Any thread may push or pop, the logger uses it with several producers and
+ * one consumer (the writer thread), producers only pop to discard the
+ * oldest record when the queue is full.
+ */
+template <typename T>
+class LogQueue {
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param capacity Maximum number of elements, rounded up to a power
+     *                 of two.
+     */
+    explicit LogQueue(size_t capacity) {
+        size_t size = 2;
+
+        while (size < capacity)
+            size <<= 1;
+
+        _mask = size - 1;
+        _cells.reset(new Cell[size]);
+
+        for (size_t i = 0; i < size; i++)
+            _cells[i].sequence.store(i, std::memory_order_relaxed);
+
+        _enqueuePos.store(0, std::memory_order_relaxed);
+        _dequeuePos.store(0, std::memory_order_relaxed);
+    }
+
+    /**
+     * Push an element at the end of the queue.
+     *
+     * @param value Element to be moved into the queue, it's untouched if the
+     *              queue is full.
+     *
+     * @return True if the element was pushed and false if the queue is full.
+     */
+    bool tryPush(T & value) {
+        Cell * cell;
+        size_t pos = _enqueuePos.load(std::memory_order_relaxed);
+
+        for (;;) {
+            cell = &_cells[pos & _mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+
+            if (diff == 0) {
+                if (_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (diff < 0) {
+                return false; // Queue is full.
+            } else {
+                pos = _enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->data = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    /**
+     * Pop the element at the beginning of the queue.
+     *
+     * @param value Where the element will be moved to.
+     *
+     * @return True if an element was popped and false if the queue is empty.
+     */
+    bool tryPop(T & value) {
+        Cell * cell;
+        size_t pos = _dequeuePos.load(std::memory_order_relaxed);
+
+        for (;;) {
+            cell = &_cells[pos & _mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+
+            if (diff == 0) {
+                if (_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (diff < 0) {
+                return false; // Queue is empty.
+            } else {
+                pos = _dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        value = std::move(cell->data);
+        cell->sequence.store(pos + _mask + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    /**
+     * Check if the queue looks empty, the answer may be outdated as soon as
+     * it's returned.
+     *
+     * @return True if the queue is empty and false otherwise.
+     */
+    bool isEmpty() const {
+        return (_enqueuePos.load(std::memory_order_seq_cst) ==
+                _dequeuePos.load(std::memory_order_seq_cst));
+    }
+
+    /**
+     * Return the maximum number of elements.
+     *
+     * @return Queue capacity.
+     */
+    size_t capacity() const {
+        return (_mask + 1);
+    }
+
+private:
+    LogQueue(LogQueue const &) = delete;
+    void operator=(LogQueue const &) = delete;
+
+    /**
+     * Queue cell with the element and its sequence number.
+     */
+    struct Cell {
+        std::atomic<size_t> sequence; ///< Position of the cell in the ring.
+        T data; ///< Element stored.
+    };
+
+    static const size_t CacheLine = 64;
+
+    std::unique_ptr<Cell[]> _cells; ///< Ring buffer.
+    size_t _mask; ///< Mask to convert positions in cells index.
+    char _pad0[CacheLine]; ///< Keep producers and consumer positions in different cache lines.
+    std::atomic<size_t> _enqueuePos; ///< Next position to push.
+    char _pad1[CacheLine]; ///< Keep producers and consumer positions in different cache lines.
+    std::atomic<size_t> _dequeuePos; ///< Next position to pop.
+    char _pad2[CacheLine]; ///< Keep producers and consumer positions in different cache lines.
+};
+
+#endif // LOG_QUEUE_
@@ -0,0 +1,130 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Ismael Filipe Mesquita Ribeiro - nakinx
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "logratelimiter.h"
+
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+
+LogRateLimiter::LogRateLimiter(const size_t & rate,
+                               const size_t & burst,
+                               const size_t & capacity)
+    : _capacity(1),
+      _interval(1000000000LL / static_cast<long long>(std::max<size_t>(rate, 1))),
+      _tolerance(_interval * static_cast<long long>(std::max<size_t>(burst, 1))) {
+    while (_capacity < capacity)
+        _capacity <<= 1;
+
+    _buckets.reset(new Bucket[_capacity]);
+
+    for (size_t i = 0; i < _capacity; i++) {
+        _buckets[i].site.store(nullptr, std::memory_order_relaxed);
+        _buckets[i].full.store(0, std::memory_order_relaxed);
+        _buckets[i].qtySuppressed.store(0, std::memory_order_relaxed);
+    }
+}
+
+bool LogRateLimiter::acquire(const LogCallSite & site,
+                             unsigned long long & qtySuppressed) {
+    qtySuppressed = 0;
+
+    Bucket * bucket = findBucket(site);
+
+    if (bucket == nullptr)
+        return true;
+
+    long long time = now();
+    long long full = bucket->full.load(std::memory_order_relaxed);
+
+    // The bucket is empty when taking a token would put its full time
+    // further than the whole burst.
+    for (;;) {
+        long long next = std::max(full, time) + _interval;
+
+        if ((next - time) > _tolerance) {
+            bucket->qtySuppressed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        if (bucket->full.compare_exchange_weak(full, next, std::memory_order_relaxed))
+            break;
+    }
+
+    // Loaded first to not write the cache line of every record allowed.
+    if (bucket->qtySuppressed.load(std::memory_order_relaxed) > 0)
+        qtySuppressed = bucket->qtySuppressed.exchange(0, std::memory_order_relaxed);
+
+    return true;
+}
+
+void LogRateLimiter::takeSuppressed(const bool & isAll,
+                                    const std::function<void(const LogCallSite &, unsigned long long)> & callback) {
+    long long time = now();
+
+    for (size_t i = 0; i < _capacity; i++) {
+        Bucket & bucket = _buckets[i];
+        const LogCallSite * site = bucket.site.load(std::memory_order_acquire);
+
+        if ((site == nullptr) || (bucket.qtySuppressed.load(std::memory_order_relaxed) == 0))
+            continue;
+
+        if (!isAll &&
+            ((std::max(bucket.full.load(std::memory_order_relaxed), time) + _interval - time) > _tolerance))
+            continue;
+
+        unsigned long long qtySuppressed = bucket.qtySuppressed.exchange(0, std::memory_order_relaxed);
+
+        if (qtySuppressed > 0)
+            callback(*site, qtySuppressed);
+    }
+}
+
+LogRateLimiter::Bucket * LogRateLimiter::findBucket(const LogCallSite & site) {
+    // The call sites are static, their addresses are spread by the hash.
+    size_t i = static_cast<size_t>(((reinterpret_cast<uintptr_t>(&site) >> 4) * 0x9E3779B97F4A7C15ULL) >> 32);
+
+    size_t qtyProbes = std::min(_capacity, MaxProbes);
+
+    for (size_t probe = 0; probe < qtyProbes; probe++, i++) {
+        Bucket & bucket = _buckets[i & (_capacity - 1)];
+        const LogCallSite * current = bucket.site.load(std::memory_order_acquire);
+
+        if (current == &site)
+            return &bucket;
+
+        if (current == nullptr) {
+            if (bucket.site.compare_exchange_strong(current, &site, std::memory_order_acq_rel) ||
+                (current == &site))
+                return &bucket;
+        }
+    }
+
+    return nullptr;
+}
+
+long long LogRateLimiter::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
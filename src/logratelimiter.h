@@ -0,0 +1,124 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Ismael Filipe Mesquita Ribeiro - nakinx
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LOG_RATE_LIMITER_
+#define LOG_RATE_LIMITER_
+
+#include "logcallsite.h"
+
+#include <atomic>
+#include <memory>
+#include <functional>
+
+/**
+ * Token bucket of each call site of a logger. A call site may log a burst
+ * of records at once, then only the rate per second given, the records
+ * above are suppressed and only counted.
+ *
+ * The buckets are kept in a table of fixed capacity, found without lock by
+ * the address of the call site. Each one is a single time updated by
+ * compare-and-swap (the time when the bucket will be full again), so the
+ * records allowed only pay a lookup and an atomic operation. A call site
+ * is only looked for in a few buckets after the one of its address, the
+ * call sites that find them all taken, as those beyond the capacity, aren't
+ * limited.
+ */
+class LogRateLimiter {
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param rate Records per second allowed for each call site.
+     * @param burst Records allowed at once for each call site.
+     * @param capacity Call sites limited, rounded up to a power of two.
+     */
+    LogRateLimiter(const size_t & rate,
+                   const size_t & burst,
+                   const size_t & capacity = 1024);
+
+    /**
+     * Take a token of the call site.
+     *
+     * @param site Call site of the record.
+     * @param qtySuppressed Records of the call site suppressed before this
+     *                      one and not reported yet, 0 if none.
+     *
+     * @return True if the record is allowed and false if suppressed.
+     */
+    bool acquire(const LogCallSite & site,
+                 unsigned long long & qtySuppressed);
+
+    /**
+     * Call the function for each call site with records suppressed not
+     * reported yet, considering them reported.
+     *
+     * @param isAll True to report all call sites and false only those whose
+     *              burst ended (the next record would be allowed).
+     * @param callback Function called with the call site and the quantity.
+     */
+    void takeSuppressed(const bool & isAll,
+                        const std::function<void(const LogCallSite &, unsigned long long)> & callback);
+
+private:
+    LogRateLimiter(LogRateLimiter const &) = delete;
+    void operator=(LogRateLimiter const &) = delete;
+
+    static const size_t MaxProbes = 16; ///< Buckets looked for a call site, so a miss doesn't scan the table.
+
+    /**
+     * Token bucket of a call site, one by cache line to not share it among
+     * threads logging from different call sites.
+     */
+    struct alignas(64) Bucket {
+        std::atomic<const LogCallSite *> site; ///< Call site, null if free, never replaced.
+        std::atomic<long long> full; ///< Time (ns) when the bucket is full again.
+        std::atomic<unsigned long long> qtySuppressed; ///< Records suppressed not reported yet.
+    };
+
+    /**
+     * Find the bucket of the call site, taking a free one in its first
+     * record.
+     *
+     * @param site Call site of the record.
+     *
+     * @return Bucket of the call site or null if the buckets probed are
+     *         taken by other call sites.
+     */
+    Bucket * findBucket(const LogCallSite & site);
+
+    /**
+     * Return the monotonic time used by the buckets.
+     *
+     * @return Time in nanoseconds.
+     */
+    static long long now();
+
+    std::unique_ptr<Bucket[]> _buckets; ///< Table of buckets, indexed by the address of the call site.
+    size_t _capacity; ///< Size of the table, power of two.
+    long long _interval; ///< Time (ns) to recover one token.
+    long long _tolerance; ///< Time (ns) to recover the whole burst.
+};
+
+#endif // LOG_RATE_LIMITER_
@@ -27,7 +27,59 @@
 
 #include <string>
 #include <mutex>
+#include <chrono>
+#include <vector>
+#include <utility>
 
+#include "logstaticformat.h"
+
+/**
+ * All types of severity level available to classify the log record.
+ */
+enum class SeverityLevel {
+    Debug = 0x01, ///< Informational events most useful for developers to debug application.
+    Fatal = 0x02, ///< Severe error information that will presumably abort application.
+    Error = 0x04, ///< Information representing errors in application but application will keep running.
+    Warning = 0x08, ///< Useful when application has potentially harmful situtaions.
+    Info = 0x10, ///< Mainly useful to represent current progress of application.
+    Unknown = 0x40 ///< Represents unknown level.
+};
+
+/**
+ * How the logger handles the log file.
+ */
+enum class FileMode {
+    Reopen, ///< Open and close the file for each record.
+    Persistent, ///< Keep the file open, reopen only when requested or when the file was moved.
+    Mmap ///< Keep the file open and write the records in windows of the file mapped in memory.
+};
+
+/**
+ * How the records are written to the log file.
+ */
+enum class WriteMode {
+    Sync, ///< The thread logging formats and writes the record.
+    Async, ///< The record is queued and a writer thread formats and writes it.
+    Buffered ///< The thread logging formats the record in its own buffer, written in large chunks.
+};
+
+/**
+ * How the records are encoded in the log file.
+ */
+enum class OutputFormat {
+    Text, ///< Header built with the info format followed by the message.
+    Binary, ///< Raw fields of the record, decoded later by logdecode.
+    Json ///< One JSON object per record, the info format isn't used.
+};
+
+/**
+ * What to do when the asynchronous queue is full.
+ */
+enum class OverflowPolicy {
+    Block, ///< Wait until the writer thread releases space in the queue.
+    DropNewest, ///< Discard the record being logged.
+    DropOldest ///< Discard the oldest record in the queue.
+};
 
 /**
  * Struct with log settings with informations about the log.
@@ -39,7 +91,27 @@ private:
     std::string _path; ///< Path where the log will be stored.
     bool _isEnable; ///< Enable or disable the logger.
     std::string _infoFormat; ///< Header with informations about the log record.
+    LogInfoRenderer _infoRenderer; ///< Renderer of the info format parsed at compile time.
     int _activeSeverity; ///< Severitys allowed to log.
+    FileMode _fileMode; ///< How the log file is handled.
+    std::chrono::milliseconds _fileCheckInterval; ///< Interval between checks if the file was moved.
+    size_t _mmapWindowSize; ///< Size of the window mapped in memory-mapped mode.
+    WriteMode _writeMode; ///< How the records are written.
+    size_t _queueCapacity; ///< Maximum of records waiting for the writer thread.
+    OverflowPolicy _overflowPolicy; ///< What to do when the queue is full.
+    size_t _flushSize; ///< Size of the thread buffer that triggers its write.
+    std::chrono::milliseconds _flushInterval; ///< Maximum time a record waits in a thread buffer.
+    int _flushSeverity; ///< Severitys that trigger the write of the thread buffer.
+    size_t _rotationSize; ///< Size of the log file that triggers its rotation, 0 to disable.
+    std::chrono::milliseconds _rotationInterval; ///< Age of the log file that triggers its rotation, 0 to disable.
+    size_t _maxFiles; ///< Quantity of files rotated retained, 0 to keep all.
+    bool _isCompress; ///< Compress the files rotated.
+    OutputFormat _outputFormat; ///< How the records are encoded.
+    std::vector<std::pair<std::string, std::string>> _fields; ///< Fields added to each record in JSON format.
+    size_t _crashBufferSize; ///< Size of the ring of recent records dumped on crash, 0 to disable.
+    int _crashSeverity; ///< Severitys kept in the crash ring, even if not active.
+    size_t _rateLimit; ///< Records per second allowed for each call site, 0 to disable.
+    size_t _rateBurst; ///< Records allowed at once for each call site.
 
 public:
     _LogSetting(const std::string name,
@@ -48,15 +120,50 @@ public:
         : _name(name),
           _path(path),
           _isEnable(isEnable),
-          _activeSeverity(0) {
+          _infoRenderer(nullptr),
+          _activeSeverity(0),
+          _fileMode(FileMode::Persistent),
+          _fileCheckInterval(1000),
+          _mmapWindowSize(4 * 1024 * 1024),
+          _writeMode(WriteMode::Sync),
+          _queueCapacity(8192),
+          _overflowPolicy(OverflowPolicy::Block),
+          _flushSize(64 * 1024),
+          _flushInterval(1000),
+          _flushSeverity(static_cast<int>(SeverityLevel::Error) |
+                         static_cast<int>(SeverityLevel::Fatal)),
+          _rotationSize(0),
+          _rotationInterval(0),
+          _maxFiles(0),
+          _isCompress(false),
+          _outputFormat(OutputFormat::Text),
+          _crashBufferSize(0),
+          _crashSeverity(static_cast<int>(SeverityLevel::Debug) |
+                         static_cast<int>(SeverityLevel::Fatal) |
+                         static_cast<int>(SeverityLevel::Error) |
+                         static_cast<int>(SeverityLevel::Warning) |
+                         static_cast<int>(SeverityLevel::Info)),
+          _rateLimit(0),
+          _rateBurst(0) {
     }
 
     void setEnable(const bool isEnable) {
         _isEnable = isEnable;
     }
 
-    void setInfo(const std::string infoFormat) {
+    void setInfo(const std::string infoFormat,
+                 LogInfoRenderer infoRenderer = nullptr) {
         _infoFormat = infoFormat;
+        _infoRenderer = infoRenderer;
+    }
+
+    /**
+     * Set the info format declared by LOG_STATIC_FORMAT(), parsed at
+     * compile time.
+     */
+    template<typename Format>
+    void setInfo() {
+        setInfo(std::string(Format::value), &LogStaticFormat<Format>::render);
     }
 
     bool isEnable() {
@@ -67,21 +174,166 @@ public:
         _activeSeverity = activeSeverity;
     }
 
-    std::string getInfo() {
+    const std::string & getInfo() const {
         return _infoFormat;
     }
 
-    std::string getName() {
+    LogInfoRenderer getInfoRenderer() const {
+        return _infoRenderer;
+    }
+
+    const std::string & getName() const {
         return _name;
     }
 
-    std::string getPath() {
+    const std::string & getPath() const {
         return _path;
     }
 
     int getActiveSeverity() {
         return _activeSeverity;
     }
+
+    void setFileMode(const FileMode fileMode) {
+        _fileMode = fileMode;
+    }
+
+    FileMode getFileMode() {
+        return _fileMode;
+    }
+
+    void setFileCheckInterval(const std::chrono::milliseconds fileCheckInterval) {
+        _fileCheckInterval = fileCheckInterval;
+    }
+
+    std::chrono::milliseconds getFileCheckInterval() {
+        return _fileCheckInterval;
+    }
+
+    void setMmapWindowSize(const size_t mmapWindowSize) {
+        _mmapWindowSize = mmapWindowSize;
+    }
+
+    size_t getMmapWindowSize() {
+        return _mmapWindowSize;
+    }
+
+    void setWriteMode(const WriteMode writeMode) {
+        _writeMode = writeMode;
+    }
+
+    WriteMode getWriteMode() {
+        return _writeMode;
+    }
+
+    void setQueueCapacity(const size_t queueCapacity) {
+        _queueCapacity = queueCapacity;
+    }
+
+    size_t getQueueCapacity() {
+        return _queueCapacity;
+    }
+
+    void setOverflowPolicy(const OverflowPolicy overflowPolicy) {
+        _overflowPolicy = overflowPolicy;
+    }
+
+    OverflowPolicy getOverflowPolicy() {
+        return _overflowPolicy;
+    }
+
+    void setFlushPolicy(const size_t flushSize,
+                        const std::chrono::milliseconds flushInterval,
+                        const int flushSeverity) {
+        _flushSize = flushSize;
+        _flushInterval = flushInterval;
+        _flushSeverity = flushSeverity;
+    }
+
+    size_t getFlushSize() {
+        return _flushSize;
+    }
+
+    std::chrono::milliseconds getFlushInterval() {
+        return _flushInterval;
+    }
+
+    int getFlushSeverity() {
+        return _flushSeverity;
+    }
+
+    void setRotationPolicy(const size_t rotationSize,
+                           const std::chrono::milliseconds rotationInterval,
+                           const size_t maxFiles) {
+        _rotationSize = rotationSize;
+        _rotationInterval = rotationInterval;
+        _maxFiles = maxFiles;
+    }
+
+    size_t getRotationSize() {
+        return _rotationSize;
+    }
+
+    std::chrono::milliseconds getRotationInterval() {
+        return _rotationInterval;
+    }
+
+    size_t getMaxFiles() {
+        return _maxFiles;
+    }
+
+    void setCompress(const bool isCompress) {
+        _isCompress = isCompress;
+    }
+
+    bool isCompress() {
+        return _isCompress;
+    }
+
+    void setOutputFormat(const OutputFormat outputFormat) {
+        _outputFormat = outputFormat;
+    }
+
+    OutputFormat getOutputFormat() {
+        return _outputFormat;
+    }
+
+    void addField(const std::string key,
+                  const std::string value) {
+        _fields.emplace_back(key, value);
+    }
+
+    const std::vector<std::pair<std::string, std::string>> & getFields() const {
+        return _fields;
+    }
+
+    void setCrashBuffer(const size_t crashBufferSize,
+                        const int crashSeverity) {
+        _crashBufferSize = crashBufferSize;
+        _crashSeverity = crashSeverity;
+    }
+
+    size_t getCrashBufferSize() {
+        return _crashBufferSize;
+    }
+
+    int getCrashSeverity() {
+        return _crashSeverity;
+    }
+
+    void setRateLimit(const size_t rateLimit,
+                      const size_t rateBurst) {
+        _rateLimit = rateLimit;
+        _rateBurst = rateBurst;
+    }
+
+    size_t getRateLimit() {
+        return _rateLimit;
+    }
+
+    size_t getRateBurst() {
+        return _rateBurst;
+    }
 } LogSetting;
 
 #endif // LOG_SETTING_
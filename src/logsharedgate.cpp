@@ -0,0 +1,61 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Ismael Filipe Mesquita Ribeiro - nakinx
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "logsharedgate.h"
+
+#include <thread>
+
+LogSharedGate::LogSharedGate()
+    : _isExclusive(false) {
+}
+
+void LogSharedGate::enterLocked() {
+    _qtyLeft.add(1, std::memory_order_release);
+
+    _mtx.lock_shared();
+}
+
+void LogSharedGate::lock() {
+    _mtx.lock();
+
+    // The writers entering from here take the shared_mutex.
+    _isExclusive.store(true, std::memory_order_seq_cst);
+
+    // The exits are read before the entries, so an exit is never counted
+    // without its entry.
+    for (;;) {
+        unsigned long long qtyLeft = _qtyLeft.get(std::memory_order_acquire);
+
+        if (_qtyEntered.get(std::memory_order_seq_cst) == qtyLeft)
+            break;
+
+        std::this_thread::yield();
+    }
+}
+
+void LogSharedGate::unlock() {
+    // The writers entering without the shared_mutex see the file changed.
+    _isExclusive.store(false, std::memory_order_release);
+    _mtx.unlock();
+}
@@ -0,0 +1,108 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Ismael Filipe Mesquita Ribeiro - nakinx
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LOG_SHARED_GATE_
+#define LOG_SHARED_GATE_
+
+#include "logmetrics.h"
+
+#include <atomic>
+#include <shared_mutex>
+
+/**
+ * Lock of a file written in parallel by many threads. The writers only
+ * count their entry and exit in slots of their own thread (no counter
+ * shared by them), a thread changing the file raises a flag and waits the
+ * writers already inside to leave. The writers finding the flag raised wait
+ * for the change on a shared_mutex.
+ *
+ * The exclusive side meets the Lockable requirements, so it can be taken
+ * with std::unique_lock.
+ */
+class LogSharedGate {
+
+public:
+    LogSharedGate();
+
+    /**
+     * Enter to write in parallel, without waiting unless the file is being
+     * changed. Each enter() must be followed by a leave().
+     *
+     * @return If the writer waited and holds the shared_mutex.
+     */
+    bool enter() {
+        // Either this thread sees the flag, or lock() sees its entry. Only
+        // the slot of the thread is written.
+        _qtyEntered.add(1, std::memory_order_seq_cst);
+
+        if (_isExclusive.load(std::memory_order_seq_cst)) {
+            enterLocked();
+            return true;
+        }
+
+        return false;
+    }
+
+    /**
+     * Leave after writing in parallel.
+     *
+     * @param isLocked Returned by enter().
+     */
+    void leave(const bool & isLocked) {
+        if (isLocked) {
+            _mtx.unlock_shared();
+            return;
+        }
+
+        // What was written is done before lock() sees the exit.
+        _qtyLeft.add(1, std::memory_order_release);
+    }
+
+    /**
+     * Take the gate exclusively, waiting the writers inside to leave.
+     */
+    void lock();
+
+    /**
+     * Release the gate taken exclusively.
+     */
+    void unlock();
+
+private:
+    LogSharedGate(LogSharedGate const &) = delete;
+    void operator=(LogSharedGate const &) = delete;
+
+    /**
+     * Leave the entry counted and wait on the shared_mutex while the file is
+     * being changed.
+     */
+    void enterLocked();
+
+    std::atomic<bool> _isExclusive; ///< File being changed, the writers must take the shared_mutex.
+    std::shared_mutex _mtx; ///< Exclusive while the file is changed, shared by the writers finding the flag.
+    LogThreadCounter _qtyEntered; ///< Entries of the writers.
+    LogThreadCounter _qtyLeft; ///< Exits of the writers.
+};
+
+#endif // LOG_SHARED_GATE_
@@ -0,0 +1,338 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Ismael Filipe Mesquita Ribeiro - nakinx
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "logsink.h"
+
+#include "logexception.h"
+
+#include <algorithm>
+
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <cstdio>
+#include <ctime>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/**
+ * Write every fragment into the descriptor, resuming after partial writes.
+ *
+ * @param fd Descriptor.
+ * @param iov Fragments, changed by partial writes.
+ * @param qtyIov Quantity of fragments.
+ *
+ * @return True if everything was written and false otherwise.
+ */
+static bool writeAll(const int & fd,
+                     struct iovec * iov,
+                     int qtyIov) {
+    while ((qtyIov > 0) && (iov->iov_len == 0)) {
+        iov++;
+        qtyIov--;
+    }
+
+    while (qtyIov > 0) {
+        ssize_t rc = ::writev(fd, iov, std::min(qtyIov, IOV_MAX));
+
+        if (rc < 0) {
+            if (errno == EINTR)
+                continue;
+
+            return false;
+        }
+
+        size_t written = static_cast<size_t>(rc);
+
+        while ((qtyIov > 0) && (written >= iov->iov_len)) {
+            written -= iov->iov_len;
+            iov++;
+            qtyIov--;
+        }
+
+        if (qtyIov > 0) {
+            iov->iov_base = static_cast<char *>(iov->iov_base) + written;
+            iov->iov_len -= written;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Copy the fragments of the records, the writes change them.
+ *
+ * @param iov Output with the fragments.
+ * @param records Records.
+ * @param qtyRecords Quantity of records.
+ */
+static void copyFragments(std::vector<struct iovec> & iov,
+                          const LogSinkRecord * records,
+                          const size_t & qtyRecords) {
+    iov.clear();
+
+    for (size_t i = 0; i < qtyRecords; i++)
+        iov.insert(iov.end(), records[i].iov, records[i].iov + records[i].qtyIov);
+}
+
+LogSink::LogSink(const int & severityMask)
+    : _severityMask(severityMask) {
+}
+
+LogSink::~LogSink() {
+}
+
+void LogSink::flush() {
+}
+
+void LogSink::reopen() {
+}
+
+void LogSink::setSeverityMask(const int & severityMask) {
+    _severityMask.store(severityMask);
+}
+
+int LogSink::getSeverityMask() const {
+    return _severityMask.load();
+}
+
+LogFileSink::LogFileSink(const LogSetting & logSetting,
+                         const int & severityMask)
+    : LogSink(severityMask),
+      _logSetting(logSetting),
+      _logFile(_logSetting.getPath() + _logSetting.getName(),
+               _logSetting.getFileMode(),
+               _logSetting.getFileCheckInterval(),
+               _logSetting.getMmapWindowSize()) {
+    _logFile.setRotation(_logSetting.getRotationSize(),
+                         _logSetting.getRotationInterval(),
+                         _logSetting.getMaxFiles(),
+                         _logSetting.isCompress());
+}
+
+void LogFileSink::write(const LogSinkRecord * records,
+                        const size_t & qtyRecords) {
+    std::lock_guard<std::mutex> lk(_mtx);
+
+    copyFragments(_iov, records, qtyRecords);
+
+    _logFile.write(_iov.data(), _iov.size());
+}
+
+void LogFileSink::flush() {
+    std::lock_guard<std::mutex> lk(_mtx);
+
+    _logFile.flush();
+}
+
+void LogFileSink::reopen() {
+    std::lock_guard<std::mutex> lk(_mtx);
+
+    _logFile.reopen();
+}
+
+LogStderrSink::LogStderrSink(const int & severityMask)
+    : LogSink(severityMask) {
+}
+
+void LogStderrSink::write(const LogSinkRecord * records,
+                          const size_t & qtyRecords) {
+    std::lock_guard<std::mutex> lk(_mtx);
+
+    copyFragments(_iov, records, qtyRecords);
+
+    if (!writeAll(STDERR_FILENO, _iov.data(), _iov.size()))
+        throw LoggerException(3, "Error while writing in the standard error.");
+}
+
+LogRingSink::LogRingSink(const size_t & capacity,
+                         const int & severityMask)
+    : LogSink(severityMask),
+      _records(std::max(capacity, static_cast<size_t>(1))),
+      _next(0),
+      _qtyRecords(0) {
+}
+
+void LogRingSink::write(const LogSinkRecord * records,
+                        const size_t & qtyRecords) {
+    std::lock_guard<std::mutex> lk(_mtx);
+
+    for (size_t i = 0; i < qtyRecords; i++) {
+        // The string of the slot is reused, keeping its capacity.
+        std::string & slot = _records[_next];
+
+        slot.clear();
+
+        for (int j = 0; j < records[i].qtyIov; j++)
+            slot.append(static_cast<const char *>(records[i].iov[j].iov_base), records[i].iov[j].iov_len);
+
+        _next = (_next + 1) % _records.size();
+        _qtyRecords = std::min(_qtyRecords + 1, _records.size());
+    }
+}
+
+std::vector<std::string> LogRingSink::getRecords() {
+    std::lock_guard<std::mutex> lk(_mtx);
+
+    std::vector<std::string> records;
+    size_t first = (_next + _records.size() - _qtyRecords) % _records.size();
+
+    records.reserve(_qtyRecords);
+
+    for (size_t i = 0; i < _qtyRecords; i++)
+        records.push_back(_records[(first + i) % _records.size()]);
+
+    return records;
+}
+
+LogSyslogSink::LogSyslogSink(const std::string & ident,
+                             const int & severityMask,
+                             const int & facility,
+                             const std::string & path)
+    : LogSink(severityMask),
+      _ident(ident),
+      _tag(ident + "[" + std::to_string(getpid()) + "]: "),
+      _facility(facility),
+      _path(path),
+      _fd(-1) {
+}
+
+LogSyslogSink::~LogSyslogSink() {
+    close();
+}
+
+bool LogSyslogSink::connect() {
+    struct sockaddr_un addr;
+
+    if (_path.length() >= sizeof(addr.sun_path))
+        return false;
+
+    _fd = ::socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+
+    if (_fd < 0)
+        return false;
+
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, _path.c_str(), _path.length());
+
+    if (::connect(_fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) < 0) {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void LogSyslogSink::close() {
+    if (_fd >= 0) {
+        ::close(_fd);
+        _fd = -1;
+    }
+}
+
+void LogSyslogSink::reopen() {
+    std::lock_guard<std::mutex> lk(_mtx);
+
+    // The process may have been forked since the tag was built.
+    _tag = _ident + "[" + std::to_string(getpid()) + "]: ";
+
+    close();
+}
+
+void LogSyslogSink::write(const LogSinkRecord * records,
+                          const size_t & qtyRecords) {
+    std::lock_guard<std::mutex> lk(_mtx);
+
+    // Only one attempt to connect by call, the records are discarded while
+    // the daemon isn't available.
+    bool isRetried = false;
+
+    if (_fd < 0) {
+        if (!connect())
+            return;
+
+        isRetried = true;
+    }
+
+    char prefix[64];
+    time_t now = time(nullptr);
+    struct tm tm;
+
+    localtime_r(&now, &tm);
+
+    for (size_t i = 0; i < qtyRecords; i++) {
+        int level;
+
+        switch (records[i].sl) {
+            case SeverityLevel::Fatal : level = 2; break; // LOG_CRIT
+            case SeverityLevel::Error : level = 3; break; // LOG_ERR
+            case SeverityLevel::Warning : level = 4; break; // LOG_WARNING
+            case SeverityLevel::Info : level = 6; break; // LOG_INFO
+            case SeverityLevel::Debug : level = 7; break; // LOG_DEBUG
+            default : level = 5; break; // LOG_NOTICE
+        }
+
+        // Same header of syslog(3): <priority>timestamp ident[pid]: message
+        int len = snprintf(prefix, sizeof(prefix), "<%d>", _facility | level);
+        len += strftime(prefix + len, sizeof(prefix) - len, "%b %e %H:%M:%S ", &tm);
+
+        _iov.clear();
+        _iov.push_back({ prefix, static_cast<size_t>(len) });
+        _iov.push_back({ &_tag[0], _tag.length() });
+        _iov.insert(_iov.end(), records[i].iov, records[i].iov + records[i].qtyIov);
+
+        // The line break isn't part of the message.
+        for (auto it = _iov.rbegin(); it != _iov.rend(); it++) {
+            if (it->iov_len == 0)
+                continue;
+
+            if (static_cast<const char *>(it->iov_base)[it->iov_len - 1] == '\n')
+                it->iov_len--;
+
+            break;
+        }
+
+        struct msghdr msg;
+
+        std::memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = _iov.data();
+        msg.msg_iovlen = _iov.size();
+
+        while (::sendmsg(_fd, &msg, MSG_NOSIGNAL) < 0) {
+            if (errno == EINTR)
+                continue;
+
+            // Daemon restarted, the socket must be connected again.
+            close();
+
+            if (isRetried || !connect())
+                return;
+
+            isRetried = true;
+        }
+    }
+}
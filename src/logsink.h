@@ -0,0 +1,264 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Ismael Filipe Mesquita Ribeiro - nakinx
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LOG_SINK_
+#define LOG_SINK_
+
+#include "logsetting.h"
+#include "logfile.h"
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+
+#include <sys/uio.h>
+
+/**
+ * Log record already formatted, shared by all the sinks of the logger.
+ */
+struct LogSinkRecord {
+    SeverityLevel sl; ///< Severity of the record.
+    const struct iovec * iov; ///< Fragments of the record, the line break included.
+    int qtyIov; ///< Quantity of fragments.
+};
+
+/**
+ * Destination of the records of a logger besides its log file. The record
+ * is formatted once by the logger and given to every sink whose severity
+ * mask accepts it, with the log lock of the logger.
+ *
+ * The same sink may be attached to several loggers, which call it with
+ * different locks, so the sinks provided have their own lock. A sink
+ * implemented by the application needs one as well if it's shared.
+ *
+ * In binary format the sinks receive the records without the format and
+ * the sites, written only in the log file.
+ */
+class LogSink {
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param severityMask Severitys written to the sink.
+     */
+    explicit LogSink(const int & severityMask);
+
+    /**
+     * Destructor.
+     */
+    virtual ~LogSink();
+
+    /**
+     * Write the records into the sink.
+     *
+     * @param records Records accepted by the severity mask.
+     * @param qtyRecords Quantity of records.
+     *
+     * @throws LoggerException
+     *         Error while writing in the sink.
+     */
+    virtual void write(const LogSinkRecord * records,
+                       const size_t & qtyRecords) = 0;
+
+    /**
+     * Commit the records already written, when it applies.
+     */
+    virtual void flush();
+
+    /**
+     * Open the destination again, when it applies.
+     *
+     * @throws LoggerException
+     *         Error while opening the sink.
+     */
+    virtual void reopen();
+
+    /**
+     * Set the severitys written to the sink, can be changed at any time.
+     *
+     * @param severityMask Severitys written to the sink.
+     */
+    void setSeverityMask(const int & severityMask);
+
+    /**
+     * Get the severitys written to the sink.
+     *
+     * @return Severitys written to the sink.
+     */
+    int getSeverityMask() const;
+
+    static constexpr int AllSeverity = static_cast<int>(SeverityLevel::Debug) |
+                                   static_cast<int>(SeverityLevel::Fatal) |
+                                   static_cast<int>(SeverityLevel::Error) |
+                                   static_cast<int>(SeverityLevel::Warning) |
+                                   static_cast<int>(SeverityLevel::Info); ///< All severitys.
+
+private:
+    LogSink(LogSink const &) = delete;
+    void operator=(LogSink const &) = delete;
+
+    std::atomic<int> _severityMask; ///< Severitys written to the sink.
+};
+
+/**
+ * Sink writing in another file, with the file mode and the rotation of its
+ * settings.
+ */
+class LogFileSink : public LogSink {
+
+public:
+    /**
+     * Constructor, the file is only opened on the first write.
+     *
+     * @param logSetting Settings of the file, the path and the name define
+     *                   the file and the write mode and format are ignored.
+     * @param severityMask Severitys written to the sink.
+     */
+    explicit LogFileSink(const LogSetting & logSetting,
+                         const int & severityMask = AllSeverity);
+
+    void write(const LogSinkRecord * records,
+               const size_t & qtyRecords) override;
+
+    void flush() override;
+
+    void reopen() override;
+
+private:
+    std::mutex _mtx; ///< Protection against the loggers sharing the sink.
+    LogSetting _logSetting; ///< Settings of the file.
+    LogFile _logFile; ///< File where the records are written.
+    std::vector<struct iovec> _iov; ///< Fragments of the records, changed by partial writes.
+};
+
+/**
+ * Sink writing in the standard error.
+ */
+class LogStderrSink : public LogSink {
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param severityMask Severitys written to the sink.
+     */
+    explicit LogStderrSink(const int & severityMask = AllSeverity);
+
+    void write(const LogSinkRecord * records,
+               const size_t & qtyRecords) override;
+
+private:
+    std::mutex _mtx; ///< Protection against the loggers sharing the sink.
+    std::vector<struct iovec> _iov; ///< Fragments of the records, changed by partial writes.
+};
+
+/**
+ * Sink keeping the last records in memory, e.g. to be shown or dumped when
+ * something goes wrong.
+ */
+class LogRingSink : public LogSink {
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param capacity Quantity of records kept.
+     * @param severityMask Severitys written to the sink.
+     */
+    explicit LogRingSink(const size_t & capacity,
+                         const int & severityMask = AllSeverity);
+
+    void write(const LogSinkRecord * records,
+               const size_t & qtyRecords) override;
+
+    /**
+     * Return the records kept, from the oldest to the newest.
+     *
+     * @return Records with their line breaks.
+     */
+    std::vector<std::string> getRecords();
+
+private:
+    std::mutex _mtx; ///< Protection against the loggers sharing the sink and the threads reading the records.
+    std::vector<std::string> _records; ///< Ring of records, the strings are reused.
+    size_t _next; ///< Position of the next record.
+    size_t _qtyRecords; ///< Quantity of records kept.
+};
+
+/**
+ * Sink sending the records to the syslog daemon through its UNIX socket,
+ * one datagram per record in the format of syslog(3). The records are
+ * discarded while the daemon isn't available.
+ */
+class LogSyslogSink : public LogSink {
+
+public:
+    /**
+     * Constructor, the socket is only connected on the first write.
+     *
+     * @param ident Identification of the application in the messages.
+     * @param severityMask Severitys written to the sink.
+     * @param facility Syslog facility (e.g. LOG_USER, LOG_LOCAL0).
+     * @param path Path of the socket of the daemon.
+     */
+    LogSyslogSink(const std::string & ident,
+                  const int & severityMask = AllSeverity,
+                  const int & facility = (1 << 3),
+                  const std::string & path = "/dev/log");
+
+    /**
+     * Destructor, closes the socket.
+     */
+    ~LogSyslogSink();
+
+    void write(const LogSinkRecord * records,
+               const size_t & qtyRecords) override;
+
+    void reopen() override;
+
+private:
+    /**
+     * Connect to the daemon socket.
+     *
+     * @return True if connected and false otherwise.
+     */
+    bool connect();
+
+    /**
+     * Close the socket.
+     */
+    void close();
+
+    std::mutex _mtx; ///< Protection against the loggers sharing the sink.
+    std::string _ident; ///< Identification of the application.
+    std::string _tag; ///< Identification and pid put before each message.
+    int _facility; ///< Syslog facility.
+    std::string _path; ///< Path of the daemon socket.
+    int _fd; ///< Socket, -1 when closed.
+    std::vector<struct iovec> _iov; ///< Prefix and fragments of a record.
+};
+
+#endif // LOG_SINK_
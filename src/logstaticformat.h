@@ -0,0 +1,319 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Ismael Filipe Mesquita Ribeiro - nakinx
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LOG_STATIC_FORMAT_
+#define LOG_STATIC_FORMAT_
+
+#include "logstream.h"
+
+#include <string>
+#include <string_view>
+#include <chrono>
+#include <ctime>
+#include <cstddef>
+#include <utility>
+
+/**
+ * Declare a type holding an info format known at compile time, to be given
+ * to Logger::setInfoFormat<Format>() or LogSetting::setInfo<Format>():
+ *
+ *     LOG_STATIC_FORMAT(HeaderFormat, "%D{%Y-%m-%d %H:%M:%S.%q} [%S] %F:%L ");
+ *
+ * The format must be a string literal.
+ */
+#define LOG_STATIC_FORMAT(type, format) \
+    struct type { \
+        static constexpr std::string_view value = format; \
+    }
+
+/**
+ * Function rendering the header of a record, see LogStaticFormat::render().
+ */
+typedef void (*LogInfoRenderer)(std::string & out,
+                                const std::chrono::system_clock::time_point & time,
+                                std::string_view file,
+                                std::string_view function,
+                                const int & line,
+                                std::string_view severity);
+
+/**
+ * Info format parsed at compile time, with the same specifiers and output
+ * of LogFormat. Each token is a constant of the type, so rendering the
+ * header is a fixed sequence of appends, without a loop over the tokens.
+ *
+ * The date/time tokens are rendered once per second and kept in a cache per
+ * thread, as LogFormat does.
+ *
+ * @tparam Format Type declared by LOG_STATIC_FORMAT().
+ */
+template<typename Format>
+class LogStaticFormat {
+
+public:
+    /**
+     * Append the header of the record into the output, the same appended by
+     * LogFormat::render() with the format compiled at runtime.
+     *
+     * @param out Output where the header will be appended.
+     * @param time When the record was created.
+     * @param file File where logger was invoked.
+     * @param function Function where logger was invoked.
+     * @param line Line where logger was invoked.
+     * @param severity Name of the severity of the record.
+     */
+    static void render(std::string & out,
+                       const std::chrono::system_clock::time_point & time,
+                       std::string_view file,
+                       std::string_view function,
+                       const int & line,
+                       std::string_view severity) {
+        const DateCache * dates = (Compiled.qtyDates > 0 ? &getDates(time) : nullptr);
+
+        renderTokens(out, dates, time, file, function, line, severity,
+                     std::make_index_sequence<Compiled.qtyTokens>());
+    }
+
+private:
+    /**
+     * Types of token in the compiled format, the same of LogFormat.
+     */
+    enum class TokenType {
+        Literal, ///< Text copied as it's.
+        Date, ///< strftime() format of a date/time.
+        Milliseconds, ///< Milliseconds of the record time.
+        File, ///< File where logger was invoked.
+        Function, ///< Function where logger was invoked.
+        Line, ///< Line where logger was invoked.
+        Severity ///< Severity of the record.
+    };
+
+    /**
+     * Token of the compiled format.
+     */
+    struct Token {
+        TokenType type; ///< Type of the token.
+        size_t begin; ///< Begin of the text of literals and dates.
+        size_t length; ///< Length of the text, without the '\0' ending dates.
+        size_t date; ///< Index of the date/time token.
+    };
+
+    static constexpr size_t Length = Format::value.length(); ///< Length of the format.
+
+    /**
+     * Format compiled, each source character produces at most one token and
+     * two characters of text, the dates are ended by '\0' for strftime().
+     */
+    struct Tokens {
+        Token tokens[Length + 1] = {}; ///< Tokens compiled.
+        size_t qtyTokens = 0; ///< Quantity of tokens compiled.
+        char text[(2 * Length) + 1] = {}; ///< Text of the literals and dates, one after the other.
+        size_t qtyText = 0; ///< Length of the text.
+        size_t qtyDates = 0; ///< Quantity of date/time tokens.
+
+        /**
+         * Add a text to the last token if it has the same type or create a
+         * new token otherwise, as LogFormat::append().
+         *
+         * @param type Type of the token.
+         * @param data Text to be added.
+         * @param len Length of the text.
+         */
+        constexpr void append(const TokenType type,
+                              const char * data,
+                              const size_t len) {
+            bool isText = ((type == TokenType::Literal) || (type == TokenType::Date));
+
+            if (!isText || (qtyTokens == 0) || (tokens[qtyTokens - 1].type != type)) {
+                tokens[qtyTokens] = Token { type, qtyText, 0, qtyDates };
+
+                if (type == TokenType::Date)
+                    qtyDates++;
+
+                qtyTokens++;
+            } else if (type == TokenType::Date) {
+                qtyText--; // Text appended over the '\0'.
+            }
+
+            for (size_t i = 0; i < len; i++)
+                text[qtyText++] = data[i];
+
+            tokens[qtyTokens - 1].length += len;
+
+            if (type == TokenType::Date)
+                text[qtyText++] = '\0';
+        }
+    };
+
+    /**
+     * Compile the format, following LogFormat::compile().
+     *
+     * @return Format compiled.
+     */
+    static constexpr Tokens compile() {
+        constexpr std::string_view format = Format::value;
+        Tokens compiled;
+        bool isDate = false;
+
+        for (size_t i = 0; i < format.length(); i++) {
+            if (isDate) {
+                if (format[i] == '}') {
+                    isDate = false;
+                } else if ((format[i] == '%') && ((i + 1) < format.length())) {
+                    i++;
+
+                    if (format[i] == 'q')
+                        compiled.append(TokenType::Milliseconds, "", 0);
+                    else
+                        compiled.append(TokenType::Date, format.data() + i - 1, 2);
+                } else if (format[i] == '%') {
+                    compiled.append(TokenType::Literal, "%", 1);
+                } else {
+                    compiled.append(TokenType::Date, format.data() + i, 1);
+                }
+
+                continue;
+            }
+
+            if ((format[i] != '%') || ((i + 1) >= format.length())) {
+                compiled.append(TokenType::Literal, format.data() + i, 1);
+                continue;
+            }
+
+            i++;
+
+            switch (format[i]) {
+                case 'D' :
+                    if (((i + 1) < format.length()) && (format[i + 1] == '{')) {
+                        isDate = true;
+                        i++;
+                    } else {
+                        compiled.append(TokenType::Literal, "%D", 2);
+                    }
+                    break;
+                case 'F' : compiled.append(TokenType::File, "", 0); break;
+                case 'M' : compiled.append(TokenType::Function, "", 0); break;
+                case 'L' : compiled.append(TokenType::Line, "", 0); break;
+                case 'S' : compiled.append(TokenType::Severity, "", 0); break;
+                case '%' : compiled.append(TokenType::Literal, "%", 1); break;
+                default : compiled.append(TokenType::Literal, format.data() + i - 1, 2); break;
+            }
+        }
+
+        return compiled;
+    }
+
+    static constexpr Tokens Compiled = compile(); ///< Format compiled.
+
+    /**
+     * Date/time tokens rendered in a given second.
+     */
+    struct DateCache {
+        bool isRendered = false; ///< Some second was rendered.
+        std::time_t second = 0; ///< Second rendered.
+        char text[Compiled.qtyDates + 1][128]; ///< Each date/time token rendered.
+        size_t lengths[Compiled.qtyDates + 1]; ///< Length of each date/time token rendered.
+    };
+
+    /**
+     * Get the date/time tokens rendered for the second of the given time,
+     * rendering them only if the second isn't in the cache of the thread.
+     *
+     * @param time When the record was created.
+     *
+     * @return Cache with the date/time tokens rendered.
+     */
+    static const DateCache & getDates(const std::chrono::system_clock::time_point & time) {
+        static thread_local DateCache cache;
+        std::time_t tt = std::chrono::system_clock::to_time_t(time);
+
+        if (cache.isRendered && (cache.second == tt))
+            return cache;
+
+        std::tm tm;
+
+        localtime_r(&tt, &tm);
+
+        for (size_t i = 0, date = 0; i < Compiled.qtyTokens; i++) {
+            if (Compiled.tokens[i].type == TokenType::Date) {
+                cache.lengths[date] = std::strftime(cache.text[date], sizeof(cache.text[date]),
+                                                    Compiled.text + Compiled.tokens[i].begin, &tm);
+                date++;
+            }
+        }
+
+        cache.isRendered = true;
+        cache.second = tt;
+
+        return cache;
+    }
+
+    template<size_t... Index>
+    static void renderTokens(std::string & out,
+                             const DateCache * dates,
+                             const std::chrono::system_clock::time_point & time,
+                             std::string_view file,
+                             std::string_view function,
+                             const int & line,
+                             std::string_view severity,
+                             std::index_sequence<Index...>) {
+        (renderToken<Index>(out, dates, time, file, function, line, severity), ...);
+    }
+
+    /**
+     * Append a token of the compiled format, chosen at compile time.
+     */
+    template<size_t Index>
+    static void renderToken(std::string & out,
+                            const DateCache * dates,
+                            const std::chrono::system_clock::time_point & time,
+                            std::string_view file,
+                            std::string_view function,
+                            const int & line,
+                            std::string_view severity) {
+        constexpr Token token = Compiled.tokens[Index];
+
+        if constexpr (token.type == TokenType::Literal) {
+            out.append(Compiled.text + token.begin, token.length);
+        } else if constexpr (token.type == TokenType::Date) {
+            out.append(dates->text[token.date], dates->lengths[token.date]);
+        } else if constexpr (token.type == TokenType::Milliseconds) {
+            char ms[24];
+            int value = std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count() % 1000;
+
+            out.append(ms, LogStream::formatDecimal(ms, value) - ms);
+        } else if constexpr (token.type == TokenType::File) {
+            out += file;
+        } else if constexpr (token.type == TokenType::Function) {
+            out += function;
+        } else if constexpr (token.type == TokenType::Line) {
+            char number[24];
+
+            out.append(number, LogStream::formatDecimal(number, line) - number);
+        } else {
+            out += severity;
+        }
+    }
+};
+
+#endif // LOG_STATIC_FORMAT_
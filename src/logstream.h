@@ -0,0 +1,260 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Ismael Filipe Mesquita Ribeiro - nakinx
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LOG_STREAM_
+#define LOG_STREAM_
+
+#include <string>
+#include <string_view>
+#include <sstream>
+#include <memory>
+#include <type_traits>
+#include <charconv>
+#include <cstring>
+#include <cstdint>
+
+/**
+ * Buffer where the LOG_<SEVERITY> macros build the message, replacing
+ * std::stringstream. The text is kept in a fixed buffer on the stack, only
+ * a message longer than it is moved to the heap.
+ *
+ * Strings, characters, integers, floating point and booleans are appended
+ * directly, as std::ostream prints them by default but without locale and
+ * virtual calls. The other types and the manipulators (e.g. std::hex) are
+ * given to a std::ostringstream created for the message, which then
+ * receives everything after them so the manipulators keep working.
+ */
+class LogStream {
+
+public:
+    static const size_t Capacity = 512; ///< Size of the buffer on the stack.
+
+    LogStream()
+        : _size(0),
+          _isHeap(false) {
+    }
+
+    LogStream & operator<<(const char * value) {
+        if (value != nullptr)
+            append(value, strlen(value));
+
+        return *this;
+    }
+
+    LogStream & operator<<(std::string_view value) {
+        append(value.data(), value.length());
+        return *this;
+    }
+
+    LogStream & operator<<(const std::string & value) {
+        append(value.data(), value.length());
+        return *this;
+    }
+
+    LogStream & operator<<(const char value) {
+        append(&value, 1);
+        return *this;
+    }
+
+    LogStream & operator<<(const signed char value) {
+        return (*this << static_cast<char>(value));
+    }
+
+    LogStream & operator<<(const unsigned char value) {
+        return (*this << static_cast<char>(value));
+    }
+
+    /**
+     * Booleans, as 1 or 0 like std::ostream without std::boolalpha.
+     */
+    LogStream & operator<<(const bool value) {
+        if (_stream)
+            *_stream << value;
+        else
+            append(value ? "1" : "0", 1);
+
+        return *this;
+    }
+
+    template<typename T,
+             typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+    LogStream & operator<<(const T value) {
+        if (_stream) {
+            *_stream << value;
+        } else {
+            char buffer[24];
+            append(buffer, formatDecimal(buffer, value) - buffer);
+        }
+
+        return *this;
+    }
+
+    /**
+     * Floating point, with 6 significant digits like std::ostream.
+     */
+    template<typename T,
+             typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+    LogStream & operator<<(const T value) {
+        if (_stream) {
+            *_stream << value;
+        } else {
+            char buffer[64];
+            append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::general, 6).ptr - buffer);
+        }
+
+        return *this;
+    }
+
+    LogStream & operator<<(std::ostream & (*manipulator)(std::ostream &)) {
+        getStream() << manipulator;
+        return *this;
+    }
+
+    LogStream & operator<<(std::ios_base & (*manipulator)(std::ios_base &)) {
+        getStream() << manipulator;
+        return *this;
+    }
+
+    /**
+     * Other types, printed by their operator<<.
+     */
+    template<typename T,
+             typename std::enable_if<!std::is_arithmetic<T>::value &&
+                                     !std::is_convertible<const T &, std::string_view>::value, int>::type = 0>
+    LogStream & operator<<(const T & value) {
+        getStream() << value;
+        return *this;
+    }
+
+    /**
+     * Return the message built, nothing may be appended afterwards.
+     *
+     * @return Text of the message.
+     */
+    std::string_view view() {
+        if (_stream) {
+            std::string text = _stream->str();
+
+            _stream.reset();
+            append(text.data(), text.length());
+        }
+
+        return (_isHeap ? std::string_view(_heap) : std::string_view(_data, _size));
+    }
+
+    /**
+     * Write the decimal digits of an integer, two at a time.
+     *
+     * @param out Output with room for 20 digits and the sign.
+     * @param value Integer.
+     *
+     * @return End of the digits written.
+     */
+    template<typename T>
+    static char * formatDecimal(char * out,
+                                const T & value) {
+        typedef typename std::make_unsigned<T>::type Unsigned;
+
+        Unsigned magnitude = static_cast<Unsigned>(value);
+
+        if (value < 0) {
+            *out++ = '-';
+            magnitude = static_cast<Unsigned>(0 - magnitude);
+        }
+
+        char digits[20];
+        char * begin = digits + sizeof(digits);
+
+        while (magnitude >= 100) {
+            begin -= 2;
+            memcpy(begin, DigitPairs + ((magnitude % 100) * 2), 2);
+            magnitude /= 100;
+        }
+
+        if (magnitude >= 10) {
+            begin -= 2;
+            memcpy(begin, DigitPairs + (magnitude * 2), 2);
+        } else {
+            *--begin = static_cast<char>('0' + magnitude);
+        }
+
+        size_t len = digits + sizeof(digits) - begin;
+
+        memcpy(out, begin, len);
+
+        return (out + len);
+    }
+
+private:
+    LogStream(LogStream const &) = delete;
+    void operator=(LogStream const &) = delete;
+
+    static constexpr const char * DigitPairs =
+        "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+        "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899"; ///< Digits of 0 to 99.
+
+    /**
+     * Append the text, given to the stream once it's used.
+     *
+     * @param data Text to be appended.
+     * @param len Length of the text.
+     */
+    void append(const char * data,
+                const size_t & len) {
+        if (_stream) {
+            _stream->write(data, len);
+        } else if (!_isHeap && ((_size + len) <= Capacity)) {
+            memcpy(_data + _size, data, len);
+            _size += len;
+        } else {
+            if (!_isHeap) {
+                _heap.assign(_data, _size);
+                _isHeap = true;
+            }
+
+            _heap.append(data, len);
+        }
+    }
+
+    /**
+     * Return the stream of the message, created on the first call.
+     *
+     * @return Stream receiving the rest of the message.
+     */
+    std::ostream & getStream() {
+        if (!_stream)
+            _stream.reset(new std::ostringstream());
+
+        return *_stream;
+    }
+
+    char _data[Capacity]; ///< Message while it fits on the stack.
+    size_t _size; ///< Length of the message on the stack.
+    bool _isHeap; ///< Message moved to the heap.
+    std::string _heap; ///< Message longer than the buffer on the stack.
+    std::unique_ptr<std::ostringstream> _stream; ///< Stream of the types without a direct conversion, null until used.
+};
+
+#endif // LOG_STREAM_
@@ -0,0 +1,546 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Ismael Filipe Mesquita Ribeiro - nakinx
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "src/logger.h"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <chrono>
+#include <ctime>
+#include <cstdio>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+
+#define BENCH_RECORDS 1000000
+
+const static std::string benchFormat = "[%D{%Y-%m-%d %H:%M:%S:%q}][%F:%L][%M][%S] - ";
+const static std::string benchFile = __FILE__;
+const static std::string benchFunction = "int main(int, char**)";
+
+std::string legacyBuildInfo(const std::string & format,
+                            const std::string & file,
+                            const std::string & function,
+                            const int & line,
+                            const std::string & severity,
+                            const std::chrono::system_clock::time_point & time);
+void benchHeader();
+double benchWrite(const OutputFormat & outputFormat);
+void benchOutputFormat();
+void benchDeferred();
+
+/**
+ * Case of the benchmark matrix.
+ */
+struct BenchCase {
+    WriteMode writeMode; ///< How the records are written.
+    const char * formatName; ///< Name of the info format in the report.
+    std::string info; ///< Info format.
+    size_t msgSize; ///< Length of the message.
+    bool isEnabled; ///< Severity of the records is active.
+    unsigned int qtyThreads; ///< Threads logging at the same time.
+};
+
+/**
+ * Measures of a case of the benchmark matrix.
+ */
+struct BenchResult {
+    double recordsPerSecond; ///< Records per second, including the time to write those pending.
+    long long p50; ///< Median latency of a call (ns).
+    long long p99; ///< 99th percentile latency of a call (ns).
+    long long p999; ///< 99.9th percentile latency of a call (ns).
+    long long max; ///< Maximum latency of a call (ns).
+    unsigned long long lockWaitTime; ///< Time (ns) the threads waited for the log lock.
+};
+
+void benchThread(const std::string & name,
+                 const std::string & msg,
+                 const size_t & qtyRecords,
+                 const std::atomic<bool> * isStarted,
+                 std::vector<long long> * latencies);
+BenchResult benchCase(const BenchCase & benchCase,
+                      const size_t & qtyRecords);
+void benchMatrix(const std::string & output,
+                 unsigned int maxThreads,
+                 const size_t & qtyRecords);
+bool parseCount(const char * arg,
+                const unsigned long long & max,
+                unsigned long long & value);
+
+int main(int argc,
+         char * argv[]) {
+    std::string output = "csv";
+    unsigned int maxThreads = std::thread::hardware_concurrency();
+    size_t qtyRecords = BENCH_RECORDS / 50;
+    bool isMatrixOnly = false;
+    unsigned long long value;
+
+    // --csv or --json only run the matrix, printing nothing else.
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if ((arg == "--csv") || (arg == "--json")) {
+            output = arg.substr(2);
+            isMatrixOnly = true;
+        } else if ((arg == "--threads") && ((i + 1) < argc) && parseCount(argv[i + 1], 4096, value)) {
+            maxThreads = static_cast<unsigned int>(value);
+            i++;
+        } else if ((arg == "--records") && ((i + 1) < argc) && parseCount(argv[i + 1], 10000000, value)) {
+            qtyRecords = static_cast<size_t>(value);
+            i++;
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--csv|--json] [--threads <1-4096>] [--records <1-10000000 per thread>]\n";
+            return (1);
+        }
+    }
+
+    if (!isMatrixOnly) {
+        benchHeader();
+        benchOutputFormat();
+        benchDeferred();
+
+        std::cout << "===> Latency and throughput matrix (" << qtyRecords << " records per thread)\n";
+    }
+
+    benchMatrix(output, std::max(maxThreads, 1u), qtyRecords);
+
+    return (0);
+}
+
+/**
+ * Header building as it was done before the info format was compiled, the
+ * format is parsed for each record (without the debug print of %F).
+ */
+std::string legacyBuildInfo(const std::string & format,
+                            const std::string & file,
+                            const std::string & function,
+                            const int & line,
+                            const std::string & severity,
+                            const std::chrono::system_clock::time_point & time) {
+    bool found_date = false;
+    bool found_date_key = false;
+    bool found_specifier = false;
+    char sv[64];
+    std::stringstream ssr;
+    std::tm tm;
+
+    std::time_t cur_time_tt = std::chrono::system_clock::to_time_t(time);
+    localtime_r(&cur_time_tt, &tm);
+
+    for (unsigned int i = 0; i < format.length(); i++) {
+        if (format[i] == '{') {
+            found_date_key = true;
+            continue;
+        } else if (format[i] == '}') {
+            found_date = false;
+            found_date_key = false;
+            continue;
+        } else if (format[i] == '%') {
+            found_specifier = true;
+            continue;
+        } else if (format[i] == 'D') {
+            found_date = true;
+            found_specifier = false;
+            continue;
+        } else if ((found_date == true) &&
+                   (found_date_key == true) &&
+                   (found_specifier == true) &&
+                   (format[i] == 'q')) {
+            ssr << std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count() % 1000;
+            found_specifier = false;
+            continue;
+        } else if ((found_date == true) &&
+                   (found_date_key == true) &&
+                   (found_specifier == true)) {
+            memset(sv, 0, sizeof(sv));
+            std::string tmp("%");
+            tmp += format[i];
+            std::strftime(sv, (sizeof(sv) - sizeof(char)), tmp.c_str(), &tm);
+            ssr << sv;
+            found_specifier = false;
+            continue;
+        } else if (format[i] == 'F') {
+            ssr << file;
+            found_specifier = false;
+            continue;
+        } else if (format[i] == 'M') {
+            ssr << function;
+            found_specifier = false;
+            continue;
+        } else if (format[i] == 'L') {
+            ssr << line;
+            found_specifier = false;
+            continue;
+        } else if (format[i] == 'S') {
+            ssr << severity;
+            found_specifier = false;
+            continue;
+        }
+        ssr << format[i];
+    }
+
+    return ssr.str();
+}
+
+void benchHeader() {
+    std::cout << "===> Header building benchmark (" << BENCH_RECORDS << " records, format: " << benchFormat << ")\n";
+
+    size_t totalLength = 0;
+
+    auto begin = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < BENCH_RECORDS; i++)
+        totalLength += legacyBuildInfo(benchFormat, benchFile, benchFunction, __LINE__, "debug", std::chrono::system_clock::now()).length();
+
+    std::chrono::duration<double> legacyElapsed = std::chrono::steady_clock::now() - begin;
+
+    LogFormat logFormat(benchFormat);
+    std::string header;
+
+    begin = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < BENCH_RECORDS; i++) {
+        header.clear();
+        logFormat.render(header, std::chrono::system_clock::now(), benchFile, benchFunction, __LINE__, "debug");
+        totalLength += header.length();
+    }
+
+    std::chrono::duration<double> compiledElapsed = std::chrono::steady_clock::now() - begin;
+
+    std::cout << "Parsed per record: " << static_cast<long>(BENCH_RECORDS / legacyElapsed.count()) << " headers/s\n";
+    std::cout << "Compiled format: " << static_cast<long>(BENCH_RECORDS / compiledElapsed.count()) << " headers/s\n";
+    std::cout << "Speedup: " << (legacyElapsed.count() / compiledElapsed.count()) << "x (" << totalLength << " bytes)\n";
+}
+
+/**
+ * Write the records with a synchronous logger in the given format.
+ *
+ * @param outputFormat Format of the records.
+ *
+ * @return Seconds elapsed.
+ */
+double benchWrite(const OutputFormat & outputFormat) {
+    std::string name = "logger_bench_" + std::to_string(static_cast<int>(outputFormat));
+    std::string msg = "Benchmark record with a message of typical length";
+
+    std::remove(("/tmp/" + name).c_str());
+
+    LogSetting ls(name, "/tmp/");
+    ls.setInfo(benchFormat);
+    ls.setOutputFormat(outputFormat);
+
+    LogBuilder::getInstance().buildLogger(ls);
+
+    Logger * logger = LogBuilder::getInstance().getLogger(name).get();
+
+    auto begin = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < BENCH_RECORDS; i++)
+        logger->write(SeverityLevel::Debug, benchFile, benchFunction, __LINE__, msg);
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+    LogBuilder::getInstance().destroyLogger(name);
+    std::remove(("/tmp/" + name).c_str());
+
+    return elapsed.count();
+}
+
+void benchOutputFormat() {
+    std::cout << "===> Output format benchmark (" << BENCH_RECORDS << " records, synchronous)\n";
+
+    double textElapsed = benchWrite(OutputFormat::Text);
+    double binaryElapsed = benchWrite(OutputFormat::Binary);
+    double jsonElapsed = benchWrite(OutputFormat::Json);
+
+    std::cout << "Text: " << static_cast<long>(BENCH_RECORDS / textElapsed) << " records/s\n";
+    std::cout << "Binary: " << static_cast<long>(BENCH_RECORDS / binaryElapsed) << " records/s (" << (textElapsed / binaryElapsed) << "x)\n";
+    std::cout << "JSON: " << static_cast<long>(BENCH_RECORDS / jsonElapsed) << " records/s (" << (textElapsed / jsonElapsed) << "x)\n";
+
+    // Only building the records, without writing them.
+    std::string msg = "Benchmark record with a \"quoted\" message of typical length";
+    std::string fields;
+    std::string record;
+    LogFormat logFormat(benchFormat);
+
+    LogJson::appendField(fields, "service", "logger_bench");
+
+    auto begin = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < BENCH_RECORDS; i++) {
+        record.clear();
+        logFormat.render(record, std::chrono::system_clock::now(), benchFile, benchFunction, __LINE__, "debug");
+        record += msg;
+    }
+
+    std::chrono::duration<double> textBuild = std::chrono::steady_clock::now() - begin;
+
+    begin = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < BENCH_RECORDS; i++) {
+        record.clear();
+        LogJson::appendRecord(record, std::chrono::system_clock::now(), "debug", 1234, benchFile, benchFunction, __LINE__, msg, fields);
+    }
+
+    std::chrono::duration<double> jsonBuild = std::chrono::steady_clock::now() - begin;
+
+    std::cout << "Text built: " << static_cast<long>(BENCH_RECORDS / textBuild.count()) << " records/s\n";
+    std::cout << "JSON built: " << static_cast<long>(BENCH_RECORDS / jsonBuild.count()) << " records/s (" << (textBuild.count() / jsonBuild.count()) << "x)\n";
+}
+
+/**
+ * Time spent by the thread logging in asynchronous mode, with the message
+ * built by the caller or deferred to the writer thread. The queue holds all
+ * records, so the caller never waits for the writer.
+ */
+void benchDeferred() {
+    const int qtyRecords = BENCH_RECORDS / 10;
+    std::string name = "logger_bench_deferred";
+    std::string user = "user@example.com";
+
+    std::cout << "===> Deferred formatting benchmark (" << qtyRecords << " records, asynchronous, caller side)\n";
+
+    LogSetting ls(name, "/tmp/");
+    ls.setInfo(benchFormat);
+    ls.setWriteMode(WriteMode::Async);
+    ls.setQueueCapacity(qtyRecords * 2);
+
+    LogBuilder::getInstance().buildLogger(ls);
+
+    auto begin = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < qtyRecords; i++)
+        LOG_INFO(name, "Request " << i << " from " << user << " took " << 0.25 << " ms");
+
+    std::chrono::duration<double> streamElapsed = std::chrono::steady_clock::now() - begin;
+
+    LogBuilder::getInstance().getLogger(name)->flush();
+
+    begin = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < qtyRecords; i++)
+        LOG_INFOF(name, "Request {} from {} took {} ms", i, user, 0.25);
+
+    std::chrono::duration<double> deferredElapsed = std::chrono::steady_clock::now() - begin;
+
+    LogBuilder::getInstance().destroyLogger(name);
+    std::remove(("/tmp/" + name).c_str());
+
+    std::cout << "Stream: " << static_cast<long>((streamElapsed.count() * 1e9) / qtyRecords) << " ns/record\n";
+    std::cout << "Deferred: " << static_cast<long>((deferredElapsed.count() * 1e9) / qtyRecords) << " ns/record\n";
+    std::cout << "Speedup: " << (streamElapsed.count() / deferredElapsed.count()) << "x\n";
+}
+
+/**
+ * Log the records from a thread, measuring each call.
+ *
+ * @param name Logger name.
+ * @param msg Message of the records.
+ * @param qtyRecords Records logged.
+ * @param isStarted All threads were created.
+ * @param latencies Output with the latency of each call (ns).
+ */
+void benchThread(const std::string & name,
+                 const std::string & msg,
+                 const size_t & qtyRecords,
+                 const std::atomic<bool> * isStarted,
+                 std::vector<long long> * latencies) {
+    latencies->resize(qtyRecords);
+
+    while (!isStarted->load())
+        std::this_thread::yield();
+
+    for (size_t i = 0; i < qtyRecords; i++) {
+        auto begin = std::chrono::steady_clock::now();
+
+        LOG_INFO(name, msg);
+
+        (*latencies)[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+    }
+}
+
+/**
+ * Run a case of the matrix with a new logger.
+ *
+ * @param benchCase Case to run.
+ * @param qtyRecords Records logged by each thread.
+ *
+ * @return Measures of the case.
+ */
+BenchResult benchCase(const BenchCase & benchCase,
+                      const size_t & qtyRecords) {
+    std::string name = "logger_bench_matrix";
+    std::string msg(benchCase.msgSize, 'x');
+    std::atomic<bool> isStarted(false);
+    std::vector<std::vector<long long>> latencies(benchCase.qtyThreads);
+    std::vector<std::thread> threads;
+
+    std::remove(("/tmp/" + name).c_str());
+
+    LogSetting ls(name, "/tmp/");
+    ls.setInfo(benchCase.info);
+    ls.setWriteMode(benchCase.writeMode);
+
+    LogBuilder::getInstance().buildLogger(ls);
+
+    if (!benchCase.isEnabled)
+        LogBuilder::getInstance().getLogger(name)->rmActiveSeverity(static_cast<int>(SeverityLevel::Info));
+
+    for (unsigned int i = 0; i < benchCase.qtyThreads; i++)
+        threads.emplace_back(benchThread, std::cref(name), std::cref(msg), std::cref(qtyRecords), &isStarted, &latencies[i]);
+
+    auto begin = std::chrono::steady_clock::now();
+
+    isStarted.store(true);
+
+    for (auto & thread : threads)
+        thread.join();
+
+    LogBuilder::getInstance().flush(name);
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+    unsigned long long lockWaitTime = LogBuilder::getInstance().getLogger(name)->getMetrics().lockWaitTime;
+
+    LogBuilder::getInstance().destroyLogger(name);
+    std::remove(("/tmp/" + name).c_str());
+
+    std::vector<long long> all;
+    all.reserve(qtyRecords * benchCase.qtyThreads);
+
+    for (auto & threadLatencies : latencies)
+        all.insert(all.end(), threadLatencies.begin(), threadLatencies.end());
+
+    std::sort(all.begin(), all.end());
+
+    // No sample, e.g. every record was dropped before being timed.
+    if (all.empty())
+        return BenchResult { 0, 0, 0, 0, 0, lockWaitTime };
+
+    auto percentile = [&](const double & p) {
+        return all[std::min(all.size() - 1, static_cast<size_t>(p * all.size()))];
+    };
+
+    return BenchResult { all.size() / elapsed.count(), percentile(0.5), percentile(0.99), percentile(0.999), all.back(), lockWaitTime };
+}
+
+/**
+ * Run every combination of write mode, info format, message size, severity
+ * enabled or disabled and quantity of threads (powers of two up to the
+ * maximum), printing a line by case.
+ *
+ * @param output Report format, "csv" or "json".
+ * @param maxThreads Maximum of threads logging at the same time.
+ * @param qtyRecords Records logged by each thread.
+ */
+void benchMatrix(const std::string & output,
+                 unsigned int maxThreads,
+                 const size_t & qtyRecords) {
+    const std::pair<WriteMode, const char *> writeModes[] = {
+        { WriteMode::Sync, "sync" }, { WriteMode::Async, "async" }, { WriteMode::Buffered, "buffered" }
+    };
+    const std::pair<const char *, std::string> formats[] = {
+        { "severity", "[%S] " }, { "full", benchFormat }
+    };
+    const size_t msgSizes[] = { 16, 128, 1024 };
+    std::vector<unsigned int> qtyThreads;
+
+    for (unsigned int qty = 1; qty < maxThreads; qty *= 2)
+        qtyThreads.push_back(qty);
+
+    qtyThreads.push_back(maxThreads);
+
+    bool isFirst = true;
+
+    if (output == "json")
+        std::cout << "[\n";
+    else
+        std::cout << "write_mode,info_format,message_size,severity,threads,records,records_per_second,p50_ns,p99_ns,p999_ns,max_ns,lock_wait_ns\n";
+
+    for (auto & writeMode : writeModes) {
+        for (auto & format : formats) {
+            for (auto msgSize : msgSizes) {
+                for (bool isEnabled : { true, false }) {
+                    for (auto qty : qtyThreads) {
+                        BenchCase test { writeMode.first, format.first, format.second, msgSize, isEnabled, qty };
+                        BenchResult result = benchCase(test, qtyRecords);
+                        const char * severity = isEnabled ? "enabled" : "disabled";
+
+                        if (output == "json") {
+                            std::cout << (isFirst ? "" : ",\n")
+                                      << "  {\"write_mode\": \"" << writeMode.second << "\", \"info_format\": \"" << format.first
+                                      << "\", \"message_size\": " << msgSize << ", \"severity\": \"" << severity
+                                      << "\", \"threads\": " << qty << ", \"records\": " << (qty * qtyRecords)
+                                      << ", \"records_per_second\": " << static_cast<long>(result.recordsPerSecond)
+                                      << ", \"p50_ns\": " << result.p50 << ", \"p99_ns\": " << result.p99
+                                      << ", \"p999_ns\": " << result.p999 << ", \"max_ns\": " << result.max
+                                      << ", \"lock_wait_ns\": " << result.lockWaitTime << "}";
+                        } else {
+                            std::cout << writeMode.second << "," << format.first << "," << msgSize << "," << severity << ","
+                                      << qty << "," << (qty * qtyRecords) << "," << static_cast<long>(result.recordsPerSecond) << ","
+                                      << result.p50 << "," << result.p99 << "," << result.p999 << "," << result.max << ","
+                                      << result.lockWaitTime << "\n";
+                        }
+
+                        std::cout.flush();
+                        isFirst = false;
+                    }
+                }
+            }
+        }
+    }
+
+    if (output == "json")
+        std::cout << "\n]\n";
+}
+
+/**
+ * Parse a count given in the command line.
+ *
+ * @param arg Argument.
+ * @param max Maximum accepted.
+ * @param value Output with the count.
+ *
+ * @return True if the argument is a number between 1 and the maximum and
+ *         false otherwise.
+ */
+bool parseCount(const char * arg,
+                const unsigned long long & max,
+                unsigned long long & value) {
+    char * end = nullptr;
+
+    if ((*arg < '0') || (*arg > '9'))
+        return false;
+
+    errno = 0;
+    value = std::strtoull(arg, &end, 10);
+
+    return ((errno == 0) && (*end == '\0') && (value >= 1) && (value <= max));
+}
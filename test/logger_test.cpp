@@ -23,21 +23,72 @@
  */
 
 #include "src/logger.h"
+#include "src/logarchiver.h"
+#include "src/logbinary.h"
+#include "src/logconfig.h"
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <string>
 #include <thread>
 #include <chrono>
 #include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <new>
 #include <exception>
+#include <ctime>
+
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <limits>
+
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <signal.h>
+#include <unistd.h>
+#include <dirent.h>
+
+#include <zlib.h>
 
 
 const static std::string logName = "logger";
 const static std::string logPath = "/tmp/";
 static int logRecordsCount = 0;
+static int messagesBuiltCount = 0;
+
+// Allocations of the thread while it's counting them, see loggerAllocationTest().
+static thread_local bool isCountingAllocations = false;
+static thread_local long qtyAllocations = 0;
+
+void * operator new(size_t size) {
+    if (isCountingAllocations)
+        qtyAllocations++;
+
+    void * ptr = std::malloc(size == 0 ? 1 : size);
+
+    if (ptr == nullptr)
+        throw std::bad_alloc();
+
+    return ptr;
+}
+
+void operator delete(void * ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void * ptr,
+                     size_t size) noexcept {
+    std::free(ptr);
+}
 
 #define THREAD_RECORDS 10000
+#define REGISTRY_ROUNDS 500
 
 int startTest();
 int findRecordInFile(const std::string & file,
@@ -51,12 +102,90 @@ bool loggerGettingTest();
 bool loggerBuilderTest();
 bool loggerEnableTest(const std::string & file);
 bool loggerActiveSeverityTest(const std::string & file);
+bool loggerReopenTest();
+void asyncThreadLoop(const std::string & name);
+void closingThreadLoop(std::shared_ptr<Logger> logger,
+                      std::atomic<int> * qtyAccepted);
+bool loggerAsyncTest();
+bool loggerFormatTest();
+int countMessageBuilt();
+bool loggerLazyMessageTest();
+void logReferenceRecord(const std::string & name,
+                        const std::string & msg);
+bool loggerReferenceTest();
+void registryWriterLoop(int * qtyWritten);
+void registryBuilderLoop();
+bool loggerRegistryStressTest();
+bool loggerBufferedTest();
+bool fileHasZeros(const std::string & file);
+bool loggerMmapTest();
+std::vector<std::string> listSegments(const std::string & path,
+                                      const std::string & name);
+bool readRecordNumbers(const std::string & file,
+                       std::set<int> & numbers);
+bool loggerRotationTest();
+void binaryRecordLoop(const std::string & name);
+std::string readFile(const std::string & file);
+bool loggerBinaryTest();
+void deferredRecords(const std::string & name);
+bool loggerDeferredTest();
+void jsonRecord(const std::string & name,
+                std::string * function,
+                int * line);
+bool loggerJsonTest();
+void sharedSinkLoop(const std::string & name);
+bool loggerSinkTest();
+void crashThreadLoop(const std::string & name);
+bool loggerCrashBufferTest();
+void configThreadLoop(const std::atomic<bool> * isRunning);
+void writeConfig(const std::string & path,
+                 const std::string & config);
+bool loggerConfigTest();
+long allocationRecords(const std::string & name,
+                       const bool & isCounting);
+bool loggerAllocationTest();
+void siteRecord(const std::string & name,
+                int * line);
+unsigned long long getSiteHits(const int & line);
+std::vector<std::string> readLines(const std::string & file);
+bool loggerCallSiteTest();
+void floodRecord(const std::string & name,
+                 const std::string & msg);
+bool loggerRateLimitTest();
+LogMetrics findMetrics(const std::string & name);
+bool loggerMetricsTest();
+void sharedThreadLoop(const std::string & name,
+                      const int & thread,
+                      const int & qtyRecords);
+bool loggerSharedWriteTest();
+template<typename T>
+std::string streamText(const T & value);
+template<typename T>
+std::string ostreamText(const T & value);
+bool loggerStreamTest();
+template<typename Format>
+bool isStaticFormatEqual();
+void staticFormatRecords(const std::string & name);
+bool loggerStaticFormatTest();
+int exitRecords(const std::string & name,
+                const int & writeMode);
+bool loggerExitTest();
+int shortWriteRecords(const std::string & name);
 
 int main(int argc,
          char * argv[]) {
+    // Application logging until it returns from main, see loggerExitTest().
+    if ((argc == 4) && (std::string(argv[1]) == "--exit-records"))
+        return exitRecords(argv[2], std::atoi(argv[3]));
+
+    // Records written in parallel until the file is full, see
+    // loggerSharedWriteTest().
+    if ((argc == 3) && (std::string(argv[1]) == "--short-write"))
+        return shortWriteRecords(argv[2]);
+
     int result = startTest();
 
-    std::cout << "\n===Test finished with " << result << " of 8 approved.===\n";
+    std::cout << "\n===Test finished with " << result << " of 31 approved.===\n";
 
     return (0);
 }
@@ -107,6 +236,75 @@ int startTest() {
     if (loggerActiveSeverityTest(absPath) == true)
         qtyApprovedTest++;
 
+    if (loggerReopenTest() == true)
+        qtyApprovedTest++;
+
+    if (loggerAsyncTest() == true)
+        qtyApprovedTest++;
+
+    if (loggerFormatTest() == true)
+        qtyApprovedTest++;
+
+    if (loggerLazyMessageTest() == true)
+        qtyApprovedTest++;
+
+    if (loggerReferenceTest() == true)
+        qtyApprovedTest++;
+
+    if (loggerRegistryStressTest() == true)
+        qtyApprovedTest++;
+
+    if (loggerBufferedTest() == true)
+        qtyApprovedTest++;
+
+    if (loggerMmapTest() == true)
+        qtyApprovedTest++;
+
+    if (loggerRotationTest() == true)
+        qtyApprovedTest++;
+
+    if (loggerBinaryTest() == true)
+        qtyApprovedTest++;
+
+    if (loggerDeferredTest() == true)
+        qtyApprovedTest++;
+
+    if (loggerJsonTest() == true)
+        qtyApprovedTest++;
+
+    if (loggerSinkTest() == true)
+        qtyApprovedTest++;
+
+    if (loggerCrashBufferTest() == true)
+        qtyApprovedTest++;
+
+    if (loggerConfigTest() == true)
+        qtyApprovedTest++;
+
+    if (loggerAllocationTest() == true)
+        qtyApprovedTest++;
+
+    if (loggerCallSiteTest() == true)
+        qtyApprovedTest++;
+
+    if (loggerRateLimitTest() == true)
+        qtyApprovedTest++;
+
+    if (loggerMetricsTest() == true)
+        qtyApprovedTest++;
+
+    if (loggerSharedWriteTest() == true)
+        qtyApprovedTest++;
+
+    if (loggerStreamTest() == true)
+        qtyApprovedTest++;
+
+    if (loggerStaticFormatTest() == true)
+        qtyApprovedTest++;
+
+    if (loggerExitTest() == true)
+        qtyApprovedTest++;
+
 
     return qtyApprovedTest;
 }
@@ -453,6 +651,18 @@ bool loggerActiveSeverityTest(const std::string & file) {
         std::cout << "[OK] Logging debug removed.\n";
     }
 
+    // Removing a severity already removed keeps it removed.
+    LogBuilder::getInstance().getLogger(logName)->rmActiveSeverity(static_cast<int>(SeverityLevel::Debug));
+
+    LOG_DEBUG(logName, "(" << logRecordsCount << ") Logging debug removed twice!");
+
+    if (findRecordInFile(file, "Logging debug removed twice!") > 0) {
+        std::cout << "[FALSE] Logging debug removed twice.\n";
+        return false;
+    } else {
+        std::cout << "[OK] Logging debug removed twice.\n";
+    }
+
     LogBuilder::getInstance().getLogger(logName)->enableAllSeverity();
 
     LOG_INFO(logName, "(" << logRecordsCount << ") Logging all info!");
@@ -497,4 +707,2305 @@ bool loggerActiveSeverityTest(const std::string & file) {
     }
 
     return true;
-}
\ No newline at end of file
+}
+
+bool loggerReopenTest() {
+    std::cout << "===> Testing persistent file reopen!\n";
+
+    std::string logName = "log_reopen";
+    std::string absPath = logPath + logName;
+    std::string movedPath = absPath + ".1";
+
+    std::remove(absPath.c_str());
+    std::remove(movedPath.c_str());
+
+    LogSetting ls(logName, logPath);
+    ls.setFileCheckInterval(std::chrono::milliseconds(0));
+
+    LogBuilder::getInstance().buildLogger(ls);
+
+    LOG_INFO(logName, "Record before move!");
+
+    std::rename(absPath.c_str(), movedPath.c_str());
+
+    LOG_INFO(logName, "Record after move!");
+
+    if ((findRecordInFile(movedPath, "Record before move!") == 1) &&
+        (findRecordInFile(movedPath, "Record after move!") == 0) &&
+        (findRecordInFile(absPath, "Record after move!") == 1)) {
+        std::cout << "[OK] Log file reopened after being moved.\n";
+    } else {
+        std::cout << "[FAIL] Log file reopened after being moved.\n";
+        return false;
+    }
+
+    std::remove(absPath.c_str());
+
+    LogBuilder::getInstance().reopen(logName);
+    LogBuilder::getInstance().flush(logName);
+
+    LOG_INFO(logName, "Record after explicit reopen!");
+
+    if (findRecordInFile(absPath, "Record after explicit reopen!") == 1) {
+        std::cout << "[OK] Log file reopened explicitly.\n";
+    } else {
+        std::cout << "[FAIL] Log file reopened explicitly.\n";
+        return false;
+    }
+
+    LogBuilder::getInstance().destroyLogger(logName);
+
+    return true;
+}
+
+void asyncThreadLoop(const std::string & name) {
+    for (int i = 1; i <= THREAD_RECORDS; i++) {
+        LOG_DEBUG(name, "Async test - Writing record (" << i << ") of " << THREAD_RECORDS << " with thread id (" << std::this_thread::get_id() << ")");
+    }
+}
+
+void closingThreadLoop(std::shared_ptr<Logger> logger,
+                      std::atomic<int> * qtyAccepted) {
+    for (int i = 0; logger->write(SeverityLevel::Info, __FILE__, __PRETTY_FUNCTION__, __LINE__, "Closing record"); i++) {
+        (*qtyAccepted)++;
+
+        if ((i % 64) == 0)
+            logger->flush();
+    }
+
+    logger->flush();
+}
+
+bool loggerAsyncTest() {
+    std::cout << "===> Testing asynchronous writer!\n";
+
+    std::string logName = "log_async";
+    std::string absPath = logPath + logName;
+
+    std::remove(absPath.c_str());
+
+    LogSetting ls(logName, logPath);
+    ls.setWriteMode(WriteMode::Async);
+    ls.setQueueCapacity(1024);
+
+    LogBuilder::getInstance().buildLogger(ls);
+
+    std::thread tone(asyncThreadLoop, logName);
+    std::thread ttwo(asyncThreadLoop, logName);
+    std::thread tthree(asyncThreadLoop, logName);
+    std::thread tfour(asyncThreadLoop, logName);
+
+    tone.join();
+    ttwo.join();
+    tthree.join();
+    tfour.join();
+
+    LogBuilder::getInstance().flush(logName);
+
+    if (findRecordInFile(absPath, "Async test") == (4 * THREAD_RECORDS)) {
+        std::cout << "[OK] Asynchronous writer wrote everything after flush.\n";
+    } else {
+        std::cout << "[FAIL] Asynchronous writer wrote everything after flush.\n";
+        return false;
+    }
+
+    LogBatchStats stats = LogBuilder::getInstance().getLogger(logName)->getBatchStats();
+
+    std::cout << "Asynchronous writer wrote " << stats.qtyRecords << " records with " << stats.qtyWrites << " writes.\n";
+
+    if ((stats.qtyRecords == (4 * THREAD_RECORDS)) && (stats.qtyWrites < stats.qtyRecords)) {
+        std::cout << "[OK] Asynchronous writer wrote records in batches.\n";
+    } else {
+        std::cout << "[FAIL] Asynchronous writer wrote records in batches.\n";
+        return false;
+    }
+
+    LOG_INFO(logName, "Async record before destroy!");
+
+    LogBuilder::getInstance().destroyLogger(logName);
+
+    if (findRecordInFile(absPath, "Async record before destroy!") == 1) {
+        std::cout << "[OK] Asynchronous writer drained while destroying logger.\n";
+    } else {
+        std::cout << "[FAIL] Asynchronous writer drained while destroying logger.\n";
+        return false;
+    }
+
+    std::remove(absPath.c_str());
+
+    ls.setQueueCapacity(2);
+    ls.setOverflowPolicy(OverflowPolicy::DropNewest);
+
+    LogBuilder::getInstance().buildLogger(ls);
+
+    std::thread tdrop(asyncThreadLoop, logName);
+    tdrop.join();
+
+    LogBuilder::getInstance().destroyLogger(logName);
+
+    int lineCount = findRecordInFile(absPath, "Async test");
+
+    if ((lineCount == THREAD_RECORDS) ||
+        ((lineCount < THREAD_RECORDS) && (findRecordInFile(absPath, "records dropped") > 0))) {
+        std::cout << "[OK] Asynchronous writer reported records dropped.\n";
+    } else {
+        std::cout << "[FAIL] Asynchronous writer reported records dropped.\n";
+        return false;
+    }
+
+    // Records written and flushed while the logger is closed, each record
+    // accepted is written and no flush waits for a writer stopped.
+    ls.setQueueCapacity(1024);
+    ls.setOverflowPolicy(OverflowPolicy::Block);
+
+    for (int i = 0; i < 20; i++) {
+        std::remove(absPath.c_str());
+
+        LogBuilder::getInstance().buildLogger(ls);
+
+        std::shared_ptr<Logger> logger = LogBuilder::getInstance().getLogger(logName);
+        std::atomic<int> qtyAccepted(0);
+        std::vector<std::thread> threads;
+
+        for (int j = 0; j < 4; j++)
+            threads.emplace_back(closingThreadLoop, logger, &qtyAccepted);
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        logger->close();
+        logger->flush();
+
+        for (auto & thread : threads)
+            thread.join();
+
+        LogBuilder::getInstance().destroyLogger(logName);
+
+        if (findRecordInFile(absPath, "Closing record") != qtyAccepted.load()) {
+            std::cout << "[FAIL] Asynchronous writer closed while threads write.\n";
+            return false;
+        }
+    }
+
+    std::cout << "[OK] Asynchronous writer closed while threads write.\n";
+
+    return true;
+}
+
+bool loggerFormatTest() {
+    std::cout << "===> Testing info format!\n";
+
+    std::tm tm = {};
+    tm.tm_year = 2019 - 1900;
+    tm.tm_mon = 8;
+    tm.tm_mday = 1;
+    tm.tm_hour = 21;
+    tm.tm_min = 23;
+    tm.tm_sec = 49;
+    tm.tm_isdst = -1;
+
+    auto time = std::chrono::system_clock::from_time_t(std::mktime(&tm)) + std::chrono::milliseconds(817);
+
+    LogFormat logFormat("[%D{%Y-%m-%d %H:%M:%S:%q}][%S] File %F:%L %M 100%% - ");
+    std::string header;
+
+    logFormat.render(header, time, "test.cpp", "int main()", 42, "debug");
+
+    if (header == "[2019-09-01 21:23:49:817][debug] File test.cpp:42 int main() 100% - ") {
+        std::cout << "[OK] Info format compiled.\n";
+    } else {
+        std::cout << "[FAIL] Info format compiled. Header: (" << header << ")\n";
+        return false;
+    }
+
+    header.clear();
+
+    logFormat.render(header, time + std::chrono::milliseconds(1190), "test.cpp", "int main()", 42, "debug");
+
+    if (header == "[2019-09-01 21:23:51:7][debug] File test.cpp:42 int main() 100% - ") {
+        std::cout << "[OK] Info format date/time cache renewed.\n";
+    } else {
+        std::cout << "[FAIL] Info format date/time cache renewed. Header: (" << header << ")\n";
+        return false;
+    }
+
+    logFormat.compile("");
+    header.clear();
+
+    logFormat.render(header, time, "test.cpp", "int main()", 42, "debug");
+
+    if (header.empty()) {
+        std::cout << "[OK] Empty info format.\n";
+    } else {
+        std::cout << "[FAIL] Empty info format.\n";
+        return false;
+    }
+
+    return true;
+}
+
+int countMessageBuilt() {
+    return ++messagesBuiltCount;
+}
+
+bool loggerLazyMessageTest() {
+    std::cout << "===> Testing message built only when severity is active!\n";
+
+    std::string logName = "log_lazy";
+
+    LogBuilder::getInstance().buildLogger(logName, logPath);
+    LogBuilder::getInstance().getLogger(logName)->setDebugSeverityEnable(false);
+
+    messagesBuiltCount = 0;
+
+    LOG_DEBUG(logName, "Message built " << countMessageBuilt() << " times!");
+
+    if (messagesBuiltCount == 0) {
+        std::cout << "[OK] Message not built with debug disabled.\n";
+    } else {
+        std::cout << "[FAIL] Message not built with debug disabled.\n";
+        return false;
+    }
+
+    LogBuilder::getInstance().getLogger(logName)->setEnable(false);
+
+    LOG_INFO(logName, "Message built " << countMessageBuilt() << " times!");
+
+    if (messagesBuiltCount == 0) {
+        std::cout << "[OK] Message not built with logger disabled.\n";
+    } else {
+        std::cout << "[FAIL] Message not built with logger disabled.\n";
+        return false;
+    }
+
+    LogBuilder::getInstance().getLogger(logName)->setEnable(true);
+
+    LOG_INFO(logName, "Message built " << countMessageBuilt() << " times!");
+
+    if (messagesBuiltCount == 1) {
+        std::cout << "[OK] Message built with info enabled.\n";
+    } else {
+        std::cout << "[FAIL] Message built with info enabled.\n";
+        return false;
+    }
+
+    LogBuilder::getInstance().destroyLogger(logName);
+
+    return true;
+}
+
+void logReferenceRecord(const std::string & name,
+                        const std::string & msg) {
+    LOG_INFO(name, msg);
+}
+
+bool loggerReferenceTest() {
+    std::cout << "===> Testing logger reference!\n";
+
+    std::string logName = "log_ref";
+    std::string otherName = "log_ref_other";
+    std::string absPath = logPath + logName;
+    std::string otherPath = logPath + otherName;
+    std::string rebuiltPath = logPath + "rebuilt/" + logName;
+    bool wasIssuedException = false;
+
+    std::remove(absPath.c_str());
+    std::remove(otherPath.c_str());
+    std::remove(rebuiltPath.c_str());
+
+    LogBuilder::getInstance().buildLogger(logName, logPath);
+    LogBuilder::getInstance().buildLogger(otherName, logPath);
+
+    logReferenceRecord(logName, "Reference first logger!");
+    logReferenceRecord(otherName, "Reference other logger!");
+
+    if ((findRecordInFile(absPath, "Reference first logger!") == 1) &&
+        (findRecordInFile(otherPath, "Reference other logger!") == 1)) {
+        std::cout << "[OK] Reference follows the logger name.\n";
+    } else {
+        std::cout << "[FAIL] Reference follows the logger name.\n";
+        return false;
+    }
+
+    LogBuilder::getInstance().destroyLogger(logName);
+
+    try {
+        logReferenceRecord(logName, "Reference destroyed logger!");
+    } catch (LoggerException & e) {
+        std::cerr << "[" << __PRETTY_FUNCTION__ << "][" << __LINE__ << "] - " << e.what() << "\n";
+        wasIssuedException = true;
+    }
+
+    if (wasIssuedException == true) {
+        std::cout << "[OK] Exception issued sucessfully while using reference of destroyed logger.\n";
+    } else {
+        std::cout << "[FAIL] No exception issued while using reference of destroyed logger.\n";
+        return false;
+    }
+
+    LogBuilder::getInstance().buildLogger(logName, "/tmp/rebuilt/");
+
+    mkdir("/tmp/rebuilt", 0755);
+
+    logReferenceRecord(logName, "Reference rebuilt logger!");
+
+    if ((findRecordInFile(absPath, "Reference rebuilt logger!") == 0) &&
+        (findRecordInFile(rebuiltPath, "Reference rebuilt logger!") == 1)) {
+        std::cout << "[OK] Reference follows the logger rebuilt.\n";
+    } else {
+        std::cout << "[FAIL] Reference follows the logger rebuilt.\n";
+        return false;
+    }
+
+    LogBuilder::getInstance().destroyLogger(logName);
+    LogBuilder::getInstance().destroyLogger(otherName);
+
+    return true;
+}
+
+void registryWriterLoop(int * qtyWritten) {
+    for (int i = 1; i <= THREAD_RECORDS; i++) {
+        LOG_INFO("log_registry", "Registry test - Writing record (" << i << ") with thread id (" << std::this_thread::get_id() << ")");
+        (*qtyWritten)++;
+
+        try {
+            LOG_INFO("log_registry_churn", "Registry churn record (" << i << ")");
+        } catch (LoggerException & e) {
+            // Logger destroyed by the builder thread.
+        }
+    }
+}
+
+void registryBuilderLoop() {
+    for (int i = 0; i < REGISTRY_ROUNDS; i++) {
+        std::string name = "log_registry_churn_" + std::to_string(i % 8);
+
+        LogBuilder::getInstance().buildLogger(name, logPath);
+        LogBuilder::getInstance().buildLogger("log_registry_churn", logPath);
+
+        std::this_thread::yield();
+
+        LogBuilder::getInstance().destroyLogger("log_registry_churn");
+        LogBuilder::getInstance().destroyLogger(name);
+    }
+}
+
+bool loggerRegistryStressTest() {
+    std::cout << "===> Starting registry stress test!\n";
+
+    std::string absPath = logPath + "log_registry";
+    int qtyWritten[4] = { 0, 0, 0, 0 };
+
+    std::remove(absPath.c_str());
+    std::remove((logPath + "log_registry_churn").c_str());
+
+    LogBuilder::getInstance().buildLogger("log_registry", logPath);
+
+    std::thread tbuilder(registryBuilderLoop);
+    std::thread tone(registryWriterLoop, &qtyWritten[0]);
+    std::thread ttwo(registryWriterLoop, &qtyWritten[1]);
+    std::thread tthree(registryWriterLoop, &qtyWritten[2]);
+    std::thread tfour(registryWriterLoop, &qtyWritten[3]);
+
+    tbuilder.join();
+    tone.join();
+    ttwo.join();
+    tthree.join();
+    tfour.join();
+
+    std::cout << "Registry stress test finished!\n";
+
+    int qtyExpected = qtyWritten[0] + qtyWritten[1] + qtyWritten[2] + qtyWritten[3];
+
+    if ((qtyExpected == (4 * THREAD_RECORDS)) &&
+        (findRecordInFile(absPath, "Registry test") == qtyExpected)) {
+        std::cout << "[OK] Registry stress test wrote everything while building/destroying loggers.\n";
+    } else {
+        std::cout << "[FAIL] Registry stress test wrote everything while building/destroying loggers.\n";
+        return false;
+    }
+
+    LogBuilder::getInstance().destroyLogger("log_registry");
+
+    return true;
+}
+
+bool loggerBufferedTest() {
+    std::cout << "===> Testing buffered writing!\n";
+
+    std::string logName = "log_buffered";
+    std::string absPath = logPath + logName;
+
+    std::remove(absPath.c_str());
+
+    LogSetting ls(logName, logPath);
+    ls.setWriteMode(WriteMode::Buffered);
+    ls.setFlushPolicy(1024 * 1024, std::chrono::milliseconds(100), static_cast<int>(SeverityLevel::Error));
+
+    LogBuilder::getInstance().buildLogger(ls);
+
+    std::thread tone(asyncThreadLoop, logName);
+    std::thread ttwo(asyncThreadLoop, logName);
+    std::thread tthree(asyncThreadLoop, logName);
+    std::thread tfour(asyncThreadLoop, logName);
+
+    // The threads render the headers with the format being replaced.
+    for (int i = 0; i < 1000; i++)
+        LogBuilder::getInstance().getLogger(logName)->setInfoFormat((i % 2) ? "[%S] " : "[%D{%H:%M:%S}.%q][%S][%F:%L] ");
+
+    tone.join();
+    ttwo.join();
+    tthree.join();
+    tfour.join();
+
+    LogBuilder::getInstance().flush(logName);
+
+    if (findRecordInFile(absPath, "Async test") == (4 * THREAD_RECORDS)) {
+        std::cout << "[OK] Buffered writing wrote everything after flush.\n";
+    } else {
+        std::cout << "[FAIL] Buffered writing wrote everything after flush.\n";
+        return false;
+    }
+
+    LOG_INFO(logName, "Buffered info record!");
+
+    if (findRecordInFile(absPath, "Buffered info record!") == 0) {
+        std::cout << "[OK] Buffered record kept in the thread buffer.\n";
+    } else {
+        std::cout << "[FAIL] Buffered record kept in the thread buffer.\n";
+        return false;
+    }
+
+    LOG_ERROR(logName, "Buffered error record!");
+
+    if ((findRecordInFile(absPath, "Buffered info record!") == 1) &&
+        (findRecordInFile(absPath, "Buffered error record!") == 1)) {
+        std::cout << "[OK] Buffered records written by error severity.\n";
+    } else {
+        std::cout << "[FAIL] Buffered records written by error severity.\n";
+        return false;
+    }
+
+    LOG_INFO(logName, "Buffered record written by interval!");
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+    if (findRecordInFile(absPath, "Buffered record written by interval!") == 1) {
+        std::cout << "[OK] Buffered record written by flush interval.\n";
+    } else {
+        std::cout << "[FAIL] Buffered record written by flush interval.\n";
+        return false;
+    }
+
+    LOG_INFO(logName, "Buffered record before destroy!");
+
+    LogBuilder::getInstance().destroyLogger(logName);
+
+    if (findRecordInFile(absPath, "Buffered record before destroy!") == 1) {
+        std::cout << "[OK] Buffered records written while destroying logger.\n";
+    } else {
+        std::cout << "[FAIL] Buffered records written while destroying logger.\n";
+        return false;
+    }
+
+    return true;
+}
+
+bool fileHasZeros(const std::string & file) {
+    std::ifstream inFile(file, std::ifstream::in | std::ifstream::binary);
+    char c;
+
+    while (inFile.get(c)) {
+        if (c == '\0')
+            return true;
+    }
+
+    return false;
+}
+
+bool loggerMmapTest() {
+    std::cout << "===> Testing memory-mapped file!\n";
+
+    std::string logName = "log_mmap";
+    std::string absPath = logPath + logName;
+
+    std::remove(absPath.c_str());
+
+    LogSetting ls(logName, logPath);
+    ls.setFileMode(FileMode::Mmap);
+    ls.setMmapWindowSize(64 * 1024);
+
+    LogBuilder::getInstance().buildLogger(ls);
+
+    std::thread tone(asyncThreadLoop, logName);
+    std::thread ttwo(asyncThreadLoop, logName);
+
+    tone.join();
+    ttwo.join();
+
+    if (findRecordInFile(absPath, "Async test") == (2 * THREAD_RECORDS)) {
+        std::cout << "[OK] Memory-mapped file wrote everything across windows.\n";
+    } else {
+        std::cout << "[FAIL] Memory-mapped file wrote everything across windows.\n";
+        return false;
+    }
+
+    LogBuilder::getInstance().destroyLogger(logName);
+
+    if (!fileHasZeros(absPath)) {
+        std::cout << "[OK] Memory-mapped file truncated when closed.\n";
+    } else {
+        std::cout << "[FAIL] Memory-mapped file truncated when closed.\n";
+        return false;
+    }
+
+    // The application crashes without closing the file, the records are
+    // kept by the kernel and the file ends with the zeros of the window.
+    pid_t pid = fork();
+
+    if (pid == 0) {
+        Logger logger(ls);
+
+        for (int i = 1; i <= 100; i++)
+            logger.write(SeverityLevel::Info, __FILE__, __PRETTY_FUNCTION__, __LINE__, "Record before crash (" + std::to_string(i) + ")");
+
+        kill(getpid(), SIGKILL);
+    }
+
+    waitpid(pid, nullptr, 0);
+
+    if ((findRecordInFile(absPath, "Record before crash") == 100) && fileHasZeros(absPath)) {
+        std::cout << "[OK] Memory-mapped records kept after crash.\n";
+    } else {
+        std::cout << "[FAIL] Memory-mapped records kept after crash.\n";
+        return false;
+    }
+
+    LogBuilder::getInstance().buildLogger(ls);
+
+    LOG_INFO(logName, "Record after crash!");
+
+    LogBuilder::getInstance().destroyLogger(logName);
+
+    if ((findRecordInFile(absPath, "Record before crash") == 100) &&
+        (findRecordInFile(absPath, "Record after crash!") == 1) &&
+        (findRecordInFile(absPath, "Async test") == (2 * THREAD_RECORDS)) &&
+        !fileHasZeros(absPath)) {
+        std::cout << "[OK] Memory-mapped file recovered after crash.\n";
+    } else {
+        std::cout << "[FAIL] Memory-mapped file recovered after crash.\n";
+        return false;
+    }
+
+    return true;
+}
+
+std::vector<std::string> listSegments(const std::string & path,
+                                      const std::string & name) {
+    std::vector<std::string> segments;
+    DIR * dir = opendir(path.c_str());
+
+    if (dir == nullptr)
+        return segments;
+
+    struct dirent * entry;
+
+    while ((entry = readdir(dir)) != nullptr) {
+        if (LogArchiver::isSegment(entry->d_name, name))
+            segments.push_back(path + entry->d_name);
+    }
+
+    closedir(dir);
+
+    return segments;
+}
+
+bool readRecordNumbers(const std::string & file,
+                       std::set<int> & numbers) {
+    // Reads plain and compressed files.
+    gzFile gz = gzopen(file.c_str(), "rb");
+
+    if (gz == nullptr)
+        return false;
+
+    char line[256];
+
+    while (gzgets(gz, line, sizeof(line)) != nullptr) {
+        int number;
+
+        if ((sscanf(line, "Rotation record (%d)", &number) != 1) || !numbers.insert(number).second) {
+            gzclose(gz);
+            return false; // Unknown or duplicated record.
+        }
+    }
+
+    gzclose(gz);
+
+    return true;
+}
+
+bool loggerRotationTest() {
+    std::cout << "===> Testing log rotation!\n";
+
+    std::string logName = "log_rotation";
+    std::string rotationPath = logPath + "rotation/";
+    std::string absPath = rotationPath + logName;
+
+    mkdir(rotationPath.c_str(), 0755);
+
+    std::remove(absPath.c_str());
+
+    for (auto & segment : listSegments(rotationPath, logName))
+        std::remove(segment.c_str());
+
+    LogSetting ls(logName, rotationPath);
+    ls.setRotationPolicy(1024, std::chrono::milliseconds(0), 3);
+    ls.setCompress(true);
+
+    LogBuilder::getInstance().buildLogger(ls);
+
+    for (int i = 1; i <= 400; i++)
+        LogBuilder::getInstance().getLogger(logName)->write(SeverityLevel::Info, __FILE__, __PRETTY_FUNCTION__, __LINE__, "Rotation record (" + std::to_string(i) + ")");
+
+    LogArchiver::getInstance()->wait();
+
+    std::vector<std::string> segments = listSegments(rotationPath, logName);
+    bool isCompressed = (segments.size() == 3);
+
+    for (auto & segment : segments) {
+        if (segment.compare(segment.size() - 3, 3, ".gz") != 0)
+            isCompressed = false;
+    }
+
+    if (isCompressed) {
+        std::cout << "[OK] Rotated files compressed and the oldest removed.\n";
+    } else {
+        std::cout << "[FAIL] Rotated files compressed and the oldest removed.\n";
+        return false;
+    }
+
+    // The files retained and the current one hold the newest records,
+    // without any missing between them.
+    std::set<int> numbers;
+    bool isRead = readRecordNumbers(absPath, numbers);
+
+    for (auto & segment : segments)
+        isRead = isRead && readRecordNumbers(segment, numbers);
+
+    struct stat st;
+
+    if (isRead && !numbers.empty() && (*numbers.rbegin() == 400) &&
+        (static_cast<int>(numbers.size()) == (400 - *numbers.begin() + 1)) &&
+        (stat(absPath.c_str(), &st) == 0) && (st.st_size <= 1024)) {
+        std::cout << "[OK] Rotated files hold the newest records in sequence.\n";
+    } else {
+        std::cout << "[FAIL] Rotated files hold the newest records in sequence.\n";
+        return false;
+    }
+
+    LogBuilder::getInstance().destroyLogger(logName);
+
+    for (auto & segment : segments)
+        std::remove(segment.c_str());
+
+    std::remove(absPath.c_str());
+
+    // Rotation by age, kept uncompressed.
+    ls.setRotationPolicy(0, std::chrono::milliseconds(100), 0);
+    ls.setCompress(false);
+
+    LogBuilder::getInstance().buildLogger(ls);
+
+    LogBuilder::getInstance().getLogger(logName)->write(SeverityLevel::Info, __FILE__, __PRETTY_FUNCTION__, __LINE__, "Rotation record (1)");
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+
+    LogBuilder::getInstance().getLogger(logName)->write(SeverityLevel::Info, __FILE__, __PRETTY_FUNCTION__, __LINE__, "Rotation record (2)");
+
+    LogArchiver::getInstance()->wait();
+
+    segments = listSegments(rotationPath, logName);
+
+    if ((segments.size() == 1) &&
+        (findRecordInFile(segments[0], "Rotation record (1)") == 1) &&
+        (findRecordInFile(absPath, "Rotation record (2)") == 1) &&
+        (findRecordInFile(absPath, "Rotation record (1)") == 0)) {
+        std::cout << "[OK] Log file rotated by age.\n";
+    } else {
+        std::cout << "[FAIL] Log file rotated by age.\n";
+        return false;
+    }
+
+    LogBuilder::getInstance().destroyLogger(logName);
+
+    return true;
+}
+
+void binaryRecordLoop(const std::string & name) {
+    for (int i = 1; i <= 100; i++) {
+        if (i % 10 == 0) {
+            LOG_WARNING(name, "Binary record (" << i << ") with a warning");
+        } else {
+            LOG_INFO(name, "Binary record (" << i << ")");
+        }
+    }
+
+    LOG_ERROR(name, "");
+}
+
+std::string readFile(const std::string & file) {
+    std::ifstream inFile(file, std::ifstream::in | std::ifstream::binary);
+    std::stringstream ss;
+
+    ss << inFile.rdbuf();
+
+    return ss.str();
+}
+
+bool loggerBinaryTest() {
+    std::cout << "===> Testing binary format!\n";
+
+    const WriteMode writeModes[] = { WriteMode::Sync, WriteMode::Async, WriteMode::Buffered };
+    const std::string infoFormat = "[%D{%Y}][%S][%F:%L][%M] - %% ";
+
+    for (auto writeMode : writeModes) {
+        std::string textName = "log_binary_text";
+        std::string binaryName = "log_binary";
+
+        std::remove((logPath + textName).c_str());
+        std::remove((logPath + binaryName).c_str());
+
+        LogSetting ls(textName, logPath);
+        ls.setInfo(infoFormat);
+        ls.setWriteMode(writeMode);
+
+        LogBuilder::getInstance().buildLogger(ls);
+
+        LogSetting lsBinary(binaryName, logPath);
+        lsBinary.setInfo(infoFormat);
+        lsBinary.setWriteMode(writeMode);
+        lsBinary.setOutputFormat(OutputFormat::Binary);
+
+        LogBuilder::getInstance().buildLogger(lsBinary);
+
+        binaryRecordLoop(textName);
+        binaryRecordLoop(binaryName);
+
+        LogBuilder::getInstance().destroyLogger(textName);
+        LogBuilder::getInstance().destroyLogger(binaryName);
+
+        std::string text = readFile(logPath + textName);
+        std::string decoded;
+
+        try {
+            LogBinary::decode(readFile(logPath + binaryName), decoded);
+        } catch (LoggerException & e) {
+            std::cout << "[FAIL] Binary log decoded: " << e.what() << "\n";
+            return false;
+        }
+
+        if (!text.empty() && (decoded == text)) {
+            std::cout << "[OK] Binary log decoded as the text written (write mode " << static_cast<int>(writeMode) << ").\n";
+        } else {
+            std::cout << "[FAIL] Binary log decoded as the text written (write mode " << static_cast<int>(writeMode) << ").\n";
+            return false;
+        }
+    }
+
+    // The logger appending to a file written by another run, each rotated
+    // file is decoded alone.
+    std::string binaryName = "log_binary";
+    std::string rotationPath = logPath + "rotation/";
+    std::string absPath = rotationPath + binaryName;
+
+    mkdir(rotationPath.c_str(), 0755);
+
+    std::remove(absPath.c_str());
+
+    for (auto & segment : listSegments(rotationPath, binaryName))
+        std::remove(segment.c_str());
+
+    LogSetting ls(binaryName, rotationPath);
+    ls.setInfo(infoFormat);
+    ls.setOutputFormat(OutputFormat::Binary);
+    ls.setRotationPolicy(2048, std::chrono::milliseconds(0), 0);
+
+    for (int i = 0; i < 2; i++) {
+        LogBuilder::getInstance().buildLogger(ls);
+
+        binaryRecordLoop(binaryName);
+
+        LogBuilder::getInstance().destroyLogger(binaryName);
+    }
+
+    LogArchiver::getInstance()->wait();
+
+    std::vector<std::string> files = listSegments(rotationPath, binaryName);
+    int qtyRecords = 0;
+
+    files.push_back(absPath);
+
+    try {
+        for (auto & file : files) {
+            std::string decoded;
+
+            LogBinary::decode(readFile(file), decoded);
+            qtyRecords += std::count(decoded.begin(), decoded.end(), '\n');
+        }
+    } catch (LoggerException & e) {
+        std::cout << "[FAIL] Rotated binary logs decoded alone: " << e.what() << "\n";
+        return false;
+    }
+
+    if ((files.size() > 2) && (qtyRecords == 202)) {
+        std::cout << "[OK] Rotated binary logs decoded alone.\n";
+    } else {
+        std::cout << "[FAIL] Rotated binary logs decoded alone.\n";
+        return false;
+    }
+
+    for (auto & file : files)
+        std::remove(file.c_str());
+
+    return true;
+}
+
+/**
+ * User type copied into the record, formatted by its own formatter.
+ */
+struct DeferredPoint {
+    int x;
+    int y;
+};
+
+template<>
+struct LogArgFormatter<DeferredPoint> {
+    static void format(std::string & out,
+                       const DeferredPoint & p) {
+        out += '(';
+        LogArgFormatter<int>::format(out, p.x);
+        out += ',';
+        LogArgFormatter<int>::format(out, p.y);
+        out += ')';
+    }
+};
+
+/**
+ * User type formatted with its operator<< when logged.
+ */
+struct DeferredName {
+    std::string first;
+    std::string last;
+};
+
+std::ostream & operator<<(std::ostream & os,
+                          const DeferredName & name) {
+    return os << name.last << ", " << name.first;
+}
+
+void deferredRecords(const std::string & name) {
+    std::string str = "copied";
+    char buffer[16] = "buffer";
+    const char * ptr = "pointer";
+    DeferredPoint point { 3, -4 };
+    DeferredName userName { "Ada", "Lovelace" };
+
+    LOG_INFOF(name, "int={} long={} unsigned={} double={} float={}", -42, 1234567890123LL, 7u, 3.25, 0.1f);
+    LOG_INFOF(name, "bool={} char={} literal={}", true, 'c', "literal");
+    LOG_INFOF(name, "int8={} uint8={} wrapped={}", static_cast<int8_t>('i'), static_cast<uint8_t>('u'), LOG_LITERAL("literal"));
+    LOG_INFOF(name, "string={} buffer={} pointer={}", str, buffer, ptr);
+    LOG_INFOF(name, "point={} name={}", point, userName);
+    LOG_INFOF(name, "braces={{}} missing={} {}", 1);
+    LOG_WARNINGF(name, "no arguments");
+
+    // The arguments are copied, changing them after logging doesn't change
+    // the record.
+    LOG_INFOF(name, "changed={} {}", str, point);
+    str = "changed";
+    point.x = 0;
+
+    LOG_INFOF(name, "large={}", std::string(LogArgs::Capacity * 2, 'x'));
+}
+
+bool loggerDeferredTest() {
+    std::cout << "===> Testing deferred formatting!\n";
+
+    std::string syncName = "log_deferred_sync";
+    std::string asyncName = "log_deferred_async";
+
+    std::remove((logPath + syncName).c_str());
+    std::remove((logPath + asyncName).c_str());
+
+    LogSetting ls(syncName, logPath);
+    ls.setInfo("[%S] ");
+
+    LogBuilder::getInstance().buildLogger(ls);
+
+    LogSetting lsAsync(asyncName, logPath);
+    lsAsync.setInfo("[%S] ");
+    lsAsync.setWriteMode(WriteMode::Async);
+
+    LogBuilder::getInstance().buildLogger(lsAsync);
+
+    deferredRecords(syncName);
+    deferredRecords(asyncName);
+
+    LogBuilder::getInstance().destroyLogger(syncName);
+    LogBuilder::getInstance().destroyLogger(asyncName);
+
+    std::string expected =
+        "[info] int=-42 long=1234567890123 unsigned=7 double=3.25 float=0.1\n"
+        "[info] bool=1 char=c literal=literal\n"
+        "[info] int8=i uint8=u wrapped=literal\n"
+        "[info] string=copied buffer=buffer pointer=pointer\n"
+        "[info] point=(3,-4) name=Lovelace, Ada\n"
+        "[info] braces={} missing=1 {}\n"
+        "[warning] no arguments\n"
+        "[info] changed=copied (3,-4)\n"
+        "[info] large=" + std::string(LogArgs::Capacity * 2, 'x') + "\n";
+
+    if (readFile(logPath + syncName) == expected) {
+        std::cout << "[OK] Deferred record formatted in synchronous mode.\n";
+    } else {
+        std::cout << "[FAIL] Deferred record formatted in synchronous mode.\n";
+        return false;
+    }
+
+    if (readFile(logPath + asyncName) == expected) {
+        std::cout << "[OK] Deferred record formatted by the writer thread.\n";
+    } else {
+        std::cout << "[FAIL] Deferred record formatted by the writer thread.\n";
+        return false;
+    }
+
+    // A literal wrapped larger than the buffer only takes its pointer, a
+    // char array or a literal with the same text is copied and doesn't fit.
+    char buffer[] = "01234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789";
+    LogArgs literalArgs;
+    LogArgs bufferArgs;
+    std::string text;
+
+    literalArgs.capture("literal={}", LOG_LITERAL("01234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789"));
+    literalArgs.format(text);
+
+    if ((sizeof(buffer) > LogArgs::Capacity) && (text == "literal=" + std::string(buffer)) &&
+        !bufferArgs.capture("buffer={}", buffer) && !bufferArgs.capture("buffer={}", "01234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789")) {
+        std::cout << "[OK] String literal captured by pointer.\n";
+    } else {
+        std::cout << "[FAIL] String literal captured by pointer.\n";
+        return false;
+    }
+
+    // A char array without NUL is copied only up to its size.
+    const char full[4] = { 'f', 'u', 'l', 'l' };
+    LogArgs fullArgs;
+
+    text.clear();
+    fullArgs.capture("full={}", full);
+    fullArgs.format(text);
+
+    std::string now;
+
+    LogArgs::formatNow(now, "full={}", full);
+
+    if ((text == "full=full") && (now == "full=full")) {
+        std::cout << "[OK] Char array without NUL copied up to its size.\n";
+    } else {
+        std::cout << "[FAIL] Char array without NUL copied up to its size.\n";
+        return false;
+    }
+
+    return true;
+}
+
+void jsonRecord(const std::string & name,
+                std::string * function,
+                int * line) {
+    *function = __PRETTY_FUNCTION__;
+    *line = __LINE__ + 1;
+    LOG_WARNING(name, "Quote \" backslash \\ line\nbreak tab\t control \x01 utf-8 \xc3\xa9");
+}
+
+bool loggerJsonTest() {
+    std::cout << "===> Testing JSON format!\n";
+
+    const WriteMode writeModes[] = { WriteMode::Sync, WriteMode::Async, WriteMode::Buffered };
+    std::string logName = "log_json";
+    std::string absPath = logPath + logName;
+
+    for (auto writeMode : writeModes) {
+        std::remove(absPath.c_str());
+
+        LogSetting ls(logName, logPath);
+        ls.setOutputFormat(OutputFormat::Json);
+        ls.setWriteMode(writeMode);
+        ls.addField("service", "logger_test");
+        ls.addField("quoted \"key\"", "value");
+
+        LogBuilder::getInstance().buildLogger(ls);
+
+        std::string function;
+        int line = 0;
+
+        jsonRecord(logName, &function, &line);
+        jsonRecord(logName, &function, &line);
+
+        LogBuilder::getInstance().destroyLogger(logName);
+
+        std::string expected = ",\"file\":\"" __FILE__ "\",\"function\":\"" + function + "\","
+                               "\"line\":" + std::to_string(line) + ","
+                               "\"message\":\"Quote \\\" backslash \\\\ line\\nbreak tab\\t control \\u0001 utf-8 \xc3\xa9\","
+                               "\"service\":\"logger_test\",\"quoted \\\"key\\\"\":\"value\"}";
+
+        // {"timestamp":"YYYY-mm-ddTHH:MM:SS.mmmZ","severity":"warning","thread":<id>...
+        std::ifstream inFile(absPath);
+        std::string record;
+        int qtyRecords = 0;
+        bool isValid = true;
+
+        while (std::getline(inFile, record)) {
+            size_t thread = record.find(",\"thread\":");
+            size_t file = record.find(",\"file\":");
+
+            qtyRecords++;
+
+            if ((record.compare(0, 14, "{\"timestamp\":\"") != 0) ||
+                (record.size() < 40) || (record[24] != 'T') || (record[33] != '.') || (record[37] != 'Z') ||
+                (record.compare(38, 22, "\",\"severity\":\"warning\"") != 0) ||
+                (thread != 60) || (file == std::string::npos) ||
+                (record.compare(file, std::string::npos, expected) != 0))
+                isValid = false;
+        }
+
+        if (isValid && (qtyRecords == 2)) {
+            std::cout << "[OK] Records written as JSON (write mode " << static_cast<int>(writeMode) << ").\n";
+        } else {
+            std::cout << "[FAIL] Records written as JSON (write mode " << static_cast<int>(writeMode) << ").\n";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool loggerSinkTest() {
+    std::cout << "===> Testing sinks!\n";
+
+    const WriteMode writeModes[] = { WriteMode::Sync, WriteMode::Async, WriteMode::Buffered };
+    std::string name = "log_sink";
+    std::string copyName = "log_sink_copy";
+    std::string socketPath = logPath + "log_sink.sock";
+
+    for (auto writeMode : writeModes) {
+        std::remove((logPath + name).c_str());
+        std::remove((logPath + copyName).c_str());
+        std::remove(socketPath.c_str());
+
+        // Socket in the place of the syslog daemon.
+        struct sockaddr_un addr;
+        int fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        std::strcpy(addr.sun_path, socketPath.c_str());
+        bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr));
+
+        LogSetting ls(name, logPath);
+        ls.setInfo("[%S] ");
+        ls.setWriteMode(writeMode);
+
+        LogBuilder::getInstance().buildLogger(ls);
+
+        std::shared_ptr<LogRingSink> ring = std::make_shared<LogRingSink>(2);
+        std::shared_ptr<LogSink> copy = std::make_shared<LogFileSink>(LogSetting(copyName, logPath),
+                                                                      static_cast<int>(SeverityLevel::Error));
+        std::shared_ptr<LogSink> syslog = std::make_shared<LogSyslogSink>("logger_test",
+                                                                          static_cast<int>(SeverityLevel::Warning) |
+                                                                          static_cast<int>(SeverityLevel::Error),
+                                                                          (1 << 3), socketPath);
+
+        LogBuilder::getInstance().attachSink(name, ring);
+        LogBuilder::getInstance().attachSink(name, copy);
+        LogBuilder::getInstance().attachSink(name, syslog);
+
+        LOG_INFO(name, "first");
+        LOG_WARNING(name, "second");
+        LOG_ERROR(name, "third");
+
+        LogBuilder::getInstance().flush(name);
+        LogBuilder::getInstance().detachSink(name, ring);
+
+        LOG_ERROR(name, "fourth");
+
+        LogBuilder::getInstance().destroyLogger(name);
+
+        std::vector<std::string> datagrams;
+        char datagram[512];
+        ssize_t len;
+
+        while ((len = recv(fd, datagram, sizeof(datagram), MSG_DONTWAIT)) > 0)
+            datagrams.emplace_back(datagram, len);
+
+        close(fd);
+        std::remove(socketPath.c_str());
+
+        std::string tag = " logger_test[" + std::to_string(getpid()) + "]: ";
+
+        if ((readFile(logPath + name) == "[info] first\n[warning] second\n[error] third\n[error] fourth\n") &&
+            (ring->getRecords() == std::vector<std::string> { "[warning] second\n", "[error] third\n" }) &&
+            (readFile(logPath + copyName) == "[error] third\n[error] fourth\n")) {
+            std::cout << "[OK] Records written in the sinks accepting them (write mode " << static_cast<int>(writeMode) << ").\n";
+        } else {
+            std::cout << "[FAIL] Records written in the sinks accepting them (write mode " << static_cast<int>(writeMode) << ").\n";
+            return false;
+        }
+
+        // <priority>Mmm dd HH:MM:SS ident[pid]: message
+        if ((datagrams.size() == 3) &&
+            (datagrams[0].compare(0, 4, "<12>") == 0) && (datagrams[1].compare(0, 4, "<11>") == 0) &&
+            (datagrams[0].size() > 19) && (datagrams[0].compare(19, std::string::npos, tag + "[warning] second") == 0) &&
+            (datagrams[2].size() > 19) && (datagrams[2].compare(19, std::string::npos, tag + "[error] fourth") == 0)) {
+            std::cout << "[OK] Records sent to the syslog socket (write mode " << static_cast<int>(writeMode) << ").\n";
+        } else {
+            std::cout << "[FAIL] Records sent to the syslog socket (write mode " << static_cast<int>(writeMode) << ").\n";
+            return false;
+        }
+    }
+
+    // The same sink written by two loggers, each with its own log lock.
+    std::string names[] = { "log_sink_a", "log_sink_b" };
+    std::shared_ptr<LogSink> copy = std::make_shared<LogFileSink>(LogSetting(copyName, logPath));
+
+    std::remove((logPath + copyName).c_str());
+
+    for (auto & sinkName : names) {
+        std::remove((logPath + sinkName).c_str());
+
+        LogSetting ls(sinkName, logPath);
+        ls.setInfo("[%S] ");
+
+        LogBuilder::getInstance().buildLogger(ls);
+        LogBuilder::getInstance().attachSink(sinkName, copy);
+    }
+
+    std::thread tone(sharedSinkLoop, names[0]);
+    std::thread ttwo(sharedSinkLoop, names[0]);
+    std::thread tthree(sharedSinkLoop, names[1]);
+    std::thread tfour(sharedSinkLoop, names[1]);
+
+    tone.join();
+    ttwo.join();
+    tthree.join();
+    tfour.join();
+
+    for (auto & sinkName : names)
+        LogBuilder::getInstance().destroyLogger(sinkName);
+
+    std::vector<std::string> lines = readLines(logPath + copyName);
+
+    if ((lines.size() == 20000) &&
+        (std::count(lines.begin(), lines.end(), "[info] Shared sink record") == 20000)) {
+        std::cout << "[OK] Sink shared by loggers wrote every record whole.\n";
+    } else {
+        std::cout << "[FAIL] Sink shared by loggers wrote every record whole.\n";
+        return false;
+    }
+
+    return true;
+}
+
+void sharedSinkLoop(const std::string & name) {
+    for (int i = 0; i < 5000; i++)
+        LOG_INFO(name, "Shared sink record");
+}
+
+void crashThreadLoop(const std::string & name) {
+    for (int i = 0; i < 20000; i++)
+        LOG_DEBUG(name, "crash record");
+}
+
+bool loggerCrashBufferTest() {
+    std::cout << "===> Testing crash buffer!\n";
+
+    std::string name = "log_crash";
+    std::string absPath = logPath + name;
+    std::string banner = "----- Crash buffer of the logger (" + name + ") -----\n";
+
+    std::remove(absPath.c_str());
+
+    LogSetting ls(name, logPath);
+    ls.setInfo("[%S] ");
+    ls.setCrashBuffer(256, static_cast<int>(SeverityLevel::Debug) |
+                           static_cast<int>(SeverityLevel::Error) |
+                           static_cast<int>(SeverityLevel::Fatal));
+
+    LogBuilder::getInstance().buildLogger(ls);
+    LogBuilder::getInstance().getLogger(name)->setActiveSeverity(static_cast<int>(SeverityLevel::Error) |
+                                                                 static_cast<int>(SeverityLevel::Fatal));
+
+    for (int i = 10; i < 40; i++)
+        LOG_DEBUG(name, "debug " << i);
+
+    LOG_ERROR(name, "error");
+    LOG_FATAL(name, "fatal");
+    LOG_FATAL(name, "fatal again");
+
+    LogBuilder::getInstance().destroyLogger(name);
+
+    // Only the end of the debug records fits in the ring and the second
+    // fatal record only dumps the records kept after the first one.
+    std::string content = readFile(absPath);
+    std::string records = "[error] error\n[fatal] fatal\n";
+    std::string dump = content.substr(std::min(content.size(), records.length() + banner.length()));
+    size_t dumpEnd = dump.find("[fatal] fatal\n") + 14;
+
+    if ((content.compare(0, records.length() + banner.length(), records + banner) == 0) &&
+        (dumpEnd <= 256) && (dump[0] == '[') &&
+        (dump.find("[debug] debug 10\n") == std::string::npos) &&
+        (dump.find("[debug] debug 39\n[error] error\n[fatal] fatal\n") != std::string::npos) &&
+        (dump.compare(dumpEnd, std::string::npos, "[fatal] fatal again\n" + banner + "[fatal] fatal again\n") == 0)) {
+        std::cout << "[OK] Crash buffer dumped by fatal records.\n";
+    } else {
+        std::cout << "[FAIL] Crash buffer dumped by fatal records.\n";
+        return false;
+    }
+
+    // Records kept in the ring by threads while the format is replaced.
+    std::remove(absPath.c_str());
+
+    LogBuilder::getInstance().buildLogger(ls);
+    LogBuilder::getInstance().getLogger(name)->setActiveSeverity(static_cast<int>(SeverityLevel::Fatal));
+
+    std::thread tone(crashThreadLoop, name);
+    std::thread ttwo(crashThreadLoop, name);
+
+    for (int i = 0; i < 1000; i++)
+        LogBuilder::getInstance().getLogger(name)->setInfoFormat((i % 2) ? "[%S] " : "[%D{%H:%M:%S}.%q][%S][%F:%L] ");
+
+    tone.join();
+    ttwo.join();
+
+    LogBuilder::getInstance().getLogger(name)->setInfoFormat("[%S] ");
+    LOG_FATAL(name, "fatal after format changes");
+    LogBuilder::getInstance().destroyLogger(name);
+
+    content = readFile(absPath);
+
+    if ((content.compare(0, banner.length() + 35, "[fatal] fatal after format changes\n" + banner) == 0) &&
+        (content.find("] crash record\n", banner.length()) != std::string::npos)) {
+        std::cout << "[OK] Crash buffer kept records while the format changed.\n";
+    } else {
+        std::cout << "[FAIL] Crash buffer kept records while the format changed.\n";
+        return false;
+    }
+
+    // The application aborts, the records kept are dumped by the signal
+    // handler.
+    std::remove(absPath.c_str());
+
+    pid_t pid = fork();
+
+    if (pid == 0) {
+        Logger logger(ls);
+        logger.setActiveSeverity(static_cast<int>(SeverityLevel::Error));
+
+        logger.write(SeverityLevel::Debug, __FILE__, __PRETTY_FUNCTION__, __LINE__, "Record before abort");
+
+        abort();
+    }
+
+    int status = 0;
+
+    waitpid(pid, &status, 0);
+
+    if (WIFSIGNALED(status) && (WTERMSIG(status) == SIGABRT) &&
+        (readFile(absPath) == banner + "[debug] Record before abort\n")) {
+        std::cout << "[OK] Crash buffer dumped on abort.\n";
+    } else {
+        std::cout << "[FAIL] Crash buffer dumped on abort.\n";
+        return false;
+    }
+
+    return true;
+}
+
+void configThreadLoop(const std::atomic<bool> * isRunning) {
+    while (isRunning->load()) {
+        LOG_DEBUG("log_config_a", "Debug while reloading");
+        LOG_ERROR("log_config_a", "Error while reloading");
+    }
+}
+
+void writeConfig(const std::string & path,
+                 const std::string & config) {
+    // Replaced at once, as an editor or a deployment would do.
+    std::ofstream outFile(path + ".tmp");
+    outFile << config;
+    outFile.close();
+
+    std::rename((path + ".tmp").c_str(), path.c_str());
+}
+
+bool loggerConfigTest() {
+    std::cout << "===> Testing configuration reload!\n";
+
+    std::string nameA = "log_config_a";
+    std::string nameB = "log_config_b";
+    std::string configPath = logPath + "log_config.conf";
+
+    std::remove((logPath + nameA).c_str());
+    std::remove((logPath + nameB).c_str());
+
+    LogBuilder::getInstance().buildLogger(nameA, logPath);
+    LogBuilder::getInstance().buildLogger(nameB, logPath);
+
+    std::shared_ptr<Logger> loggerA = LogBuilder::getInstance().getLogger(nameA);
+    std::shared_ptr<Logger> loggerB = LogBuilder::getInstance().getLogger(nameB);
+
+    writeConfig(configPath, "# Levels of the test\n"
+                            "*.severity = error, fatal\n"
+                            "log_config_b.enable = false\n"
+                            "unknown.severity = none\n");
+
+    LogBuilder::getInstance().reloadConfig(configPath);
+
+    if ((loggerA->getActiveSeverity() == (static_cast<int>(SeverityLevel::Error) | static_cast<int>(SeverityLevel::Fatal))) &&
+        loggerA->isEnable() && !loggerB->isEnable()) {
+        std::cout << "[OK] Configuration applied to the loggers.\n";
+    } else {
+        std::cout << "[FAIL] Configuration applied to the loggers.\n";
+        return false;
+    }
+
+    writeConfig(configPath, "log_config_b.enable = true\n"
+                            "log_config_a.severity = debug, loud\n");
+
+    try {
+        LogBuilder::getInstance().reloadConfig(configPath);
+        std::cout << "[FAIL] Invalid configuration refused.\n";
+        return false;
+    } catch (LoggerException & e) {
+        if ((e.code() == 5) && !loggerB->isEnable()) {
+            std::cout << "[OK] Invalid configuration refused.\n";
+        } else {
+            std::cout << "[FAIL] Invalid configuration refused.\n";
+            return false;
+        }
+    }
+
+    // The levels change while other threads log.
+    writeConfig(configPath, "*.severity = error\n");
+
+    LogBuilder::getInstance().watchConfig(configPath, std::chrono::milliseconds(10));
+
+    std::atomic<bool> isRunning(true);
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < 4; i++)
+        threads.emplace_back(configThreadLoop, &isRunning);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    writeConfig(configPath, "log_config_a.severity = all\n");
+
+    for (int i = 0; (i < 200) && (loggerA->getActiveSeverity() != LogSink::AllSeverity); i++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    isRunning.store(false);
+
+    for (auto & thread : threads)
+        thread.join();
+
+    LogBuilder::getInstance().unwatchConfig();
+    LogBuilder::getInstance().destroyLogger(nameA);
+    LogBuilder::getInstance().destroyLogger(nameB);
+    std::remove(configPath.c_str());
+
+    if ((loggerA->getActiveSeverity() == LogSink::AllSeverity) &&
+        (findRecordInFile(logPath + nameA, "Error while reloading") > 0) &&
+        (findRecordInFile(logPath + nameA, "Debug while reloading") > 0)) {
+        std::cout << "[OK] Configuration reloaded when the file changed.\n";
+    } else {
+        std::cout << "[FAIL] Configuration reloaded when the file changed.\n";
+        return false;
+    }
+
+    return true;
+}
+
+long allocationRecords(const std::string & name,
+                       const bool & isCounting) {
+    std::shared_ptr<Logger> logger = LogBuilder::getInstance().getLogger(name);
+    std::string_view msg = "Record without allocation, long enough to not fit in a small string";
+
+    qtyAllocations = 0;
+    isCountingAllocations = isCounting;
+
+    for (int i = 0; i < 1000; i++) {
+        logger->write(SeverityLevel::Info, __FILE__, __PRETTY_FUNCTION__, __LINE__, msg);
+        LOG_WARNINGF("log_allocation", "Deferred record {} of {} with a literal argument", i, "allocationRecords");
+        LOG_WARNING("log_allocation", "Streamed record " << i << " of " << -1000LL << " at " << 0.25 << ' ' << true);
+    }
+
+    isCountingAllocations = false;
+
+    return qtyAllocations;
+}
+
+bool loggerAllocationTest() {
+    std::cout << "===> Testing write path without allocation!\n";
+
+    struct {
+        OutputFormat outputFormat;
+        WriteMode writeMode;
+    } cases[] = {
+        { OutputFormat::Text, WriteMode::Sync },
+        { OutputFormat::Json, WriteMode::Sync },
+        { OutputFormat::Binary, WriteMode::Sync },
+        { OutputFormat::Text, WriteMode::Buffered }
+    };
+    std::string name = "log_allocation";
+
+    // The counter must see the allocations of the library.
+    qtyAllocations = 0;
+    isCountingAllocations = true;
+    LogConfig::parse("log_allocation.enable = true\n", "probe");
+    isCountingAllocations = false;
+
+    if (qtyAllocations == 0) {
+        std::cout << "[FAIL] Allocations counted.\n";
+        return false;
+    }
+
+    for (auto & test : cases) {
+        std::remove((logPath + name).c_str());
+
+        LogSetting ls(name, logPath);
+        ls.setInfo("[%D{%Y-%m-%d %H:%M:%S}.%q][%S][%F:%L][%M] ");
+        ls.setOutputFormat(test.outputFormat);
+        ls.setWriteMode(test.writeMode);
+
+        LogBuilder::getInstance().buildLogger(ls);
+
+        // The buffers of the logger and of the thread grow in the first
+        // records.
+        allocationRecords(name, false);
+
+        long qtyAllocated = allocationRecords(name, true);
+
+        LogBuilder::getInstance().destroyLogger(name);
+
+        if (qtyAllocated == 0) {
+            std::cout << "[OK] Records written without allocation (format " << static_cast<int>(test.outputFormat)
+                      << ", write mode " << static_cast<int>(test.writeMode) << ").\n";
+        } else {
+            std::cout << "[FAIL] Records written without allocation (format " << static_cast<int>(test.outputFormat)
+                      << ", write mode " << static_cast<int>(test.writeMode) << "): " << qtyAllocated << " allocations.\n";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void siteRecord(const std::string & name,
+                int * line) {
+    std::shared_ptr<Logger> logger = LogBuilder::getInstance().getLogger(name);
+
+    // Records of the call sites followed by the same records without them.
+    *line = __LINE__ + 1;
+    LOG_INFO(name, "Site record " << 1);
+    LOG_INFOF(name, "Site record {}", 1);
+    logger->write(SeverityLevel::Info, __FILE__, __PRETTY_FUNCTION__, *line, "Site record 1");
+    logger->write(SeverityLevel::Info, __FILE__, __PRETTY_FUNCTION__, *line + 1, "Site record 1");
+}
+
+unsigned long long getSiteHits(const int & line) {
+    unsigned long long qtyHits = 0;
+
+    LogCallSite::forEach([&](LogCallSite & site) {
+        if ((site.getLine() == line) && (std::string(site.getFile()) == __FILE__))
+            qtyHits = site.getHits();
+    });
+
+    return qtyHits;
+}
+
+std::vector<std::string> readLines(const std::string & file) {
+    std::vector<std::string> lines;
+    std::ifstream inFile(file);
+    std::string line;
+
+    while (std::getline(inFile, line))
+        lines.push_back(line);
+
+    return lines;
+}
+
+bool loggerCallSiteTest() {
+    std::cout << "===> Testing call sites!\n";
+
+    const WriteMode writeModes[] = { WriteMode::Sync, WriteMode::Async, WriteMode::Buffered };
+    std::string name = "log_call_site";
+    std::string absPath = logPath + name;
+
+    for (auto writeMode : writeModes) {
+        std::remove(absPath.c_str());
+
+        LogSetting ls(name, logPath);
+        ls.setInfo("%D{%H:%M:%S}.%q [%S][%F:%L][%M] %%D ");
+        ls.setWriteMode(writeMode);
+
+        LogBuilder::getInstance().buildLogger(ls);
+
+        int line = 0;
+
+        siteRecord(name, &line);
+
+        unsigned long long qtyHits = getSiteHits(line);
+
+        siteRecord(name, &line);
+        siteRecord(name, &line);
+
+        size_t qtyDisabled = LogCallSite::setEnable("logger_test.cpp", line, false);
+
+        siteRecord(name, &line);
+
+        LogCallSite::setEnable("test/logger_test.cpp", line, true);
+
+        // The records queued are formatted with the format of when they're
+        // written.
+        LogBuilder::getInstance().flush(name);
+        LogBuilder::getInstance().getLogger(name)->setInfoFormat("<%L> ");
+
+        siteRecord(name, &line);
+
+        qtyHits = getSiteHits(line) - qtyHits;
+
+        LogBuilder::getInstance().destroyLogger(name);
+
+        // The headers rendered from the call sites are the same, except the
+        // time.
+        std::vector<std::string> lines = readLines(absPath);
+        bool isSame = (lines.size() == 19);
+
+        for (size_t i = 0; isSame && (i < 12); i += 4) {
+            isSame = (lines[i][2] == ':') &&
+                     (lines[i].substr(lines[i].find(' ')) == lines[i + 2].substr(lines[i + 2].find(' '))) &&
+                     (lines[i + 1].substr(lines[i + 1].find(' ')) == lines[i + 3].substr(lines[i + 3].find(' ')));
+        }
+
+        if (isSame && (lines[0].find("[info][" __FILE__ ":" + std::to_string(line) + "][void siteRecord(") != std::string::npos)) {
+            std::cout << "[OK] Call site header rendered once (write mode " << static_cast<int>(writeMode) << ").\n";
+        } else {
+            std::cout << "[FAIL] Call site header rendered once (write mode " << static_cast<int>(writeMode) << ").\n";
+            return false;
+        }
+
+        std::string lineText = "<" + std::to_string(line) + "> Site record 1";
+        std::string nextLineText = "<" + std::to_string(line + 1) + "> Site record 1";
+
+        if ((qtyDisabled == 1) && (qtyHits == 3) &&
+            (lines[12].find("[" __FILE__ ":" + std::to_string(line + 1) + "]") != std::string::npos) &&
+            (lines[13].find("[" __FILE__ ":" + std::to_string(line) + "]") != std::string::npos) &&
+            (lines[15] == lineText) && (lines[16] == nextLineText) &&
+            (lines[17] == lineText) && (lines[18] == nextLineText)) {
+            std::cout << "[OK] Call site disabled, counted and rendered with a new format (write mode " << static_cast<int>(writeMode) << ").\n";
+        } else {
+            std::cout << "[FAIL] Call site disabled, counted and rendered with a new format (write mode " << static_cast<int>(writeMode) << ").\n";
+            return false;
+        }
+    }
+
+    // Files whose names end with the same text, only whole path components
+    // match.
+    static LogCallSite mainSite("test/site/main.cpp", "int main()", 10, SeverityLevel::Info);
+    static LogCallSite bareSite("main.cpp", "int main()", 10, SeverityLevel::Info);
+    static LogCallSite domainSite("test/site/domain.cpp", "int domain()", 10, SeverityLevel::Info);
+
+    size_t qtyMain = LogCallSite::setEnable("main.cpp", 0, false);
+    bool isMainDisabled = !mainSite.isEnable() && !bareSite.isEnable() && domainSite.isEnable();
+    size_t qtyPartial = LogCallSite::setEnable("ain.cpp", 0, false);
+    size_t qtyDomain = LogCallSite::setEnable("site/domain.cpp", 0, false);
+
+    if ((qtyMain == 2) && isMainDisabled && (qtyPartial == 0) && (qtyDomain == 1) && !domainSite.isEnable()) {
+        std::cout << "[OK] Call sites matched by whole path components.\n";
+    } else {
+        std::cout << "[FAIL] Call sites matched by whole path components.\n";
+        return false;
+    }
+
+    // Formats changed more times than the headers cached by call site, each
+    // one still rendered from the call site.
+    std::remove(absPath.c_str());
+
+    LogSetting ls(name, logPath);
+    ls.setInfo("(%L) ");
+
+    LogBuilder::getInstance().buildLogger(ls);
+
+    int line = 0;
+    std::string formats[] = { "a%L ", "b%L ", "c%L ", "d%L ", "e%L ", "f%L " };
+
+    for (int i = 0; i < 2; i++) {
+        for (auto & format : formats) {
+            LogBuilder::getInstance().getLogger(name)->setInfoFormat(format);
+            siteRecord(name, &line);
+        }
+    }
+
+    LogBuilder::getInstance().destroyLogger(name);
+
+    std::vector<std::string> lines = readLines(absPath);
+    bool isRendered = (lines.size() == 48);
+
+    for (size_t i = 0; isRendered && (i < lines.size()); i++) {
+        std::string expected = formats[(i / 4) % 6].substr(0, 1) + std::to_string(line + (i % 2)) + " Site record 1";
+
+        isRendered = (lines[i] == expected);
+    }
+
+    if (isRendered) {
+        std::cout << "[OK] Call site header rendered with more formats than cached.\n";
+    } else {
+        std::cout << "[FAIL] Call site header rendered with more formats than cached.\n";
+        return false;
+    }
+
+    return true;
+}
+
+void floodRecord(const std::string & name,
+                 const std::string & msg) {
+    LOG_ERROR(name, msg);
+}
+
+bool loggerRateLimitTest() {
+    std::cout << "===> Testing rate limit of the call sites!\n";
+
+    const WriteMode writeModes[] = { WriteMode::Sync, WriteMode::Async, WriteMode::Buffered };
+    const size_t qtyFlood = 1000;
+    std::string name = "log_rate_limit";
+    std::string absPath = logPath + name;
+
+    for (auto writeMode : writeModes) {
+        std::remove(absPath.c_str());
+
+        // Burst of 5 records, then one each 50 ms.
+        LogSetting ls(name, logPath);
+        ls.setInfo("[%S] ");
+        ls.setWriteMode(writeMode);
+        ls.setRateLimit(20, 5);
+
+        LogBuilder::getInstance().buildLogger(ls);
+
+        for (size_t i = 0; i < qtyFlood; i++) {
+            floodRecord(name, "Flood record");
+
+            if (i == 10)
+                LOG_INFO(name, "Other call site");
+        }
+
+        // The burst ended, the next record reports the records suppressed.
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+
+        floodRecord(name, "Flood ended");
+
+        // Reported when the logger is destroyed.
+        for (size_t i = 0; i < qtyFlood; i++)
+            floodRecord(name, "Flood record");
+
+        LogBuilder::getInstance().destroyLogger(name);
+
+        std::vector<std::string> lines = readLines(absPath);
+        const std::string repeated = "[error] Message repeated ";
+        size_t qtyWritten = 0;
+        size_t qtySuppressed = 0;
+        size_t qtyOther = 0;
+        size_t qtyReports = 0;
+        size_t ended = lines.size();
+
+        for (size_t i = 0; i < lines.size(); i++) {
+            if (lines[i] == "[error] Flood record") {
+                qtyWritten++;
+            } else if (lines[i] == "[info] Other call site") {
+                qtyOther++;
+            } else if (lines[i] == "[error] Flood ended") {
+                ended = i;
+            } else if (lines[i].compare(0, repeated.length(), repeated) == 0) {
+                qtySuppressed += std::stoul(lines[i].substr(repeated.length()));
+                qtyReports++;
+            }
+        }
+
+        if ((qtyOther == 1) && (ended > 0) && (ended < lines.size()) &&
+            (lines[ended - 1].compare(0, repeated.length(), repeated) == 0) &&
+            (lines.back().compare(0, repeated.length(), repeated) == 0) &&
+            (qtyWritten >= 5) && (qtyWritten < 20) &&
+            ((qtyWritten + qtySuppressed) == (2 * qtyFlood)) &&
+            ((qtyWritten + qtyReports + qtyOther + 1) == lines.size())) {
+            std::cout << "[OK] Call site rate limited (write mode " << static_cast<int>(writeMode) << ").\n";
+        } else {
+            std::cout << "[FAIL] Call site rate limited (write mode " << static_cast<int>(writeMode) << "): "
+                      << qtyWritten << " written, " << qtySuppressed << " suppressed.\n";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+LogMetrics findMetrics(const std::string & name) {
+    for (auto & metrics : LogBuilder::getInstance().getMetrics()) {
+        if (metrics.name == name)
+            return metrics;
+    }
+
+    return LogMetrics();
+}
+
+bool loggerMetricsTest() {
+    std::cout << "===> Testing logger metrics!\n";
+
+    std::string name = "log_metrics";
+    std::string absPath = logPath + name;
+
+    std::remove(absPath.c_str());
+
+    // Records filtered, written and suppressed by the rate limit.
+    LogSetting ls(name, logPath);
+    ls.setRateLimit(1, 3);
+
+    LogBuilder::getInstance().buildLogger(ls);
+    LogBuilder::getInstance().getLogger(name)->setActiveSeverity(static_cast<int>(SeverityLevel::Error));
+
+    for (int i = 0; i < 10; i++) {
+        LOG_INFO(name, "Filtered record " << i);
+        LOG_ERROR(name, "Limited record " << i);
+    }
+
+    LogBuilder::getInstance().flush(name);
+
+    LogMetrics metrics = findMetrics(name);
+    struct stat st;
+
+    if ((metrics.qtyRecordsWritten == 4) && (metrics.qtyRecordsFiltered == 10) &&
+        (metrics.qtyRecordsSuppressed == 7) && (metrics.qtyRecordsDropped == 0) &&
+        (stat(absPath.c_str(), &st) == 0) && (metrics.qtyBytesWritten == static_cast<unsigned long long>(st.st_size)) &&
+        (metrics.writeLatency.qty == 4) && (metrics.writeLatency.getPercentile(0.5) > 0) &&
+        (metrics.writeLatency.getPercentile(0.99) <= metrics.writeLatency.max) &&
+        (metrics.flushLatency.qty == 1) && (metrics.queueHighWater == 0)) {
+        std::cout << "[OK] Metrics of records written, filtered and suppressed.\n";
+    } else {
+        std::cout << "[FAIL] Metrics of records written, filtered and suppressed: " << metrics.toString() << "\n";
+        return false;
+    }
+
+    // Records filtered by threads already finished are still counted.
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < 4; i++) {
+        threads.emplace_back([&name]() {
+            for (int j = 0; j < 1000; j++)
+                LOG_INFO(name, "Filtered record " << j);
+        });
+    }
+
+    for (auto & thread : threads)
+        thread.join();
+
+    metrics = findMetrics(name);
+
+    if (metrics.qtyRecordsFiltered == 4010) {
+        std::cout << "[OK] Metrics of records filtered by threads.\n";
+    } else {
+        std::cout << "[FAIL] Metrics of records filtered by threads: " << metrics.toString() << "\n";
+        return false;
+    }
+
+    // Metrics written periodically into the logger itself.
+    LogBuilder::getInstance().getLogger(name)->enableAllSeverity();
+    LogBuilder::getInstance().emitMetrics(name, std::chrono::milliseconds(20));
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    LogBuilder::getInstance().stopMetrics();
+    LogBuilder::getInstance().destroyLogger(name);
+
+    if (findRecordInFile(absPath, "Metrics of the logger (" + name + "): written=") > 0) {
+        std::cout << "[OK] Metrics written periodically.\n";
+    } else {
+        std::cout << "[FAIL] Metrics written periodically.\n";
+        return false;
+    }
+
+    // Records dropped by a queue too small.
+    std::remove(absPath.c_str());
+
+    LogSetting lsAsync(name, logPath);
+    lsAsync.setWriteMode(WriteMode::Async);
+    lsAsync.setQueueCapacity(2);
+    lsAsync.setOverflowPolicy(OverflowPolicy::DropNewest);
+
+    LogBuilder::getInstance().buildLogger(lsAsync);
+
+    for (int i = 0; i < 1000; i++)
+        LOG_INFO(name, "Queued record " << i);
+
+    LogBuilder::getInstance().flush(name);
+
+    metrics = findMetrics(name);
+
+    LogBuilder::getInstance().destroyLogger(name);
+
+    if ((metrics.qtyRecordsDropped > 0) && (metrics.queueHighWater > 0) && (metrics.queueHighWater <= 2) &&
+        ((metrics.qtyRecordsWritten + metrics.qtyRecordsDropped) >= 1000)) {
+        std::cout << "[OK] Metrics of records dropped.\n";
+    } else {
+        std::cout << "[FAIL] Metrics of records dropped: " << metrics.toString() << "\n";
+        return false;
+    }
+
+    return true;
+}
+
+void sharedThreadLoop(const std::string & name,
+                      const int & thread,
+                      const int & qtyRecords) {
+    for (int i = 0; i < qtyRecords; i++)
+        LOG_INFO(name, "Shared record " << thread << " " << i << " " << std::string(i % 300, 'x') << " end");
+}
+
+bool loggerSharedWriteTest() {
+    std::cout << "===> Testing records written in parallel!\n";
+
+    const int qtyThreads = 8;
+    const int qtyRecords = 5000;
+    std::string name = "log_shared";
+    std::string absPath = logPath + name;
+
+    std::remove(absPath.c_str());
+
+    LogSetting ls(name, logPath);
+    ls.setInfo("[%S] ");
+
+    LogBuilder::getInstance().buildLogger(ls);
+
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < qtyThreads; i++)
+        threads.emplace_back(sharedThreadLoop, name, i, qtyRecords);
+
+    // The format and the file changed while the threads write.
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    LogBuilder::getInstance().getLogger(name)->setInfoFormat("<%S> ");
+    LogBuilder::getInstance().reopen(name);
+
+    for (auto & thread : threads)
+        thread.join();
+
+    LogBatchStats stats = LogBuilder::getInstance().getLogger(name)->getBatchStats();
+
+    LogBuilder::getInstance().destroyLogger(name);
+
+    // Each record is whole, in one of the formats, in the order of its
+    // thread.
+    std::vector<std::string> lines = readLines(absPath);
+    std::vector<int> next(qtyThreads, 0);
+    bool isWhole = (lines.size() == (qtyThreads * qtyRecords));
+
+    for (size_t i = 0; isWhole && (i < lines.size()); i++) {
+        std::istringstream iss(lines[i]);
+        std::string prefix, word, fill, end;
+        int thread = -1;
+        int record = -1;
+
+        iss >> prefix >> word >> word >> thread >> record;
+
+        if ((record % 300) != 0)
+            iss >> fill;
+
+        iss >> end;
+
+        isWhole = ((prefix == "[info]") || (prefix == "<info>")) &&
+                  (thread >= 0) && (thread < qtyThreads) && (record == next[thread]) &&
+                  (fill.length() == static_cast<size_t>(record % 300)) && (end == "end") && iss.eof();
+
+        if (isWhole)
+            next[thread]++;
+    }
+
+    if (isWhole && (lines.front().compare(0, 6, "[info]") == 0) && (lines.back().compare(0, 6, "<info>") == 0) &&
+        (stats.qtyRecords == static_cast<unsigned long long>(qtyThreads * qtyRecords)) &&
+        (stats.qtyWrites == stats.qtyRecords)) {
+        std::cout << "[OK] Records written whole by threads in parallel.\n";
+    } else {
+        std::cout << "[FAIL] Records written whole by threads in parallel.\n";
+        return false;
+    }
+
+    // A sink attached while the threads write in parallel gets the records
+    // in the order of the file, the threads writing one at a time until it's
+    // detached.
+    std::string copyName = name + "_copy";
+    std::shared_ptr<LogSink> copy = std::make_shared<LogFileSink>(LogSetting(copyName, logPath));
+
+    std::remove(absPath.c_str());
+    std::remove((logPath + copyName).c_str());
+
+    LogBuilder::getInstance().buildLogger(ls);
+    threads.clear();
+
+    for (int i = 0; i < qtyThreads; i++)
+        threads.emplace_back(sharedThreadLoop, name, i, qtyRecords);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    LogBuilder::getInstance().attachSink(name, copy);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    LogBuilder::getInstance().detachSink(name, copy);
+
+    for (auto & thread : threads)
+        thread.join();
+
+    LogBuilder::getInstance().destroyLogger(name);
+
+    lines = readLines(absPath);
+    std::vector<std::string> copyLines = readLines(logPath + copyName);
+    auto first = copyLines.empty() ? lines.end() : std::find(lines.begin(), lines.end(), copyLines.front());
+
+    if ((lines.size() == (qtyThreads * qtyRecords)) && !copyLines.empty() &&
+        (static_cast<size_t>(lines.end() - first) >= copyLines.size()) &&
+        std::equal(copyLines.begin(), copyLines.end(), first)) {
+        std::cout << "[OK] Sink attached while writing in parallel.\n";
+    } else {
+        std::cout << "[FAIL] Sink attached while writing in parallel.\n";
+        return false;
+    }
+
+    // More loggers than the first page of slots of the threads holds, each
+    // one counting its own records, also after being built again.
+    const int qtyLoggers = 32;
+    bool isCounted = true;
+
+    for (int round = 0; isCounted && (round < 2); round++) {
+        for (int i = 0; i < qtyLoggers; i++) {
+            LogSetting lsMany(name + "_" + std::to_string(i), logPath);
+            lsMany.setInfo("[%S] ");
+
+            std::remove((logPath + lsMany.getName()).c_str());
+            LogBuilder::getInstance().buildLogger(lsMany);
+        }
+
+        threads.clear();
+
+        for (int i = 0; i < qtyThreads; i++)
+            threads.emplace_back([&name, i]() {
+                for (int j = 0; j < qtyLoggers; j++)
+                    sharedThreadLoop(name + "_" + std::to_string(j), i, j + 1);
+            });
+
+        for (auto & thread : threads)
+            thread.join();
+
+        for (int i = 0; i < qtyLoggers; i++) {
+            std::string nameMany = name + "_" + std::to_string(i);
+            LogMetrics metrics = LogBuilder::getInstance().getLogger(nameMany)->getMetrics();
+
+            LogBuilder::getInstance().destroyLogger(nameMany);
+
+            isCounted = isCounted &&
+                        (metrics.qtyRecordsWritten == static_cast<unsigned long long>(qtyThreads * (i + 1))) &&
+                        (readLines(logPath + nameMany).size() == metrics.qtyRecordsWritten);
+        }
+    }
+
+    if (isCounted) {
+        std::cout << "[OK] Records counted by many loggers.\n";
+    } else {
+        std::cout << "[FAIL] Records counted by many loggers.\n";
+        return false;
+    }
+
+    // The record written partially is an error, the rest isn't written
+    // after it.
+    name = "log_shared_short";
+    absPath = logPath + name;
+
+    std::remove(absPath.c_str());
+
+    pid_t pid = fork();
+
+    if (pid == 0) {
+        execl("/proc/self/exe", "logger_test", "--short-write", name.c_str(), static_cast<char *>(nullptr));
+        _exit(1);
+    }
+
+    int status = 0;
+    struct stat st;
+
+    waitpid(pid, &status, 0);
+
+    if (WIFEXITED(status) && (WEXITSTATUS(status) == 0) &&
+        (stat(absPath.c_str(), &st) == 0) && (st.st_size == 1000)) {
+        std::cout << "[OK] Record written partially in parallel is an error.\n";
+    } else {
+        std::cout << "[FAIL] Record written partially in parallel is an error.\n";
+        return false;
+    }
+
+    return true;
+}
+
+int shortWriteRecords(const std::string & name) {
+    // The file can't grow beyond 1000 bytes, a record crossing it is
+    // written partially.
+    struct rlimit limit = { 1000, 1000 };
+
+    signal(SIGXFSZ, SIG_IGN);
+
+    if (setrlimit(RLIMIT_FSIZE, &limit) != 0)
+        return 1;
+
+    LogSetting ls(name, logPath);
+    ls.setInfo("[%S] ");
+
+    LogBuilder::getInstance().buildLogger(ls);
+
+    for (int i = 0; i < 100; i++) {
+        try {
+            LOG_INFO(name, "Short record " << i << " " << std::string(50, 'x'));
+        } catch (LoggerException & e) {
+            return (std::string(e.what()) == "Record written partially in the file.") ? 0 : 2;
+        }
+    }
+
+    return 3;
+}
+
+template<typename T>
+std::string streamText(const T & value) {
+    LogStream stream;
+
+    stream << "[" << value << "]";
+
+    return std::string(stream.view());
+}
+
+template<typename T>
+std::string ostreamText(const T & value) {
+    std::ostringstream stream;
+
+    stream << "[" << value << "]";
+
+    return stream.str();
+}
+
+bool loggerStreamTest() {
+    std::cout << "===> Testing message stream!\n";
+
+    bool isEqual = (streamText(0) == ostreamText(0)) &&
+                   (streamText(-7) == ostreamText(-7)) &&
+                   (streamText(1234567890) == ostreamText(1234567890)) &&
+                   (streamText(std::numeric_limits<int>::min()) == ostreamText(std::numeric_limits<int>::min())) &&
+                   (streamText(std::numeric_limits<long long>::min()) == ostreamText(std::numeric_limits<long long>::min())) &&
+                   (streamText(std::numeric_limits<unsigned long long>::max()) ==
+                    ostreamText(std::numeric_limits<unsigned long long>::max())) &&
+                   (streamText(static_cast<short>(-300)) == ostreamText(static_cast<short>(-300))) &&
+                   (streamText(3.14159265) == ostreamText(3.14159265)) &&
+                   (streamText(1e-7) == ostreamText(1e-7)) &&
+                   (streamText(123456789.0f) == ostreamText(123456789.0f)) &&
+                   (streamText(true) == ostreamText(true)) &&
+                   (streamText('x') == ostreamText('x')) &&
+                   (streamText(std::string("text")) == ostreamText(std::string("text"))) &&
+                   (streamText(std::string_view("view")) == ostreamText(std::string_view("view")));
+
+    if (isEqual) {
+        std::cout << "[OK] Values streamed as std::ostream prints them.\n";
+    } else {
+        std::cout << "[FAIL] Values streamed as std::ostream prints them.\n";
+        return false;
+    }
+
+    LogStream stream;
+    std::ostringstream expected;
+    int value = 255;
+    void * pointer = &value;
+
+    stream << "dec " << value << " hex " << std::hex << value << " " << pointer << " " << std::boolalpha << true;
+    expected << "dec " << value << " hex " << std::hex << value << " " << pointer << " " << std::boolalpha << true;
+
+    if (stream.view() == expected.str()) {
+        std::cout << "[OK] Manipulators and other types streamed by std::ostream.\n";
+    } else {
+        std::cout << "[FAIL] Manipulators and other types streamed by std::ostream.\n";
+        return false;
+    }
+
+    LogStream longStream;
+    std::string longText;
+
+    for (int i = 0; i < 200; i++) {
+        longStream << i << ',';
+        longText += std::to_string(i) + ',';
+    }
+
+    if ((longText.length() > LogStream::Capacity) && (longStream.view() == longText)) {
+        std::cout << "[OK] Message longer than the stack buffer streamed.\n";
+    } else {
+        std::cout << "[FAIL] Message longer than the stack buffer streamed.\n";
+        return false;
+    }
+
+    return true;
+}
+
+LOG_STATIC_FORMAT(HeaderFormat, "%D{%Y-%m-%d %H:%M:%S.%q} [%S] %F:%L ");
+LOG_STATIC_FORMAT(FullFormat, "[%D{%Y-%m-%d %H:%M:%S}.%q][%S][%F:%L][%M] ");
+LOG_STATIC_FORMAT(EscapeFormat, "%%%D%x %S 100%");
+LOG_STATIC_FORMAT(DatesFormat, "%D{%H%}x%D{%M}%D{%q%%}%D{%a %j}%D{%S");
+LOG_STATIC_FORMAT(LiteralFormat, "plain header ");
+LOG_STATIC_FORMAT(EmptyFormat, "");
+LOG_STATIC_FORMAT(SiteFormat, "[%S][%F:%L][%M] ");
+
+template<typename Format>
+bool isStaticFormatEqual() {
+    LogFormat format{std::string(Format::value)};
+    std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
+    std::chrono::system_clock::time_point second = std::chrono::time_point_cast<std::chrono::seconds>(now);
+    std::chrono::system_clock::time_point times[] = {
+        now,
+        second,
+        second + std::chrono::milliseconds(7),
+        second + std::chrono::milliseconds(999),
+        second + std::chrono::seconds(3661) + std::chrono::milliseconds(42),
+        std::chrono::system_clock::time_point(std::chrono::seconds(1700000000))
+    };
+    int lines[] = { 0, 7, -12, 123456789 };
+
+    for (auto & time : times) {
+        for (auto & line : lines) {
+            std::string expected;
+            std::string rendered;
+
+            format.render(expected, time, "test/logger_test.cpp", "bool staticFormat()", line, "warning");
+            LogStaticFormat<Format>::render(rendered, time, "test/logger_test.cpp", "bool staticFormat()", line, "warning");
+
+            if (rendered != expected) {
+                std::cout << "Format (" << Format::value << ") rendered (" << rendered << ") instead of (" << expected << ").\n";
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+void staticFormatRecords(const std::string & name) {
+    std::shared_ptr<Logger> logger = LogBuilder::getInstance().getLogger(name);
+
+    for (int i = 0; i < 10; i++) {
+        LOG_INFO(name, "Static format record " << i);
+        LOG_WARNINGF(name, "Static format record {}", i);
+        logger->write(SeverityLevel::Error, __FILE__, __PRETTY_FUNCTION__, i, "Static format record");
+    }
+}
+
+bool loggerStaticFormatTest() {
+    std::cout << "===> Testing info format parsed at compile time!\n";
+
+    if (isStaticFormatEqual<HeaderFormat>() && isStaticFormatEqual<FullFormat>() &&
+        isStaticFormatEqual<EscapeFormat>() && isStaticFormatEqual<DatesFormat>() &&
+        isStaticFormatEqual<LiteralFormat>() && isStaticFormatEqual<EmptyFormat>() &&
+        isStaticFormatEqual<SiteFormat>()) {
+        std::cout << "[OK] Info format parsed at compile time rendered as the runtime format.\n";
+    } else {
+        std::cout << "[FAIL] Info format parsed at compile time rendered as the runtime format.\n";
+        return false;
+    }
+
+    for (int writeMode = 0; writeMode < 3; writeMode++) {
+        std::string names[] = { "log_static_runtime", "log_static_setting", "log_static_logger" };
+
+        for (auto & name : names) {
+            std::remove((logPath + name).c_str());
+
+            LogSetting ls(name, logPath);
+            ls.setInfo(std::string(SiteFormat::value));
+            ls.setWriteMode(static_cast<WriteMode>(writeMode));
+
+            if (name == "log_static_setting")
+                ls.setInfo<SiteFormat>();
+
+            LogBuilder::getInstance().buildLogger(ls);
+
+            if (name == "log_static_logger")
+                LogBuilder::getInstance().getLogger(name)->setInfoFormat<SiteFormat>();
+
+            staticFormatRecords(name);
+
+            LogBuilder::getInstance().destroyLogger(name);
+        }
+
+        std::vector<std::string> expected = readLines(logPath + names[0]);
+
+        if ((expected.size() == 30) &&
+            (readLines(logPath + names[1]) == expected) &&
+            (readLines(logPath + names[2]) == expected)) {
+            std::cout << "[OK] Records written with the info format parsed at compile time (write mode " << writeMode << ").\n";
+        } else {
+            std::cout << "[FAIL] Records written with the info format parsed at compile time (write mode " << writeMode << ").\n";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int exitRecords(const std::string & name,
+                const int & writeMode) {
+    LogSetting ls(name, logPath);
+    ls.setInfo("[%D{%Y-%m-%d %H:%M:%S}.%q][%S][%F:%L] ");
+    ls.setWriteMode(static_cast<WriteMode>(writeMode));
+    ls.setQueueCapacity(32 * 1024);
+
+    LogBuilder::getInstance().buildLogger(ls);
+
+    // The call site is created after the builder, so it's destroyed before
+    // the builder writes the records left.
+    for (int i = 0; i < 20000; i++)
+        LOG_INFO(name, "Exit record " << i);
+
+    return 0;
+}
+
+bool loggerExitTest() {
+    std::cout << "===> Testing records written when the application exits!\n";
+
+    std::string name = "log_exit";
+    WriteMode writeModes[] = { WriteMode::Async, WriteMode::Buffered };
+
+    for (auto & writeMode : writeModes) {
+        std::string mode = std::to_string(static_cast<int>(writeMode));
+
+        std::remove((logPath + name).c_str());
+
+        pid_t pid = fork();
+
+        if (pid == 0) {
+            execl("/proc/self/exe", "logger_test", "--exit-records", name.c_str(), mode.c_str(), static_cast<char *>(nullptr));
+            _exit(1);
+        }
+
+        int status = 0;
+
+        waitpid(pid, &status, 0);
+
+        if (WIFEXITED(status) && (WEXITSTATUS(status) == 0) &&
+            (findRecordInFile(logPath + name, "Exit record") == 20000)) {
+            std::cout << "[OK] Records written when the application exits (write mode " << mode << ").\n";
+        } else {
+            std::cout << "[FAIL] Records written when the application exits (write mode " << mode << ").\n";
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,93 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Ismael Filipe Mesquita Ribeiro - nakinx
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "src/logbinary.h"
+#include "src/logexception.h"
+
+#include <iostream>
+#include <string>
+
+#include <zlib.h>
+
+/**
+ * Read the whole file, compressed by the rotation or not.
+ *
+ * @param file Path of the file.
+ * @param data Content of the file.
+ *
+ * @return True if the file was read and false otherwise.
+ */
+static bool readFile(const std::string & file,
+                     std::string & data) {
+    gzFile gz = gzopen(file.c_str(), "rb");
+
+    if (gz == nullptr)
+        return false;
+
+    char buffer[64 * 1024];
+    int rc;
+
+    while ((rc = gzread(gz, buffer, sizeof(buffer))) > 0)
+        data.append(buffer, rc);
+
+    gzclose(gz);
+
+    return (rc == 0);
+}
+
+/**
+ * Decode binary log files into the text of the info format they were
+ * written with, in the order given.
+ *
+ * Usage: logdecode <file> [<file> ...]
+ */
+int main(int argc,
+         char * argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <file> [<file> ...]\n";
+        return 1;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        std::string data;
+        std::string text;
+
+        if (!readFile(argv[i], data)) {
+            std::cerr << argv[i] << ": Error while reading the file.\n";
+            return 1;
+        }
+
+        try {
+            LogBinary::decode(data, text);
+        } catch (LoggerException & e) {
+            std::cout << text;
+            std::cerr << argv[i] << ": " << e.what() << "\n";
+            return 1;
+        }
+
+        std::cout << text;
+    }
+
+    return 0;
+}